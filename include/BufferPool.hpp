@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief A thread-safe pool of fixed-size transfer buffers.
+ *
+ * Buffers are handed out as Leases, which give the slab back to the pool on
+ * destruction. The pool keeps at most maxIdle free slabs, so repeated polling
+ * reuses the same memory instead of going through the heap. A lease larger
+ * than a slab falls back to the heap.
+ */
+class BufferPool : public std::enable_shared_from_this<BufferPool>
+{
+  public:
+    static constexpr size_t slabSize = 4096;
+
+    /**
+     * @brief A transfer buffer, used like a std::vector<uint8_t> of
+     * fixed capacity.
+     *
+     * The buffer comes from the pool when the size fits into a slab and from
+     * the heap otherwise. Growing the buffer zero-fills the new bytes.
+     */
+    class Lease
+    {
+      public:
+        Lease() = default;
+        explicit Lease(std::shared_ptr<BufferPool> pool);
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        uint8_t* data()
+        {
+            return buf.get();
+        }
+
+        const uint8_t* data() const
+        {
+            return buf.get();
+        }
+
+        size_t size() const
+        {
+            return len;
+        }
+
+        void resize(size_t size);
+
+      private:
+        void release() noexcept;
+
+        // null when the buffer is not from the pool
+        std::shared_ptr<BufferPool> pool;
+        std::unique_ptr<uint8_t[]> buf;
+        size_t len = 0;
+        size_t capacity = 0;
+        bool pooled = false;
+    };
+
+    explicit BufferPool(size_t maxIdle);
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Lease lease();
+
+  private:
+    std::unique_ptr<uint8_t[]> get();
+    void put(std::unique_ptr<uint8_t[]> slab) noexcept;
+
+    std::mutex mtx;
+    const size_t maxIdle;
+    std::vector<std::unique_ptr<uint8_t[]>> idle;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief Stops sending commands to an endpoint that stopped responding.
+ *
+ * Closed: commands are sent. After failureThreshold consecutive transport
+ * failures the breaker opens.
+ * Open: commands are rejected without touching the bus until the backoff
+ * expires. The backoff doubles on every failed probe, up to maxBackoff, and
+ * is jittered so that the endpoints which failed together don't probe
+ * together.
+ * HalfOpen: the backoff expired and a single probe is sent. The breaker
+ * closes if the probe succeeds, and opens again otherwise.
+ */
+class CircuitBreaker
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State : uint8_t
+    {
+        Closed,
+        Open,
+        HalfOpen,
+    };
+
+    // the verdict on the next command
+    enum class Admission : uint8_t
+    {
+        Pass,
+        Reject,
+        // send a probe first, and the command only if the probe succeeded
+        Probe,
+    };
+
+    static constexpr unsigned failureThreshold = 3;
+    static constexpr std::chrono::milliseconds initialBackoff =
+        std::chrono::seconds(1);
+    static constexpr std::chrono::milliseconds maxBackoff =
+        std::chrono::minutes(2);
+
+    CircuitBreaker();
+
+    Admission admit(Clock::time_point now);
+
+    // A response was received, whatever its status.
+    void success();
+
+    // The endpoint didn't respond.
+    void failure(Clock::time_point now);
+
+    // Open a closed breaker right away, on a failure seen elsewhere.
+    void trip(Clock::time_point now);
+
+    State state() const
+    {
+        return current;
+    }
+
+  private:
+    void open(Clock::time_point now);
+
+    State current = State::Closed;
+    unsigned failures = 0;
+    std::chrono::milliseconds backoff = initialBackoff;
+    Clock::time_point retryAt;
+    std::minstd_rand rng;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+
+/**
+ * @brief A free-list allocator for the coroutine frames of one owner.
+ *
+ * Blocks are grouped in power-of-two size classes. A freed block is kept on
+ * the free list of its class, so a coroutine started once per poll cycle
+ * reuses the frame of the previous cycle instead of going through the heap.
+ * The arena only grows to the peak number of live frames per class. A frame
+ * larger than maxBlock falls back to the heap.
+ *
+ * The arena is not thread-safe: the frames are created and destroyed on the
+ * io_context thread.
+ */
+class FrameArena
+{
+  public:
+    static constexpr size_t minBlock = 64;
+    static constexpr size_t maxBlock = 4096;
+
+    FrameArena() = default;
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+    ~FrameArena();
+
+    /**
+     * @brief Allocate a coroutine frame of size bytes.
+     *
+     * The frame holds a reference to the arena, which is released after the
+     * frame is returned, so the arena outlives its frames even when the frame
+     * is the last owner of the object holding the arena. A null arena
+     * allocates from the heap.
+     */
+    static void* allocateFrame(const std::shared_ptr<FrameArena>& arena,
+                               size_t size);
+    static void deallocateFrame(void* frame, size_t size) noexcept;
+
+  private:
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t numClasses = 7;
+    static_assert(minBlock << (numClasses - 1) == maxBlock);
+
+    static size_t sizeClass(size_t size);
+
+    void* allocate(size_t size);
+    void deallocate(void* block, size_t size) noexcept;
+
+    std::array<FreeBlock*, numClasses> freeLists{};
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Learns the response latency of one command type of an endpoint and
+ * derives the timeout of the next command from it.
+ *
+ * The estimate combines a moving average with a high percentile of a window
+ * of recent samples, so the timeout follows both the typical latency and its
+ * tail. Until enough samples are collected the caller's fallback is used.
+ *
+ * A command that timed out is recorded with its timeout as a lower bound of
+ * the latency, so the next timeout grows and a drive that became slower gets
+ * a longer timeout, up to the ceiling.
+ */
+class LatencyEstimator
+{
+  public:
+    // the number of samples before the estimate is trusted
+    static constexpr size_t minSamples = 8;
+
+    void record(std::chrono::microseconds sample);
+
+    std::chrono::milliseconds timeout(std::chrono::milliseconds fallback,
+                                      std::chrono::milliseconds floor,
+                                      std::chrono::milliseconds ceiling) const;
+
+    std::chrono::microseconds mean() const
+    {
+        return ewma;
+    }
+
+    std::chrono::microseconds percentile() const
+    {
+        return tail;
+    }
+
+  private:
+    static constexpr size_t window = 64;
+    // the percentile of the window taken as the tail latency
+    static constexpr size_t tailPercent = 99;
+    // the timeout is the larger of the scaled mean and the scaled tail
+    static constexpr int meanFactor = 4;
+    static constexpr int tailFactor = 2;
+
+    std::array<uint32_t, window> samples{};
+    size_t count = 0;
+    size_t next = 0;
+    std::chrono::microseconds ewma{0};
+    std::chrono::microseconds tail{0};
+};
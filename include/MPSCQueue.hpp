@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief A bounded lock-free multi-producer single-consumer queue.
+ *
+ * The cells are preallocated so that push() and pop() never allocate. Each
+ * cell carries a sequence number telling whether it is free for the producer
+ * at a given position or holds a value for the consumer (D. Vyukov's bounded
+ * queue, reduced to a single consumer).
+ */
+template <class T, size_t Capacity>
+class MPSCQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of 2");
+
+  public:
+    MPSCQueue()
+    {
+        for (size_t i = 0; i < Capacity; i++)
+        {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    ~MPSCQueue()
+    {
+        while (pop())
+        {}
+    }
+
+    // Called by any thread. Returns false if the queue is full.
+    bool push(T&& value)
+    {
+        Cell* cell = nullptr;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true)
+        {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                     std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        new (cell->storage) T(std::move(value));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Called by the consumer thread only.
+    std::optional<T> pop()
+    {
+        Cell& cell = cells[dequeuePos & mask];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) -
+                static_cast<intptr_t>(dequeuePos + 1) <
+            0)
+        {
+            return std::nullopt;
+        }
+
+        T* ptr = std::launder(reinterpret_cast<T*>(cell.storage));
+        std::optional<T> value{std::move(*ptr)};
+        ptr->~T();
+        cell.seq.store(dequeuePos + Capacity, std::memory_order_release);
+        dequeuePos++;
+        return value;
+    }
+
+    // Called by the consumer thread only.
+    bool empty() const
+    {
+        const Cell& cell = cells[dequeuePos & mask];
+        return static_cast<intptr_t>(
+                   cell.seq.load(std::memory_order_acquire)) -
+                   static_cast<intptr_t>(dequeuePos + 1) <
+               0;
+    }
+
+  private:
+    static constexpr size_t mask = Capacity - 1;
+
+    struct Cell
+    {
+        std::atomic<size_t> seq;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    Cell cells[Capacity];
+
+    // keep the producer and consumer cursors on different cache lines
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) size_t dequeuePos{0};
+};
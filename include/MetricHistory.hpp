@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Fixed memory trend history of one metric of a drive.
+ *
+ * Every sample goes into the raw tier, and is downsampled into the 1-minute
+ * tier, which in turn is downsampled into the 1-hour tier. Each tier is a
+ * ring that overwrites its oldest entry, and all the storage is part of the
+ * object, so the memory is bounded and allocated with it.
+ */
+class MetricHistory
+{
+  public:
+    enum class Tier : uint8_t
+    {
+        Raw,
+        Minute,
+        Hour,
+    };
+
+    // A raw sample has the same min, max and mean. A downsampled one starts
+    // at time and aggregates the samples of its minute or hour.
+    struct Sample
+    {
+        // seconds since the epoch
+        uint32_t time;
+        float min;
+        float max;
+        float mean;
+    };
+
+    // the size of a sample packed by query()
+    static constexpr size_t packedSize = 16;
+
+    // 10 minutes at the fastest poll interval
+    static constexpr size_t rawCapacity = 128;
+    // 6 hours
+    static constexpr size_t minuteCapacity = 360;
+    // 14 days
+    static constexpr size_t hourCapacity = 336;
+
+    void add(uint32_t time, float value);
+
+    // The samples of the tier, oldest first, each packed little-endian as
+    // the uint32 time then the float min, max and mean. The minute and hour
+    // being aggregated come last.
+    std::vector<uint8_t> query(Tier tier) const;
+
+    void save(std::ostream& os) const;
+    // the history is left unspecified on failure
+    bool load(std::istream& is);
+
+  private:
+    template <size_t N>
+    struct Ring
+    {
+        std::array<Sample, N> samples{};
+        size_t head = 0;
+        size_t count = 0;
+
+        void push(const Sample& sample);
+        void pack(std::vector<uint8_t>& out) const;
+    };
+
+    // the aggregate of the samples of one minute or hour
+    struct Bucket
+    {
+        uint32_t start = 0;
+        float min = 0;
+        float max = 0;
+        double sum = 0;
+        uint32_t count = 0;
+
+        // add a sample to the bucket of width seconds, and return the
+        // previous bucket if the sample starts a new one
+        std::optional<Sample> add(const Sample& sample, uint32_t width);
+        Sample sample() const;
+    };
+
+    Ring<rawCapacity> raw;
+    Ring<minuteCapacity> minute;
+    Ring<hourCapacity> hour;
+    Bucket minuteBucket;
+    Bucket hourBucket;
+};
+
+/**
+ * @brief The trend history of the metrics of a drive.
+ *
+ * A snapshot is saved to a file named after the drive, with the serial
+ * number of the drive, and only restored onto the same drive.
+ */
+class DriveHistory
+{
+  public:
+    enum class Metric : uint8_t
+    {
+        Temperature,
+        LifeUsed,
+        AvailableSpare,
+        MediaErrors,
+        ErrorLogEntries,
+    };
+    static constexpr size_t numMetric = 5;
+
+    static std::optional<Metric> metricFromString(std::string_view name);
+    static std::optional<MetricHistory::Tier>
+        tierFromString(std::string_view name);
+
+    explicit DriveHistory(std::string file) : file(std::move(file))
+    {}
+
+    // record a sample taken now
+    void add(Metric metric, float value);
+
+    std::vector<uint8_t> query(Metric metric, MetricHistory::Tier tier) const
+    {
+        return metrics[static_cast<size_t>(metric)].query(tier);
+    }
+
+    // Restore the snapshot of the drive with the serial number, if any.
+    // The history is only saved once the serial number is known.
+    void load(const std::string& serial);
+    void save() const;
+
+  private:
+    std::string file;
+    std::string serial;
+    std::array<MetricHistory, numMetric> metrics;
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "NVMeIntf.hpp"
+#include "Task.hpp"
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <coroutine>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * Awaitable versions of the NVMeMiIntf commands.
+ *
+ * Each awaitable issues the command on co_await and resumes the coroutine
+ * from the completion callback, on the io_context. The result is a tuple of
+ * the error code and the callback arguments, e.g.
+ *
+ *     auto [ec, log] = co_await coro::getLog<nvme_smart_log>(*intf, ctrl,
+ *                                                           nsid, opts);
+ *
+ * As with the callbacks, a pointer, span or view in the result refers to the
+ * response buffer and is only valid until the next suspension point of the
+ * coroutine.
+ */
+namespace coro
+{
+
+template <class Start, class... Values>
+class CommandAwaiter
+{
+  public:
+    using Result = std::tuple<std::error_code, Values...>;
+
+    explicit CommandAwaiter(Start&& start) : start(std::move(start)) {}
+
+    CommandAwaiter(const CommandAwaiter&) = delete;
+    CommandAwaiter& operator=(const CommandAwaiter&) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        // the callback is always posted to the io_context, never invoked
+        // from within the call
+        start([this, h](const std::error_code& ec, Values... values) {
+            result.emplace(ec, values...);
+            h.resume();
+        });
+    }
+
+    Result await_resume()
+    {
+        return std::move(*result);
+    }
+
+  private:
+    Start start;
+    std::optional<Result> result;
+};
+
+template <class... Values, class Start>
+CommandAwaiter<Start, Values...> makeAwaiter(Start&& start)
+{
+    return CommandAwaiter<Start, Values...>(std::forward<Start>(start));
+}
+
+inline auto miPCIePortInformation(NVMeMiIntf& intf,
+                                  NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<nvme_mi_read_port_info*>(
+        [&intf, opts{std::move(opts)}](auto&& cb) {
+        intf.miPCIePortInformation(std::move(cb), opts);
+    });
+}
+
+inline auto miSubsystemHealthStatusPoll(NVMeMiIntf& intf,
+                                        NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<nvme_mi_nvm_ss_health_status*>(
+        [&intf, opts{std::move(opts)}](auto&& cb) {
+        intf.miSubsystemHealthStatusPoll(std::move(cb), opts);
+    });
+}
+
+inline auto miScanCtrl(NVMeMiIntf& intf, NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<std::span<const nvme_mi_ctrl_t>>(
+        [&intf, opts{std::move(opts)}](auto&& cb) {
+        intf.miScanCtrl(std::move(cb), opts);
+    });
+}
+
+inline auto adminIdentify(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                          nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
+                          uint16_t readLength,
+                          NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<std::span<uint8_t>>(
+        [&intf, ctrl, cns, nsid, cntid, readLength,
+         opts{std::move(opts)}](auto&& cb) {
+        intf.adminIdentify(ctrl, cns, nsid, cntid, readLength, std::move(cb),
+                           opts);
+    });
+}
+
+inline auto adminGetLogPage(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                            nvme_cmd_get_log_lid lid, uint32_t nsid,
+                            uint8_t lsp, uint16_t lsi,
+                            NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<std::span<uint8_t>>(
+        [&intf, ctrl, lid, nsid, lsp, lsi, opts{std::move(opts)}](auto&& cb) {
+        intf.adminGetLogPage(ctrl, lid, nsid, lsp, lsi, std::move(cb), opts);
+    });
+}
+
+inline auto adminGetLog(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                        nvme_cmd_get_log_lid lid, uint32_t nsid, uint8_t lsp,
+                        uint16_t lsi, uint32_t offset, uint32_t length,
+                        NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<std::span<uint8_t>>(
+        [&intf, ctrl, lid, nsid, lsp, lsi, offset, length,
+         opts{std::move(opts)}](auto&& cb) {
+        intf.adminGetLog(ctrl, lid, nsid, lsp, lsi, offset, length,
+                         std::move(cb), opts);
+    });
+}
+
+template <class T, size_t Length = sizeof(T)>
+auto getLog(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl, uint32_t nsid,
+            NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<ResponseView<T, Length>>(
+        [&intf, ctrl, nsid, opts{std::move(opts)}](auto&& cb) {
+        intf.getLog<T, Length>(ctrl, nsid, std::move(cb), opts);
+    });
+}
+
+template <class T, size_t Length = sizeof(T)>
+auto identify(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl, uint32_t nsid,
+              uint16_t cntid, NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<ResponseView<T, Length>>(
+        [&intf, ctrl, nsid, cntid, opts{std::move(opts)}](auto&& cb) {
+        intf.identify<T, Length>(ctrl, nsid, cntid, std::move(cb), opts);
+    });
+}
+
+inline auto adminFwCommit(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                          nvme_fw_commit_ca action, uint8_t slot, bool bpid,
+                          NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<nvme_status_field>(
+        [&intf, ctrl, action, slot, bpid, opts{std::move(opts)}](auto&& cb) {
+        intf.adminFwCommit(ctrl, action, slot, bpid, std::move(cb), opts);
+    });
+}
+
+inline auto adminSanitize(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                          nvme_sanitize_sanact sanact, uint8_t owpass,
+                          uint32_t owpattern,
+                          NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<std::span<uint8_t>>(
+        [&intf, ctrl, sanact, owpass, owpattern,
+         opts{std::move(opts)}](auto&& cb) {
+        intf.adminSanitize(ctrl, sanact, owpass, owpattern, std::move(cb),
+                           opts);
+    });
+}
+
+// data must stay valid until the command completes
+inline auto adminSecuritySend(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                              uint8_t proto, uint16_t protoSpecific,
+                              std::span<uint8_t> data,
+                              NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<int>([&intf, ctrl, proto, protoSpecific, data,
+                             opts{std::move(opts)}](auto&& cb) {
+        intf.adminSecuritySend(ctrl, proto, protoSpecific, data, std::move(cb),
+                               opts);
+    });
+}
+
+inline auto adminSecurityReceive(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                                 uint8_t proto, uint16_t protoSpecific,
+                                 uint32_t transferLength,
+                                 NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<int, std::span<uint8_t>>(
+        [&intf, ctrl, proto, protoSpecific, transferLength,
+         opts{std::move(opts)}](auto&& cb) {
+        intf.adminSecurityReceive(ctrl, proto, protoSpecific, transferLength,
+                                  std::move(cb), opts);
+    });
+}
+
+// data must stay valid until the command completes
+inline auto adminXfer(NVMeMiIntf& intf, nvme_mi_ctrl_t ctrl,
+                      const nvme_mi_admin_req_hdr& adminReq,
+                      std::span<uint8_t> data, unsigned int timeoutMs,
+                      NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<nvme_mi_admin_resp_hdr, std::span<uint8_t>>(
+        [&intf, ctrl, adminReq, data, timeoutMs,
+         opts{std::move(opts)}](auto&& cb) {
+        intf.adminXfer(ctrl, adminReq, data, timeoutMs, std::move(cb), opts);
+    });
+}
+
+// cmds are copied when the batch is submitted
+inline auto submitBatch(NVMeMiIntf& intf,
+                        std::span<const NVMeMiIntf::BatchCommand> cmds,
+                        NVMeMiIntf::CommandOptions opts = {})
+{
+    return makeAwaiter<std::span<const NVMeMiIntf::BatchResult>>(
+        [&intf, cmds, opts{std::move(opts)}](auto&& cb) {
+        intf.submitBatch(cmds, std::move(cb), opts);
+    });
+}
+
+/**
+ * @brief Wait on the timer for the duration.
+ *
+ * Resumes with boost::asio::error::operation_aborted if the timer is
+ * cancelled.
+ */
+class SleepAwaiter
+{
+  public:
+    SleepAwaiter(boost::asio::steady_timer& timer,
+                 boost::asio::steady_timer::duration duration) :
+        timer(timer),
+        duration(duration)
+    {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        timer.expires_after(duration);
+        timer.async_wait([this, h](const boost::system::error_code& ec) {
+            result = ec;
+            h.resume();
+        });
+    }
+
+    boost::system::error_code await_resume() const noexcept
+    {
+        return result;
+    }
+
+  private:
+    boost::asio::steady_timer& timer;
+    boost::asio::steady_timer::duration duration;
+    boost::system::error_code result;
+};
+
+inline SleepAwaiter sleep(boost::asio::steady_timer& timer,
+                          boost::asio::steady_timer::duration duration)
+{
+    return {timer, duration};
+}
+
+} // namespace coro
@@ -0,0 +1,96 @@
+#pragma once
+#include <NVMeIntf.hpp>
+#include <PropertyBatch.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/object.hpp>
+#include <xyz/openbmc_project/Association/Definitions/server.hpp>
+#include <xyz/openbmc_project/Inventory/Decorator/Asset/server.hpp>
+#include <xyz/openbmc_project/Inventory/Item/StorageController/server.hpp>
+#include <xyz/openbmc_project/Inventory/Item/server.hpp>
+#include <xyz/openbmc_project/Software/Version/server.hpp>
+#include <xyz/openbmc_project/State/Decorator/Health/server.hpp>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+using Item = sdbusplus::xyz::openbmc_project::Inventory::server::Item;
+using Asset =
+    sdbusplus::xyz::openbmc_project::Inventory::Decorator::server::Asset;
+using Version = sdbusplus::xyz::openbmc_project::Software::server::Version;
+using Health =
+    sdbusplus::xyz::openbmc_project::State::Decorator::server::Health;
+using Associations =
+    sdbusplus::xyz::openbmc_project::Association::server::Definitions;
+using StorageController =
+    sdbusplus::xyz::openbmc_project::Inventory::Item::server::StorageController;
+
+using ControllerInterfaces =
+    sdbusplus::server::object::object<Item, StorageController, Asset, Version,
+                                      Health, Associations>;
+
+/**
+ * @brief A controller of the NVM subsystem of a drive.
+ *
+ * The handle comes from a controller scan and is only valid until the next
+ * scan. The identify data is read once per scan and cached, after which the
+ * controller is published as a StorageController below the drive. Its health
+ * follows the critical warning of its own SMART log.
+ */
+class NVMeController
+{
+  public:
+    // the cached identify controller data
+    struct Identity
+    {
+        uint16_t cntlid;
+        std::string manufacturer;
+        std::string serialNumber;
+        std::string model;
+        std::string firmware;
+        uint64_t capacity;
+        uint32_t sanicap;
+        // the warning composite temperature threshold in Kelvin, 0 if not
+        // reported
+        uint16_t wctemp;
+        // the critical composite temperature threshold in Kelvin, 0 if not
+        // reported
+        uint16_t cctemp;
+
+        bool operator==(const Identity&) const = default;
+    };
+
+    explicit NVMeController(nvme_mi_ctrl_t handle) : handle(handle)
+    {}
+
+    NVMeController(const NVMeController&) = delete;
+    NVMeController& operator=(const NVMeController&) = delete;
+
+    nvme_mi_ctrl_t getHandle() const
+    {
+        return handle;
+    }
+
+    // empty until the controller is identified
+    const std::optional<Identity>& getIdentity() const
+    {
+        return identity;
+    }
+
+    // cache the identify data and publish the controller below the drive
+    void publish(sdbusplus::bus_t& bus, const std::string& drivePath,
+                 Identity id);
+
+    void updateSmart(const NVMeMiIntf::BatchResult& result);
+
+    // signal the properties changed since the last flush
+    void flushProperties();
+
+  private:
+    nvme_mi_ctrl_t handle;
+    std::optional<Identity> identity;
+    std::unique_ptr<ControllerInterfaces> iface;
+    std::optional<PropertyBatch> changedProps;
+    // the last critical warning, 0xff before the first SMART read
+    uint8_t smartWarning = 0xff;
+};
@@ -1,5 +1,16 @@
 #pragma once
+#include <FrameArena.hpp>
+#include <MetricHistory.hpp>
+#include <NVMeAwait.hpp>
+#include <NVMeController.hpp>
 #include <NVMeMi.hpp>
+#include <NVMeMiNative.hpp>
+#include <PollInterval.hpp>
+#include <PollScheduler.hpp>
+#include <PropertyBatch.hpp>
+#include <ShadowProperty.hpp>
+#include <Task.hpp>
+#include <TemperatureSensor.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <phosphor-logging/elog-errors.hpp>
@@ -23,6 +34,9 @@
 #include <xyz/openbmc_project/State/Decorator/Health/server.hpp>
 #include <xyz/openbmc_project/State/Decorator/OperationalStatus/server.hpp>
 
+#include <deque>
+#include <limits>
+
 using Item = sdbusplus::xyz::openbmc_project::Inventory::server::Item;
 using Drive = sdbusplus::xyz::openbmc_project::Inventory::Item::server::Drive;
 using Asset =
@@ -66,25 +80,37 @@ class NVMeDevice :
   public:
     static constexpr const char* mctpEpInterface =
         "xyz.openbmc_project.MCTP.Endpoint";
+    static constexpr const char* breakerInterface =
+        "com.nvidia.Nvme.CircuitBreaker";
+    static constexpr const char* smartInterface = "com.nvidia.Nvme.SmartLog";
+    static constexpr const char* historyInterface = "com.nvidia.Nvme.History";
 
     NVMeDevice(boost::asio::io_service& io,
                sdbusplus::asio::object_server& objectServer,
                std::shared_ptr<sdbusplus::asio::connection>& dbusConnection,
-               uint8_t, uint32_t, std::vector<uint8_t>, std::string path);
+               PollScheduler& scheduler, uint8_t, uint32_t,
+               std::vector<uint8_t>, std::string path);
     ~NVMeDevice();
 
     NVMeDevice& operator=(const NVMeDevice& other) = delete;
 
     void initialize();
-    void getDriveInfo(void);
-    void getDriveLink(void);
-    void pollDrive(void);
+    // snapshot the trend history, e.g. on shutdown
+    void saveHistory();
+    // drop the queued commands and stop polling, e.g. on hot-removal
+    void stop();
+    coro::Task<> getDriveInfo();
+    coro::Task<> getDriveLink();
+    coro::Task<> pollDrive();
     void markFunctional(bool functional);
     void markStatus(std::string status);
     void generateRedfishEventbySmart(uint8_t sw);
     void updateSanitizeStatus(EraseMethod type);
 
-    std::string stripString(char* src, size_t len);
+    NVMeMiIntf::CommandOptions cmdOptions() const;
+    NVMeMiIntf::CommandOptions pollOptions() const;
+
+    std::string stripString(std::span<const uint8_t> src);
     std::string getManufacture(uint16_t vid);
     std::string driveAssociation;
 
@@ -93,6 +119,12 @@ class NVMeDevice :
         return intf;
     }
 
+    // the coroutine frames of the device are allocated from this arena
+    const std::shared_ptr<FrameArena>& frameArena() const
+    {
+        return arena;
+    }
+
     bool getDriveFunctional()
     {
         return driveFunctional;
@@ -144,42 +176,146 @@ class NVMeDevice :
     bool backupDeviceFault(bool value)
     {
         backupDeviceErr = value;
+        nextFullSmart = {};
         return value;
     }
     bool temperatureFault(bool value)
     {
         temperatureErr = value;
+        nextFullSmart = {};
         return value;
     }
     bool degradesFault(bool value)
     {
         degradesErr = value;
+        nextFullSmart = {};
         return value;
     }
     bool mediaFault(bool value)
     {
         mediaErr = value;
+        nextFullSmart = {};
         return value;
     }
     bool capacityFault(bool value)
     {
         capacityErr = value;
+        nextFullSmart = {};
         return value;
     }
 
   private:
+    // the reserved tail of the SMART log is not read
+    static constexpr size_t smartLength = offsetof(nvme_smart_log, rsvd232);
+    // the leading SMART fields read by every poll: the critical warning, the
+    // composite temperature, the spare and the percentage used, rounded up
+    // to the dword granularity of a log page read
+    static constexpr size_t smartHotLength =
+        (offsetof(nvme_smart_log, percent_used) + sizeof(uint8_t) + 3) &
+        ~size_t(3);
+
+    // the drive lifecycle: scan, identify, link info and then polling
+    coro::Task<> run(std::shared_ptr<NVMeDevice> self);
+    // identify the controllers of the scan, in batches
+    coro::Task<> identifyControllers();
+    NVMeController::Identity
+        makeIdentity(const NVMeMiIntf::BatchResult& result);
+    coro::Task<> pollSanitize();
+    coro::Task<> pollStatus();
+    // sample the composite temperature at its own rate, apart from the
+    // SMART poll
+    coro::Task<> sampleTemperature(std::shared_ptr<NVMeDevice> self);
+    // returns whether the SMART log needs to be read
+    bool updateHealth(const NVMeMiIntf::BatchResult& result);
+    void updateSmart(const NVMeMiIntf::BatchResult& result);
+    void addSmartInterface();
+    void addHistoryInterface();
+    // publish the fields read, the hot ones or the whole log
+    void updateSmartTelemetry(const NVMeMiIntf::BatchResult& result);
+    void publishAssociations(AssociationList list);
+    // signal the properties changed since the last flush, one
+    // PropertiesChanged per interface
+    void flushProperties();
+    // whether the drive needs to be polled at the minimum interval
+    bool pollUrgent() const;
+    coro::Task<> sanitize(std::shared_ptr<NVMeDevice> self,
+                          uint16_t overwritePasses, EraseMethod type);
+
     std::shared_ptr<sdbusplus::asio::connection> conn;
     sdbusplus::asio::object_server& objServer;
     boost::asio::steady_timer scanTimer;
+    boost::asio::steady_timer tempTimer;
 
     bool driveFunctional;
     uint8_t smartWarning;
+    // the composite temperature of the last health poll in Celsius
+    int8_t compositeTemp;
+    // the warning composite temperature threshold in Celsius, 0 if unknown
+    int16_t warningTemp;
+    PollInterval pollInterval;
+    std::unique_ptr<PollScheduler::Slot> pollSlot;
+    PropertyBatch changedProps;
     NVMeIntf nvmeIntf;
     std::shared_ptr<NVMeMiIntf> intf;
+    std::shared_ptr<NVMeMiIntf::CancelToken> cancelToken;
+    std::shared_ptr<FrameArena> arena;
+    // the state of the circuit breaker of the endpoint
+    std::shared_ptr<sdbusplus::asio::dbus_interface> breakerIface;
+
+    // the SMART log of the primary controller as published on smartIface,
+    // temperatures in Celsius and the 128-bit counters saturated to 64 bits
+    struct SmartTelemetry
+    {
+        // NaN while the drive doesn't report it
+        double compositeTemperature = std::numeric_limits<double>::quiet_NaN();
+        uint8_t availableSpare = 0;
+        uint8_t availableSpareThreshold = 0;
+        uint8_t percentageUsed = 0;
+        uint64_t dataUnitsRead = 0;
+        uint64_t dataUnitsWritten = 0;
+        uint64_t hostReadCommands = 0;
+        uint64_t hostWriteCommands = 0;
+        uint64_t controllerBusyTime = 0;
+        uint64_t powerCycles = 0;
+        uint64_t powerOnHours = 0;
+        uint64_t unsafeShutdowns = 0;
+        uint64_t mediaErrors = 0;
+        uint64_t errorLogEntries = 0;
+        uint32_t warningTemperatureTime = 0;
+        uint32_t criticalTemperatureTime = 0;
+        uint32_t thermalTransitions1 = 0;
+        uint32_t thermalTransitions2 = 0;
+        uint32_t thermalTime1 = 0;
+        uint32_t thermalTime2 = 0;
+    };
+    SmartTelemetry smart;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> smartIface;
+
+    // the trend history, allocated with the drive
+    std::unique_ptr<DriveHistory> history;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> historyIface;
+    std::unique_ptr<TemperatureSensor> tempSensor;
+    bool tempSampling;
     std::string driveIndex;
 
-    AssociationList assocs;
+    // the published values, compared before any set
+    ShadowProperty<bool> publishedPresent;
+    ShadowProperty<AssociationList> publishedAssocs;
+    ShadowProperty<HealthType> publishedHealth;
+    ShadowProperty<uint8_t> publishedLifeUsed;
+    ShadowProperty<NVMeController::Identity> publishedIdentity;
+    ShadowProperty<std::pair<uint32_t, uint32_t>> publishedLinkSpeed;
+    // the controllers of the last scan, the drive level data comes from the
+    // primary controller ctrl
+    std::deque<NVMeController> controllers;
     nvme_mi_ctrl_t ctrl;
+    // the SMART hot fields of every controller
+    std::vector<NVMeMiIntf::BatchCommand> pollCmds;
+    // the same with the full SMART log
+    std::vector<NVMeMiIntf::BatchCommand> fullPollCmds;
+    // the next full SMART read, it is also forced by a fault injected from
+    // D-Bus
+    std::chrono::steady_clock::time_point nextFullSmart;
     bool presence;
     bool inProgress;
     std::string objPath;
@@ -190,7 +326,9 @@ class NVMeDevice :
     // flag of no-deallocate modifies meida after sanitize(NODMMAS)
     uint32_t nodmmas;
     EraseMethod eraseType;
+    // the seconds elapsed since the sanitize started, as of the last poll
     uint32_t estimatedTime;
+    std::chrono::steady_clock::time_point sanitizeStart;
 
     // triggered the smart error from Dbus.
     bool backupDeviceErr;
@@ -1,9 +1,17 @@
 #pragma once
+#include "CircuitBreaker.hpp"
+#include "ResponseView.hpp"
+#include "UniqueFunction.hpp"
+
 #include <libnvme-mi.h>
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <span>
+#include <type_traits>
 #include <variant>
 
 class NVMeBasicIntf;
@@ -109,6 +117,164 @@ class NVMeBasicIntf
 class NVMeMiIntf
 {
   public:
+    /**
+     * @brief Scheduling class of a NVMe-MI command, in the order of
+     * precedence.
+     *
+     * Interactive: initiated by a D-Bus client, e.g. sanitize, security
+     * send/receive, raw admin transfer and telemetry.
+     * Lifecycle: drive initialization such as controller scan and identify.
+     * Background: periodical health and SMART polling.
+     */
+    enum class Priority : uint8_t
+    {
+        Interactive = 0,
+        Lifecycle,
+        Background,
+    };
+    static constexpr size_t numPriority = 3;
+
+    /**
+     * @brief Cancellation handle shared by the issuer and its commands.
+     *
+     * The commands queued with a cancelled handle are dropped before touching
+     * the bus and completed with std::errc::operation_canceled.
+     */
+    class CancelToken
+    {
+      public:
+        void cancel()
+        {
+            cancelled.store(true);
+        }
+
+        bool isCancelled() const
+        {
+            return cancelled.load();
+        }
+
+      private:
+        std::atomic<bool> cancelled{false};
+    };
+
+    /**
+     * @brief Optional per-command controls.
+     *
+     * deadline: the command is dropped with std::errc::operation_canceled if
+     * it can't be dispatched to the bus before the deadline.
+     * cancel: see CancelToken.
+     * priority: override the default scheduling class of the command.
+     */
+    struct CommandOptions
+    {
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        std::shared_ptr<const CancelToken> cancel;
+        std::optional<Priority> priority;
+    };
+
+    /**
+     * @brief State of the circuit breaker of the endpoint.
+     *
+     * While the breaker is not closed, the commands are completed with
+     * std::errc::host_unreachable without touching the bus.
+     */
+    using BreakerState = CircuitBreaker::State;
+
+    /**
+     * @brief A read command of a batch, see submitBatch().
+     */
+    struct BatchCommand
+    {
+        enum class Kind : uint8_t
+        {
+            SubsystemHealthStatusPoll,
+            GetLog,
+            Identify,
+        };
+
+        Kind kind;
+        // lid for get log page, cns for identify, whether to clear the
+        // status change flags for health status poll
+        uint8_t id;
+        uint8_t lsp;
+        // lsi for get log page, cntid for identify
+        uint16_t specific;
+        uint32_t nsid;
+        uint32_t offset;
+        uint32_t length;
+        nvme_mi_ctrl_t ctrl;
+
+        // A poll that leaves the status change flags set only samples the
+        // status, the flags are still reported by the next clearing poll.
+        static BatchCommand healthStatusPoll(bool clear = true)
+        {
+            return {Kind::SubsystemHealthStatusPoll, clear, 0, 0, 0, 0,
+                    sizeof(nvme_mi_nvm_ss_health_status), nullptr};
+        }
+
+        static BatchCommand getLog(nvme_mi_ctrl_t ctrl,
+                                   nvme_cmd_get_log_lid lid, uint32_t nsid,
+                                   uint32_t offset, uint32_t length)
+        {
+            return {Kind::GetLog, static_cast<uint8_t>(lid), 0, 0, nsid,
+                    offset, length, ctrl};
+        }
+
+        template <class T, size_t Length = sizeof(T)>
+        static BatchCommand getLog(nvme_mi_ctrl_t ctrl, uint32_t nsid)
+        {
+            return getLog(ctrl, LogPage<T>::lid, nsid, 0, Length);
+        }
+
+        template <class T, size_t Length = sizeof(T)>
+        static BatchCommand identify(nvme_mi_ctrl_t ctrl, uint32_t nsid,
+                                     uint16_t cntid)
+        {
+            return {Kind::Identify, static_cast<uint8_t>(IdentifyData<T>::cns),
+                    0, cntid, nsid, 0, Length, ctrl};
+        }
+
+        // Whether the response of the command fits length bytes, and length
+        // bytes fit the command
+        bool valid() const
+        {
+            switch (kind)
+            {
+                case Kind::SubsystemHealthStatusPoll:
+                    return length >= sizeof(nvme_mi_nvm_ss_health_status);
+                case Kind::GetLog:
+                    return length > 0;
+                case Kind::Identify:
+                    return length > 0 && length <= NVME_IDENTIFY_DATA_SIZE;
+            }
+            return false;
+        }
+    };
+
+    /**
+     * @brief The status and response data of a batch command.
+     *
+     * data is only valid within the completion callback.
+     */
+    struct BatchResult
+    {
+        std::error_code ec;
+        std::span<uint8_t> data;
+
+        // A typed view of the response, empty on failure
+        template <class T, size_t Length = sizeof(T)>
+        ResponseView<T, Length> view() const
+        {
+            if (ec || data.size() < Length)
+            {
+                return {};
+            }
+            return ResponseView<T, Length>(data);
+        }
+    };
+
+    static constexpr size_t maxBatch = 8;
+
     constexpr static std::string_view statusToString(nvme_mi_resp_status status)
     {
         switch (status)
@@ -157,48 +323,111 @@ class NVMeMiIntf
         return "";
     }
     virtual void miPCIePortInformation(
-        std::function<void(const std::error_code&,
-                           struct nvme_mi_read_port_info*)>&& cb) = 0;
+        UniqueFunction<void(const std::error_code&,
+                            struct nvme_mi_read_port_info*)>&& cb,
+        const CommandOptions& opts = {}) = 0;
     virtual void miSubsystemHealthStatusPoll(
-        std::function<void(const std::error_code&,
-                           nvme_mi_nvm_ss_health_status*)>&& cb) = 0;
+        UniqueFunction<void(const std::error_code&,
+                            nvme_mi_nvm_ss_health_status*)>&& cb,
+        const CommandOptions& opts = {}) = 0;
     virtual void
-        miScanCtrl(std::function<void(const std::error_code&,
-                                      const std::vector<nvme_mi_ctrl_t>&)>
-                       cb) = 0;
+        miScanCtrl(UniqueFunction<void(const std::error_code&,
+                                       const std::vector<nvme_mi_ctrl_t>&)>
+                       cb,
+                   const CommandOptions& opts = {}) = 0;
 
     virtual ~NVMeMiIntf() = default;
 
     virtual void adminIdentify(
         nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid,
         uint16_t cntid, uint16_t read_length,
-        std::function<void(const std::error_code&, std::span<uint8_t>)>&&
-            cb) = 0;
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+        const CommandOptions& opts = {}) = 0;
     virtual void adminGetLogPage(
         nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint32_t nsid,
         uint8_t lsp, uint16_t lsi,
-        std::function<void(const std::error_code&, std::span<uint8_t>)>&&
-            cb) = 0;
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+        const CommandOptions& opts = {}) = 0;
+
+    /**
+     * adminGetLog() - Read a byte range of a log page.
+     * @offset: log page offset (LPO) in bytes
+     * @length: number of bytes to read
+     *
+     * On success @cb receives exactly @length bytes.
+     */
+    virtual void adminGetLog(
+        nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint32_t nsid,
+        uint8_t lsp, uint16_t lsi, uint32_t offset, uint32_t length,
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+        const CommandOptions& opts = {}) = 0;
+
+    // The inline storage is smaller than the default one, so that the adapter
+    // from the raw callback is still stored inline.
+    template <class T, size_t Length = sizeof(T)>
+    using ViewCallback =
+        UniqueFunction<void(const std::error_code&, ResponseView<T, Length>),
+                       48>;
+
+    /**
+     * getLog() - Read the first Length bytes of the log page T.
+     *
+     * See LogPage for the supported log pages.
+     */
+    template <class T, size_t Length = sizeof(T)>
+    void getLog(nvme_mi_ctrl_t ctrl, uint32_t nsid,
+                std::type_identity_t<ViewCallback<T, Length>>&& cb,
+                const CommandOptions& opts = {})
+    {
+        adminGetLog(ctrl, LogPage<T>::lid, nsid, 0, 0, 0, Length,
+                    [cb{std::move(cb)}](const std::error_code& ec,
+                                        std::span<uint8_t> data) {
+            deliverView<T, Length>(cb, ec, data);
+        },
+                    opts);
+    }
+
+    /**
+     * identify() - Read the first Length bytes of the identify data T.
+     *
+     * See IdentifyData for the supported data structures.
+     */
+    template <class T, size_t Length = sizeof(T)>
+    void identify(nvme_mi_ctrl_t ctrl, uint32_t nsid, uint16_t cntid,
+                  std::type_identity_t<ViewCallback<T, Length>>&& cb,
+                  const CommandOptions& opts = {})
+    {
+        adminIdentify(ctrl, IdentifyData<T>::cns, nsid, cntid, Length,
+                      [cb{std::move(cb)}](const std::error_code& ec,
+                                          std::span<uint8_t> data) {
+            deliverView<T, Length>(cb, ec, data);
+        },
+                      opts);
+    }
+
     virtual void adminFwCommit(nvme_mi_ctrl_t ctrl, nvme_fw_commit_ca action,
                                uint8_t slot, bool bpid,
-                               std::function<void(const std::error_code&,
-                                                  nvme_status_field)>&& cb) = 0;
+                               UniqueFunction<void(const std::error_code&,
+                                                   nvme_status_field)>&& cb,
+                               const CommandOptions& opts = {}) = 0;
     virtual void adminSanitize(
         nvme_mi_ctrl_t ctrl, nvme_sanitize_sanact sanact, uint8_t owpass,
         uint32_t owpattern,
-        std::function<void(const std::error_code&, std::span<uint8_t>)>&&
-            cb) = 0;
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+        const CommandOptions& opts = {}) = 0;
 
     virtual void adminSecuritySend(
         nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
         std::span<uint8_t> data,
-        std::function<void(const std::error_code&, int nvme_status)>&& cb) = 0;
+        UniqueFunction<void(const std::error_code&, int nvme_status)>&& cb,
+        const CommandOptions& opts = {}) = 0;
 
     virtual void adminSecurityReceive(
         nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
         uint32_t transfer_length,
-        std::function<void(const std::error_code&, int nvme_status,
-                           const std::span<uint8_t> data)>&& cb) = 0;
+        UniqueFunction<void(const std::error_code&, int nvme_status,
+                            const std::span<uint8_t> data)>&& cb,
+        const CommandOptions& opts = {}) = 0;
 
     /**
      * adminXfer() -  Raw admin transfer interface.
@@ -208,6 +437,7 @@ class NVMeMiIntf
      * @timeout_ms: timeout in ms
      * @resp_data_offset: offset into request data to retrieve from controller
      * @cb: callback function after the response received.
+     * @opts: optional deadline, cancellation handle and priority
      * @ec: error code
      * @admin_resp: response header
      * @resp_data: response data payload
@@ -232,7 +462,52 @@ class NVMeMiIntf
     virtual void
         adminXfer(nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& admin_req,
                   std::span<uint8_t> data, unsigned int timeout_ms,
-                  std::function<void(const std::error_code& ec,
-                                     const nvme_mi_admin_resp_hdr& admin_resp,
-                                     std::span<uint8_t> resp_data)>&& cb) = 0;
+                  UniqueFunction<void(const std::error_code& ec,
+                                      const nvme_mi_admin_resp_hdr& admin_resp,
+                                      std::span<uint8_t> resp_data)>&& cb,
+                  const CommandOptions& opts = {}) = 0;
+
+    /**
+     * submitBatch() - Run a list of read commands back-to-back.
+     * @cmds: up to maxBatch commands, copied before the call returns
+     * @cb: called once with the status of each command, in order
+     *
+     * The commands hold the endpoint for the whole batch, so a poll cycle
+     * takes a single worker dispatch and a single completion. A failed command
+     * doesn't stop the batch. @cb reports a batch level error, e.g. a
+     * cancelled or expired batch, in its first argument, with no results.
+     * A batch with a command that isn't BatchCommand::valid() is rejected
+     * with std::errc::invalid_argument. Batched reads are not coalesced with
+     * single reads.
+     */
+    virtual void submitBatch(
+        std::span<const BatchCommand> cmds,
+        UniqueFunction<void(const std::error_code&,
+                            std::span<const BatchResult>)>&& cb,
+        const CommandOptions& opts = {}) = 0;
+
+    /**
+     * watchBreaker() - Observe the circuit breaker of the endpoint.
+     * @cb: called on the io_context with the new state on every change
+     */
+    virtual void watchBreaker(UniqueFunction<void(BreakerState)>&& cb) = 0;
+
+  private:
+    template <class T, size_t Length>
+    static void deliverView(const ViewCallback<T, Length>& cb,
+                            const std::error_code& ec,
+                            std::span<uint8_t> data)
+    {
+        if (ec)
+        {
+            cb(ec, {});
+            return;
+        }
+        if (data.size() < Length)
+        {
+            cb(std::make_error_code(std::errc::protocol_error), {});
+            return;
+        }
+        cb(ec, ResponseView<T, Length>(data));
+    }
 };
@@ -1,63 +1,100 @@
+#include "BufferPool.hpp"
+#include "LatencyEstimator.hpp"
+#include "MPSCQueue.hpp"
 #include "NVMeIntf.hpp"
 
 #include <boost/asio.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/bus.hpp>
 
+#include <array>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <optional>
 #include <thread>
+#include <unordered_map>
 
 class NVMeMi : public NVMeMiIntf, public std::enable_shared_from_this<NVMeMi>
 {
   public:
     NVMeMi(boost::asio::io_context& io,
            std::shared_ptr<sdbusplus::asio::connection> conn,
+           sdbusplus::asio::object_server& objServer, int bus,
            std::vector<uint8_t> addr, uint8_t eid);
     ~NVMeMi() override;
 
     void miPCIePortInformation(
-        std::function<void(const std::error_code&, nvme_mi_read_port_info*)>&&
-            cb) override;
+        UniqueFunction<void(const std::error_code&, nvme_mi_read_port_info*)>&&
+            cb,
+        const CommandOptions& opts = {}) override;
     void miSubsystemHealthStatusPoll(
-        std::function<void(const std::error_code&,
-                           nvme_mi_nvm_ss_health_status*)>&& cb) override;
-    void miScanCtrl(std::function<void(const std::error_code&,
-                                       const std::vector<nvme_mi_ctrl_t>&)>
-                        cb) override;
+        UniqueFunction<void(const std::error_code&,
+                            nvme_mi_nvm_ss_health_status*)>&& cb,
+        const CommandOptions& opts = {}) override;
+    void miScanCtrl(UniqueFunction<void(const std::error_code&,
+                                        const std::vector<nvme_mi_ctrl_t>&)>
+                        cb,
+                    const CommandOptions& opts = {}) override;
     void adminIdentify(nvme_mi_ctrl_t ctrl, nvme_identify_cns cns,
                        uint32_t nsid, uint16_t cntid, uint16_t read_length,
-                       std::function<void(const std::error_code&,
-                                          std::span<uint8_t>)>&& cb) override;
+                       UniqueFunction<void(const std::error_code&,
+                                           std::span<uint8_t>)>&& cb,
+                       const CommandOptions& opts = {}) override;
     void adminGetLogPage(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
                          uint32_t nsid, uint8_t lsp, uint16_t lsi,
-                         std::function<void(const std::error_code&,
-                                            std::span<uint8_t>)>&& cb) override;
+                         UniqueFunction<void(const std::error_code&,
+                                             std::span<uint8_t>)>&& cb,
+                         const CommandOptions& opts = {}) override;
+    void adminGetLog(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
+                     uint32_t nsid, uint8_t lsp, uint16_t lsi, uint32_t offset,
+                     uint32_t length,
+                     UniqueFunction<void(const std::error_code&,
+                                         std::span<uint8_t>)>&& cb,
+                     const CommandOptions& opts = {}) override;
 
     void adminSanitize(nvme_mi_ctrl_t ctrl, nvme_sanitize_sanact sanact,
                        uint8_t owpass, uint32_t owpattern,
-                       std::function<void(const std::error_code&,
-                                          std::span<uint8_t>)>&& cb) override;
+                       UniqueFunction<void(const std::error_code&,
+                                           std::span<uint8_t>)>&& cb,
+                       const CommandOptions& opts = {}) override;
 
     void adminFwCommit(
         nvme_mi_ctrl_t ctrl, nvme_fw_commit_ca action, uint8_t slot, bool bpid,
-        std::function<void(const std::error_code&, nvme_status_field)>&& cb)
-        override;
+        UniqueFunction<void(const std::error_code&, nvme_status_field)>&& cb,
+        const CommandOptions& opts = {}) override;
 
     void adminXfer(nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& admin_req,
                    std::span<uint8_t> data, unsigned int timeout_ms,
-                   std::function<void(const std::error_code&,
-                                      const nvme_mi_admin_resp_hdr&,
-                                      std::span<uint8_t>)>&& cb) override;
+                   UniqueFunction<void(const std::error_code&,
+                                       const nvme_mi_admin_resp_hdr&,
+                                       std::span<uint8_t>)>&& cb,
+                   const CommandOptions& opts = {}) override;
 
     void adminSecuritySend(nvme_mi_ctrl_t ctrl, uint8_t proto,
                            uint16_t proto_specific, std::span<uint8_t> data,
-                           std::function<void(const std::error_code&,
-                                              int nvme_status)>&& cb) override;
+                           UniqueFunction<void(const std::error_code&,
+                                               int nvme_status)>&& cb,
+                           const CommandOptions& opts = {}) override;
 
     void adminSecurityReceive(
         nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
         uint32_t transfer_length,
-        std::function<void(const std::error_code&, int nvme_status,
-                           std::span<uint8_t> data)>&& cb) override;
+        UniqueFunction<void(const std::error_code&, int nvme_status,
+                            std::span<uint8_t> data)>&& cb,
+        const CommandOptions& opts = {}) override;
+
+    void submitBatch(std::span<const BatchCommand> cmds,
+                     UniqueFunction<void(const std::error_code&,
+                                         std::span<const BatchResult>)>&& cb,
+                     const CommandOptions& opts = {}) override;
+
+    void watchBreaker(UniqueFunction<void(BreakerState)>&& cb) override;
+
+    // Whether the worker thread of an endpoint is still running. A worker
+    // goes away with the last endpoint on its bus, once the commands queued
+    // to it have completed on the io_context.
+    static bool hasWorkers();
 
   private:
     // the transfer size for nvme mi messages.
@@ -74,27 +111,213 @@ class NVMeMi : public NVMeMiIntf, public std::enable_shared_from_this<NVMeMi>
     nvme_mi_ep_t nvmeEP;
 
     int nid;
+    // the i2c bus of the endpoint, -1 if unknown
+    int bus;
     uint8_t eid;
     std::string addr;
     std::string mctpPath;
 
     std::mutex mctpMtx;
 
+    // moving average of the bus time taken by a command to this endpoint,
+    // only accessed by the worker thread.
+    std::chrono::microseconds xferTime;
+
+    // The response latency of each command type of the endpoint, keyed by
+    // miKey() or adminKey(). Only accessed by the worker thread under
+    // mctpMtx.
+    std::unordered_map<uint16_t, LatencyEstimator> latency;
+    // the libnvme timeout, used until a command type has enough samples
+    std::chrono::milliseconds defaultTimeout;
+
+    static constexpr uint16_t miKey(uint8_t opcode)
+    {
+        return opcode;
+    }
+
+    static constexpr uint16_t adminKey(uint8_t opcode)
+    {
+        return 0x100 | opcode;
+    }
+
+    struct TimedCall
+    {
+        uint16_t key;
+        std::chrono::milliseconds timeout;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Set the endpoint timeout for the next command of the type from its
+    // learned latency, or to timeoutMs if it is not zero.
+    TimedCall beginCall(uint16_t key, unsigned timeoutMs = 0);
+
+    // Record the latency and the outcome of the command started by
+    // beginCall(). A command of length bytes is split into messages of
+    // nvme_mi_xfer_size, and the timeout applies to each message. errno is
+    // preserved.
+    void endCall(const TimedCall& call, int rc, size_t length = 0);
+
+    // Stops sending commands to the endpoint while the drive is not
+    // responding. Only accessed by the worker thread.
+    CircuitBreaker breaker;
+    // the breaker state last posted to the io_context
+    BreakerState breakerState = BreakerState::Closed;
+    // only accessed by the io_context
+    UniqueFunction<void(BreakerState)> breakerObserver;
+
+    // Whether the worker may run the next command of the endpoint. Sends the
+    // probe of a half-open breaker of the endpoint or its bus. Called by the
+    // worker under mctpMtx.
+    bool admit();
+    // The state of the breaker of the bus while the bus is faulted, of the
+    // endpoint otherwise. Worker thread only.
+    BreakerState effectiveBreakerState() const;
+    // Post the effective breaker state to the io_context if it changed.
+    void publishBreaker();
+
+    // A command run by the worker. The inline storage is large enough for the
+    // lambdas of the NVMeMiIntf methods, which capture the caller's callback,
+    // so queueing a command doesn't allocate.
+    using Task = UniqueFunction<void(const std::error_code&), 192>;
+
     // A worker thread for calling NVMeMI cmd.
     class Worker
     {
       private:
-        bool workerStop;
-        std::mutex workerMtx;
-        std::condition_variable workerCv;
-        boost::asio::io_context workerIO;
+        // the maximum number of commands pending on a worker
+        static constexpr size_t queueDepth = 512;
+
+        // the number of idle transfer buffers kept by a worker
+        static constexpr size_t bufferPoolIdle = 16;
+
+        // A command waiting longer than the limit of its class is dispatched
+        // ahead of the higher classes, so background polling can't be starved
+        // by a burst of interactive commands.
+        static constexpr std::array<std::chrono::milliseconds, numPriority>
+            agingLimit{std::chrono::milliseconds::max(),
+                       std::chrono::seconds(5), std::chrono::seconds(15)};
+
+        // The credit an endpoint earns per round of the deficit round-robin.
+        static constexpr std::chrono::microseconds quantum =
+            std::chrono::milliseconds(50);
+
+        // The func is called with an empty error code to run the command, or
+        // with operation_canceled to drop it without touching the bus.
+        struct Job
+        {
+            Priority prio;
+            std::shared_ptr<NVMeMi> ep;
+            std::chrono::steady_clock::time_point enqueued;
+            std::chrono::steady_clock::time_point deadline;
+            std::shared_ptr<const CancelToken> cancel;
+            Task func;
+        };
+
+        // The commands of one endpoint in a class, and its remaining credit
+        // of bus time.
+        struct Flow
+        {
+            std::list<Job> jobs;
+            std::chrono::microseconds deficit{0};
+        };
+
+        // The endpoints of a class are serviced by deficit round-robin, with
+        // each command charged by the bus time it actually took. A drive that
+        // times out on every transfer gets no more bus time than the others.
+        struct ClassQueue
+        {
+            // the endpoints with pending commands
+            std::unordered_map<NVMeMi*, Flow> flows;
+            // the same endpoints, in round-robin order
+            std::deque<NVMeMi*> active;
+            // The nodes of the drained flows, reused by the next endpoint
+            // with commands so that the steady state doesn't allocate. A
+            // removed endpoint leaves no flow behind.
+            std::vector<std::unordered_map<NVMeMi*, Flow>::node_type> idle;
+        };
+
+        // The endpoints on one i2c bus. A failing mux or MCTP bridge takes
+        // all of them down together, which is told apart from a single dead
+        // drive by the share of the endpoints failing within faultWindow.
+        struct BusMember
+        {
+            std::weak_ptr<NVMeMi> ep;
+            std::chrono::steady_clock::time_point lastFailure;
+        };
+        struct BusHealth
+        {
+            // the endpoints seen on the bus, and their last transport failure
+            std::unordered_map<NVMeMi*, BusMember> members;
+            // open while the bus is faulted
+            CircuitBreaker breaker;
+        };
+
+        // per-class counters, updated by the worker thread and read by D-Bus
+        struct ClassStats
+        {
+            std::atomic<uint32_t> depth{0};
+            std::atomic<uint64_t> dispatched{0};
+            std::atomic<uint64_t> totalWaitUs{0};
+            std::atomic<uint64_t> maxWaitUs{0};
+        };
+
+        std::atomic<bool> workerStop;
+        // set while the worker thread is going to block on the doorbell
+        std::atomic<bool> workerIdle;
+        // eventfd to wake up the worker thread
+        int doorbell;
+        // lock-free hand-off from the producers to the worker thread
+        MPSCQueue<Job, queueDepth> queue;
+        // commands sorted by class, only accessed by the worker thread
+        std::array<ClassQueue, numPriority> pending;
+        // list nodes of the dispatched commands, recycled by enqueue()
+        std::list<Job> spare;
+        std::array<ClassStats, numPriority> stats;
+        sdbusplus::asio::object_server& objServer;
+        std::shared_ptr<sdbusplus::asio::dbus_interface> statsIface;
+        // keyed by the i2c bus, only accessed by the worker thread
+        std::unordered_map<int, BusHealth> buses;
+        // response buffers of the commands run by this worker
+        std::shared_ptr<BufferPool> bufferPool;
         std::thread thread;
 
+        void run();
+        void enqueue(Job&& job);
+        std::optional<Job> next();
+        Job dequeue(ClassQueue& cq, NVMeMi* ep);
+        void charge(const Job& job, std::chrono::microseconds elapsed);
+        // Drop a dispatched job on the io_context. It may hold the last
+        // reference to its endpoint, and ~NVMeMi may destroy this worker.
+        static void retire(Job&& job);
+        // repost the effective breaker state of the endpoints on the bus
+        void publishBus(const BusHealth& health);
+
       public:
-        Worker();
+        Worker(sdbusplus::asio::object_server& objServer, int rootBus);
         Worker(const Worker&) = delete;
         ~Worker();
-        void post(std::function<void(void)>&& func);
+        // On failure the func is left untouched for the caller to complete.
+        std::error_code post(Priority prio, std::shared_ptr<NVMeMi> ep,
+                             const CommandOptions& opts, Task& func);
+
+        // The bus fault tracking, only called by the worker thread. A bus is
+        // faulted when more than half of its endpoints, and at least two,
+        // failed within faultWindow. Its endpoints are then rejected except
+        // for a single probe after the backoff of the bus.
+        static constexpr std::chrono::seconds faultWindow{30};
+        CircuitBreaker::Admission
+            admitBus(NVMeMi& ep, std::chrono::steady_clock::time_point now);
+        void busSuccess(NVMeMi& ep);
+        void busFailure(NVMeMi& ep,
+                        std::chrono::steady_clock::time_point now);
+        BreakerState busState(int bus) const;
+
+        // An empty response buffer, which goes back to the pool once the
+        // completion callback is done with it.
+        BufferPool::Lease lease()
+        {
+            return bufferPool->lease();
+        }
     };
 
     // A map from root bus number to the Worker
@@ -105,18 +328,72 @@ class NVMeMi : public NVMeMiIntf, public std::enable_shared_from_this<NVMeMi>
     // each EP makes no sense.
     static std::map<int, std::weak_ptr<Worker>> workerMap;
 
+    // Resolve the root i2c bus of a (possibly muxed) i2c bus via sysfs. Return
+    // the bus itself if it is not behind a mux or the topology is unknown.
+    static int getRootBus(int bus);
+
     std::shared_ptr<Worker> worker;
-    void post(std::function<void(void)>&& func);
+    // Queue func to the worker. If the command can't be queued, func is
+    // called in place with the error.
+    void post(Priority prio, const CommandOptions& opts, Task&& func);
+
+    using ReadCallback =
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>;
+
+    // Identity of an admin read command. Identical reads in flight are
+    // coalesced into one transaction on the bus.
+    struct ReadKey
+    {
+        nvme_mi_ctrl_t ctrl;
+        uint8_t opcode;
+        // cns for identify, lid for get log page
+        uint8_t id;
+        uint32_t nsid;
+        // cntid for identify, lsi for get log page
+        uint16_t specific;
+        uint8_t lsp;
+        uint32_t offset;
+        uint32_t length;
+        // only the reads sharing a cancellation handle are coalesced
+        const CancelToken* cancel;
+
+        auto operator<=>(const ReadKey&) const = default;
+    };
+
+    // The callbacks waiting for each read in flight, the first one is the
+    // originator.
+    std::map<ReadKey, std::vector<ReadCallback>> inflightReads;
+    // The node of the last completed read, reused by the next read so that
+    // polling doesn't allocate a map node and a waiter list per read.
+    std::map<ReadKey, std::vector<ReadCallback>>::node_type spareRead;
+
+    // Attach cb to an identical read in flight and return true. Otherwise
+    // register cb as the originator and replace it with the callback which
+    // delivers the result to all the waiters.
+    bool coalesceRead(const ReadKey& key, ReadCallback& cb);
+
+    // The bookkeeping of a batch command, stored in the batch buffer after
+    // the commands. err is an errno value, 0 on success.
+    struct BatchSlot
+    {
+        int err;
+        uint32_t offset;
+        uint32_t length;
+    };
 
-    std::error_code try_post(std::function<void(void)>&& func);
+    // Run a batch command on the worker thread, the response is stored in buf
+    // of cmd.length bytes. Returns the errno value.
+    int runBatchCommand(const BatchCommand& cmd, uint8_t* buf);
 
     void adminIdentifyFull(
         nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid,
         uint16_t cntid,
-        std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb);
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+        const CommandOptions& opts);
 
     void adminIdentifyPartial(
         nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid,
         uint16_t cntid, uint16_t read_length,
-        std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb);
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+        const CommandOptions& opts);
 };
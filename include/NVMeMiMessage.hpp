@@ -0,0 +1,55 @@
+#pragma once
+
+#include <libnvme-mi.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * Framing of the NVMe-MI messages carried over MCTP, see NVM Express
+ * Management Interface 1.2, section 3: the message header with the command
+ * slot, and the message integrity check (MIC) trailing the message.
+ *
+ * The MCTP packetization of a message is left to the MCTP demux daemon. A
+ * message is not fragmented, see maxTransfer.
+ */
+namespace mi
+{
+
+// the first byte of a message, the MCTP message type with the integrity
+// check bit set
+constexpr uint8_t messageType = 0x80 | NVME_MI_MSGTYPE_NVME;
+constexpr size_t micSize = sizeof(uint32_t);
+
+// The largest data transfer of a single command, which fits one message. A
+// longer get log page is split into several commands, other commands are
+// rejected.
+constexpr size_t maxTransfer = 4096;
+
+// the data pointer flags of an admin request
+constexpr uint8_t adminLengthValid = 1 << 0;
+constexpr uint8_t adminOffsetValid = 1 << 1;
+
+// CRC-32C (Castagnoli) of data, as used by the MIC
+uint32_t crc32c(std::span<const uint8_t> data);
+
+// Fill the message header of a request. The response carries the command
+// slot of its request.
+void setRequestHeader(nvme_mi_msg_hdr& hdr, nvme_mi_message_type nmimt,
+                      uint8_t slot);
+
+// Store the MIC of the message into its last micSize bytes.
+void seal(std::span<uint8_t> msg);
+
+// Whether msg, MIC included, is an intact response of the message type to
+// a request in the command slot.
+bool isResponse(std::span<const uint8_t> msg, nvme_mi_message_type nmimt,
+                uint8_t slot);
+
+// The status of an admin response the way libnvme reports it: the MI status
+// tagged with NVME_STATUS_TYPE_MI if it is set, the status field of the
+// completion queue entry otherwise.
+int adminStatus(const nvme_mi_admin_resp_hdr& resp);
+
+} // namespace mi
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "BufferPool.hpp"
+#include "CircuitBreaker.hpp"
+#include "LatencyEstimator.hpp"
+#include "NVMeIntf.hpp"
+#include "NVMeMiMessage.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/asio/generic/seq_packet_protocol.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief NVMe-MI over MCTP without libnvme-mi and without a worker thread.
+ *
+ * The messages are framed here and exchanged with the MCTP demux daemon over
+ * its unix socket, as non-blocking I/O on the io_context. Waiting for a drive
+ * costs no thread, so any number of endpoints can have commands outstanding.
+ *
+ * An endpoint has a single command in flight, the others wait in one queue
+ * per scheduling class. A command which gets no response in time is failed
+ * with std::errc::timed_out, and the next command goes to the other command
+ * slot, so that a late response can't be taken for the response of the next
+ * command.
+ *
+ * The controller handles returned by miScanCtrl() are records of the
+ * endpoint, not libnvme objects, and are only valid with this endpoint.
+ *
+ * A NVMe-MI message is exchanged with the demux daemon as a whole, and the
+ * daemon splits it into MCTP packets. The message itself is not fragmented
+ * here. So a command carries at most mi::maxTransfer bytes of data either
+ * way. A longer get log page is split into several commands. Any other
+ * command with a longer transfer is rejected with std::errc::message_size.
+ */
+class NVMeMiNative :
+    public NVMeMiIntf,
+    public std::enable_shared_from_this<NVMeMiNative>
+{
+  public:
+    NVMeMiNative(boost::asio::io_context& io,
+                 std::shared_ptr<sdbusplus::asio::connection> conn,
+                 sdbusplus::asio::object_server& objServer, int bus,
+                 std::vector<uint8_t> sockName, uint8_t eid);
+    ~NVMeMiNative() override;
+
+    void miPCIePortInformation(
+        UniqueFunction<void(const std::error_code&, nvme_mi_read_port_info*)>&&
+            cb,
+        const CommandOptions& opts = {}) override;
+    void miSubsystemHealthStatusPoll(
+        UniqueFunction<void(const std::error_code&,
+                            nvme_mi_nvm_ss_health_status*)>&& cb,
+        const CommandOptions& opts = {}) override;
+    void miScanCtrl(UniqueFunction<void(const std::error_code&,
+                                        const std::vector<nvme_mi_ctrl_t>&)>
+                        cb,
+                    const CommandOptions& opts = {}) override;
+    void adminIdentify(nvme_mi_ctrl_t ctrl, nvme_identify_cns cns,
+                       uint32_t nsid, uint16_t cntid, uint16_t read_length,
+                       UniqueFunction<void(const std::error_code&,
+                                           std::span<uint8_t>)>&& cb,
+                       const CommandOptions& opts = {}) override;
+    void adminGetLogPage(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
+                         uint32_t nsid, uint8_t lsp, uint16_t lsi,
+                         UniqueFunction<void(const std::error_code&,
+                                             std::span<uint8_t>)>&& cb,
+                         const CommandOptions& opts = {}) override;
+    void adminGetLog(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
+                     uint32_t nsid, uint8_t lsp, uint16_t lsi, uint32_t offset,
+                     uint32_t length,
+                     UniqueFunction<void(const std::error_code&,
+                                         std::span<uint8_t>)>&& cb,
+                     const CommandOptions& opts = {}) override;
+
+    void adminSanitize(nvme_mi_ctrl_t ctrl, nvme_sanitize_sanact sanact,
+                       uint8_t owpass, uint32_t owpattern,
+                       UniqueFunction<void(const std::error_code&,
+                                           std::span<uint8_t>)>&& cb,
+                       const CommandOptions& opts = {}) override;
+
+    void adminFwCommit(
+        nvme_mi_ctrl_t ctrl, nvme_fw_commit_ca action, uint8_t slot, bool bpid,
+        UniqueFunction<void(const std::error_code&, nvme_status_field)>&& cb,
+        const CommandOptions& opts = {}) override;
+
+    void adminXfer(nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& admin_req,
+                   std::span<uint8_t> data, unsigned int timeout_ms,
+                   UniqueFunction<void(const std::error_code&,
+                                       const nvme_mi_admin_resp_hdr&,
+                                       std::span<uint8_t>)>&& cb,
+                   const CommandOptions& opts = {}) override;
+
+    void adminSecuritySend(nvme_mi_ctrl_t ctrl, uint8_t proto,
+                           uint16_t proto_specific, std::span<uint8_t> data,
+                           UniqueFunction<void(const std::error_code&,
+                                               int nvme_status)>&& cb,
+                           const CommandOptions& opts = {}) override;
+
+    void adminSecurityReceive(
+        nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
+        uint32_t transfer_length,
+        UniqueFunction<void(const std::error_code&, int nvme_status,
+                            std::span<uint8_t> data)>&& cb,
+        const CommandOptions& opts = {}) override;
+
+    void submitBatch(std::span<const BatchCommand> cmds,
+                     UniqueFunction<void(const std::error_code&,
+                                         std::span<const BatchResult>)>&& cb,
+                     const CommandOptions& opts = {}) override;
+
+    void watchBreaker(UniqueFunction<void(BreakerState)>&& cb) override;
+
+  private:
+    // the timeout of a command type without enough latency samples
+    static constexpr std::chrono::milliseconds defaultTimeout =
+        std::chrono::seconds(1);
+
+    // A connection to the MCTP demux daemon, shared by the endpoints behind
+    // the same socket. The messages are prefixed with the eid of the
+    // endpoint on the socket.
+    class Link : public std::enable_shared_from_this<Link>
+    {
+      public:
+        Link(boost::asio::io_context& io, const std::vector<uint8_t>& sockName);
+        Link(const Link&) = delete;
+        Link& operator=(const Link&) = delete;
+
+        bool connected() const
+        {
+            return socket.is_open();
+        }
+
+        // Deliver the messages from eid to ep, until detached
+        void attach(uint8_t eid, NVMeMiNative* ep);
+        void detach(uint8_t eid);
+
+        // A buffer for a request, which goes back to the pool once the
+        // request completes.
+        BufferPool::Lease lease()
+        {
+            return bufferPool->lease();
+        }
+
+        boost::asio::generic::seq_packet_protocol::socket socket;
+
+      private:
+        static constexpr size_t bufferPoolIdle = 16;
+        // the eid, then the largest response with its MIC
+        static constexpr size_t rxSize = 1 + sizeof(nvme_mi_admin_resp_hdr) +
+                                         mi::maxTransfer + mi::micSize;
+
+        // outlives the Link while a receive is pending
+        struct RxBuffer
+        {
+            std::array<uint8_t, rxSize> data;
+            boost::asio::socket_base::message_flags flags;
+        };
+
+        void receive();
+
+        std::shared_ptr<BufferPool> bufferPool;
+        std::shared_ptr<RxBuffer> rxBuf;
+        bool receiving = false;
+        std::unordered_map<uint8_t, NVMeMiNative*> endpoints;
+    };
+
+    // A map from the socket name to the link.
+    static std::map<std::vector<uint8_t>, std::weak_ptr<Link>> linkMap;
+
+    // Called with the error, or with the intact response message without
+    // its MIC. The message is only valid within the call.
+    using Handler = UniqueFunction<
+        void(const std::error_code&, std::span<uint8_t>), 192>;
+
+    struct Request
+    {
+        nvme_mi_message_type nmimt;
+        // see miKey() and adminKey()
+        uint16_t key;
+        // overrides the learned timeout if not zero
+        unsigned timeoutMs;
+        std::chrono::steady_clock::time_point deadline;
+        std::shared_ptr<const CancelToken> cancel;
+        // a byte for the eid, then the message with room for its MIC
+        BufferPool::Lease msg;
+        Handler handler;
+    };
+
+    // The controller behind a nvme_mi_ctrl_t handle of this endpoint
+    struct Controller
+    {
+        uint16_t id;
+    };
+
+    // A get log page split into transfers of up to mi::maxTransfer bytes,
+    // recycled across reads
+    struct LogRead
+    {
+        nvme_mi_ctrl_t ctrl;
+        nvme_cmd_get_log_lid lid;
+        uint32_t nsid;
+        uint8_t lsp;
+        uint16_t lsi;
+        uint64_t offset;
+        uint32_t length;
+        // the number of bytes read so far
+        uint32_t done;
+        Priority prio;
+        CommandOptions opts;
+        // at least length bytes, the rest is zero
+        BufferPool::Lease data;
+        UniqueFunction<void(const std::error_code&, std::span<uint8_t>)> cb;
+    };
+
+    // The state of a running batch, recycled across batches
+    struct Batch
+    {
+        std::array<BatchCommand, maxBatch> cmds;
+        std::array<BatchResult, maxBatch> results;
+        size_t count;
+        size_t next;
+        // the responses, at the offsets
+        std::array<size_t, maxBatch> offsets;
+        BufferPool::Lease data;
+        CommandOptions opts;
+        UniqueFunction<void(const std::error_code&,
+                            std::span<const BatchResult>)>
+            cb;
+    };
+
+    static constexpr uint16_t miKey(uint8_t opcode)
+    {
+        return opcode;
+    }
+
+    static constexpr uint16_t adminKey(uint8_t opcode)
+    {
+        return 0x100 | opcode;
+    }
+
+    boost::asio::io_context& io;
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+
+    uint8_t eid;
+    std::string addr;
+
+    std::shared_ptr<Link> link;
+    // the queued commands per class, and the one in flight
+    std::array<std::list<Request>, numPriority> pending;
+    std::list<Request> inflight;
+    // list nodes of the completed commands, recycled by submit()
+    std::list<Request> spare;
+    // set while a dispatch() is posted
+    bool dispatchPosted = false;
+    // the command slot of the next command
+    uint8_t slot = 0;
+    // tells the timeout of a command from the one of an earlier command
+    uint32_t sequence = 0;
+    std::chrono::steady_clock::time_point sentAt;
+    std::chrono::milliseconds sentTimeout{0};
+    boost::asio::steady_timer timer;
+
+    std::unordered_map<uint16_t, LatencyEstimator> latency;
+    CircuitBreaker breaker;
+    BreakerState breakerState = BreakerState::Closed;
+    UniqueFunction<void(BreakerState)> breakerObserver;
+
+    std::deque<Controller> ctrls;
+    std::vector<std::unique_ptr<LogRead>> spareReads;
+    std::vector<std::unique_ptr<Batch>> spareBatches;
+
+    static uint16_t ctrlId(nvme_mi_ctrl_t ctrl)
+    {
+        return reinterpret_cast<const Controller*>(ctrl)->id;
+    }
+
+    // Build the request of an MI command
+    Request miRequest(uint8_t opcode, uint32_t cdw0, uint32_t cdw1);
+    // Build the request of an admin command, data is the request data
+    Request adminRequest(nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& hdr,
+                         std::span<const uint8_t> data = {});
+    // Build the request of a get log page of up to mi::maxTransfer bytes
+    Request getLogRequest(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
+                          uint32_t nsid, uint8_t lsp, uint16_t lsi,
+                          uint64_t offset, uint32_t length);
+    Request identifyRequest(nvme_mi_ctrl_t ctrl, uint8_t cns, uint32_t nsid,
+                            uint16_t cntid, uint32_t length);
+
+    // Queue the request. The handler is never called from within submit().
+    void submit(Priority prio, const CommandOptions& opts, Request&& req);
+    // Send the next command if none is in flight
+    void dispatch();
+    void send();
+    // Complete the queued command at the head of the queue
+    void drop(std::list<Request>& queue, std::errc err);
+    // Complete the command in flight
+    void finish(const std::error_code& ec, std::span<uint8_t> msg);
+    // A message from the endpoint, truncated if it didn't fit the receive
+    // buffer
+    void onMessage(std::span<uint8_t> msg, bool truncated);
+    void publishBreaker();
+
+    // The MI status of an MI response, or -1 if it is malformed. data is set
+    // to the response data.
+    static int miStatus(std::span<uint8_t> msg, std::span<uint8_t>& data);
+    // See mi::adminStatus(), or -1 if it is malformed.
+    static int adminStatus(std::span<uint8_t> msg, std::span<uint8_t>& data);
+    // The error reported for a command which failed with ec or status
+    std::error_code check(const std::error_code& ec, int status,
+                          const char* what);
+
+    void readPort(uint8_t port, uint8_t nump,
+                  UniqueFunction<void(const std::error_code&,
+                                      nvme_mi_read_port_info*)>&& cb,
+                  const CommandOptions& opts);
+    // A cleared LogRead with an empty buffer from the pool
+    std::unique_ptr<LogRead> takeLogRead();
+    void recycle(std::unique_ptr<LogRead> read);
+    // Read the rest of the log page, one transfer at a time
+    void readLog(std::unique_ptr<LogRead> read);
+    void readTelemetry(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
+                       uint8_t lsp, uint16_t lsi,
+                       UniqueFunction<void(const std::error_code&,
+                                           std::span<uint8_t>)>&& cb,
+                       const CommandOptions& opts);
+    void runBatch(std::unique_ptr<Batch> batch);
+};
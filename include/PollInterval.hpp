@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+
+/**
+ * @brief The adaptive interval between two polls of a drive.
+ *
+ * A drive in an urgent condition, e.g. close to its warning temperature or
+ * with a critical warning, is polled at the minimum interval. Every poll
+ * that finds the drive stable doubles the interval, up to the maximum, so a
+ * drive that has been healthy for a long time leaves most of the bus
+ * bandwidth to the others.
+ */
+class PollInterval
+{
+  public:
+    PollInterval(std::chrono::seconds min, std::chrono::seconds max);
+
+    // the interval to the next poll, given the condition of the last one
+    std::chrono::seconds next(bool urgent);
+
+    std::chrono::seconds current() const
+    {
+        return interval;
+    }
+
+    // fall back to the minimum interval, e.g. after a rescan
+    void reset()
+    {
+        interval = min;
+    }
+
+  private:
+    std::chrono::seconds min;
+    std::chrono::seconds max;
+    std::chrono::seconds interval;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Spreads the polls of all the drives across the poll period.
+ *
+ * Every drive joins with a slot, and the slots get evenly spaced phase
+ * offsets within the period. A drive polls on the grid of its phase, at the
+ * first grid point at least its own poll interval after the previous poll,
+ * plus a random jitter of up to a quarter of the slot spacing. So the drives
+ * never hit the endpoint queues at the same instant, however their adaptive
+ * intervals evolve.
+ *
+ * The cycle completion time is the time from the start of a period to the
+ * completion of the last poll scheduled in it. It is published on D-Bus once
+ * the next period is under way, and exceeding the period tells that the
+ * fleet is too large for the period.
+ */
+class PollScheduler
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr const char* schedulerInterface =
+        "com.nvidia.Nvme.PollScheduler";
+
+    class Slot
+    {
+      public:
+        ~Slot();
+
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        // the time of the next poll, at least interval after the previous
+        Clock::time_point next(std::chrono::seconds interval)
+        {
+            return next(interval, Clock::now());
+        }
+        Clock::time_point next(std::chrono::seconds interval,
+                               Clock::time_point now);
+
+        // the poll scheduled by the last next() completed
+        void done()
+        {
+            done(Clock::now());
+        }
+        void done(Clock::time_point now);
+
+      private:
+        friend class PollScheduler;
+
+        explicit Slot(PollScheduler& scheduler) : scheduler(scheduler)
+        {}
+
+        PollScheduler& scheduler;
+        Clock::duration phase{};
+        // the grid point of the last scheduled poll, jitter excluded
+        Clock::time_point due{};
+        bool scheduled = false;
+    };
+
+    PollScheduler(sdbusplus::asio::object_server& objServer,
+                  const std::string& path, std::chrono::seconds period);
+    ~PollScheduler();
+
+    PollScheduler(const PollScheduler&) = delete;
+    PollScheduler& operator=(const PollScheduler&) = delete;
+
+    // The slot must not outlive the scheduler.
+    std::unique_ptr<Slot> join();
+
+    // the start of the first period, the origin of the grid of the phases
+    Clock::time_point start() const
+    {
+        return epoch;
+    }
+
+    // the cycle completion time last published, zero until the first one
+    Clock::duration cycleCompletionTime() const
+    {
+        return published;
+    }
+
+  private:
+    void leave(Slot* slot);
+    // respace the phases of the slots evenly across the period
+    void rebalance();
+    Clock::time_point schedule(Slot& slot, std::chrono::seconds interval,
+                               Clock::time_point now);
+    void complete(const Slot& slot, Clock::time_point now);
+    void publish(Clock::duration completion);
+
+    sdbusplus::asio::object_server& objServer;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+    Clock::duration period;
+    Clock::time_point epoch;
+    std::vector<Slot*> slots;
+    std::minstd_rand rng;
+    // the latest period with a completed poll and its completion time so
+    // far, and the completion time of the period before it
+    int64_t cycle = -1;
+    Clock::duration cycleCompletion{};
+    Clock::duration previousCompletion{};
+    Clock::duration published{};
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <sdbusplus/bus.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Coalesces the PropertiesChanged signals of a D-Bus object.
+ *
+ * The properties are set with the signal skipped and recorded here, then
+ * flush() emits a single PropertiesChanged per interface for all of them,
+ * e.g. at the end of a poll cycle. A property recorded several times is
+ * signalled once, with its latest value.
+ */
+class PropertyBatch
+{
+  public:
+    PropertyBatch(sdbusplus::bus_t& bus, std::string path) :
+        bus(bus), path(std::move(path))
+    {}
+
+    // interface and property are string literals, e.g. Item::interface
+    void changed(const char* interface, const char* property);
+
+    void flush();
+
+  private:
+    sdbusplus::bus_t& bus;
+    std::string path;
+    // the changed properties of every interface, the name lists are kept
+    // across flushes for reuse
+    std::vector<std::pair<const char*, std::vector<const char*>>> pending;
+};
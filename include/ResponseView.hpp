@@ -0,0 +1,117 @@
+#pragma once
+
+#include <libnvme-mi.h>
+
+#include <boost/endian/conversion.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+/**
+ * @brief Compile-time description of the log page read into T.
+ */
+template <class T>
+struct LogPage;
+
+template <>
+struct LogPage<nvme_smart_log>
+{
+    static constexpr nvme_cmd_get_log_lid lid = NVME_LOG_LID_SMART;
+};
+
+template <>
+struct LogPage<nvme_firmware_slot>
+{
+    static constexpr nvme_cmd_get_log_lid lid = NVME_LOG_LID_FW_SLOT;
+};
+
+template <>
+struct LogPage<nvme_self_test_log>
+{
+    static constexpr nvme_cmd_get_log_lid lid = NVME_LOG_LID_DEVICE_SELF_TEST;
+};
+
+template <>
+struct LogPage<nvme_sanitize_log_page>
+{
+    static constexpr nvme_cmd_get_log_lid lid = NVME_LOG_LID_SANITIZE;
+};
+
+/**
+ * @brief Compile-time description of the identify data structure T.
+ */
+template <class T>
+struct IdentifyData;
+
+template <>
+struct IdentifyData<nvme_id_ctrl>
+{
+    static constexpr nvme_identify_cns cns = NVME_IDENTIFY_CNS_CTRL;
+};
+
+/**
+ * @brief A typed view of the first Length bytes of a response holding T.
+ *
+ * The view refers to the response buffer without copying, and is only valid
+ * within the completion callback. Only the bytes that were actually read can
+ * be accessed: a field outside of the first Length bytes fails to compile.
+ * The whole structure is only accessible if it was completely read.
+ */
+template <class T, size_t Length = sizeof(T)>
+class ResponseView
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    static_assert(Length > 0 && Length <= sizeof(T),
+                  "read length exceeds the response structure");
+    // the response buffers are allocated by operator new[]
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+
+  public:
+    static constexpr size_t length = Length;
+
+    ResponseView() = default;
+
+    // The producer guarantees raw holds at least Length bytes.
+    explicit ResponseView(std::span<const uint8_t> raw) : raw(raw.data())
+    {}
+
+    explicit operator bool() const
+    {
+        return raw != nullptr;
+    }
+
+    // A little-endian integer field at Offset, in native byte order
+    template <size_t Offset, class F>
+        requires(std::is_integral_v<F> && Offset + sizeof(F) <= Length)
+    F get() const
+    {
+        F value;
+        std::memcpy(&value, raw + Offset, sizeof(F));
+        return boost::endian::little_to_native(value);
+    }
+
+    // The raw bytes of a field at Offset
+    template <size_t Offset, size_t Size>
+        requires(Offset + Size <= Length)
+    std::span<const uint8_t, Size> bytes() const
+    {
+        return std::span<const uint8_t, Size>(raw + Offset, Size);
+    }
+
+    const T* operator->() const
+        requires(Length == sizeof(T))
+    {
+        return reinterpret_cast<const T*>(raw);
+    }
+
+    const T& operator*() const
+        requires(Length == sizeof(T))
+    {
+        return *reinterpret_cast<const T*>(raw);
+    }
+
+  private:
+    const uint8_t* raw = nullptr;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+
+/**
+ * @brief The last published value of a D-Bus property, or of a group of
+ * properties derived from the same source.
+ *
+ * The value is compared before anything is set, so a stable drive neither
+ * rebuilds nor sets its properties and no PropertiesChanged is emitted.
+ */
+template <class T>
+class ShadowProperty
+{
+  public:
+    // Record value, and tell whether it differs from the published one.
+    bool update(const T& value)
+    {
+        if (published && *published == value)
+        {
+            return false;
+        }
+        published = value;
+        return true;
+    }
+
+    // force the next update to publish, e.g. after the object is re-added
+    void reset()
+    {
+        published.reset();
+    }
+
+  private:
+    std::optional<T> published;
+};
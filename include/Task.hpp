@@ -0,0 +1,278 @@
+#pragma once
+
+#include "FrameArena.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cassert>
+#include <concepts>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace coro
+{
+
+template <class T = void>
+class Task;
+
+// An object whose member coroutines allocate their frames from its arena
+template <class T>
+concept HasFrameArena = requires(T& t) {
+    {
+        t.frameArena()
+    } -> std::convertible_to<const std::shared_ptr<FrameArena>&>;
+};
+
+namespace detail
+{
+
+class PromiseBase
+{
+  public:
+    // A member coroutine of an object with a frame arena, e.g.
+    // NVMeDevice::pollDrive(), gets its frame from the arena of the object.
+    template <HasFrameArena Self, class... Args>
+    static void* operator new(size_t size, Self& self, Args&...)
+    {
+        return FrameArena::allocateFrame(self.frameArena(), size);
+    }
+
+    static void* operator new(size_t size)
+    {
+        return FrameArena::allocateFrame(nullptr, size);
+    }
+
+    static void operator delete(void* frame, size_t size) noexcept
+    {
+        FrameArena::deallocateFrame(frame, size);
+    }
+
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template <class Promise>
+        std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            std::coroutine_handle<> continuation = h.promise().continuation;
+            if (continuation)
+            {
+                return continuation;
+            }
+            // a detached task owns its frame
+            h.destroy();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception() noexcept
+    {
+        if (continuation)
+        {
+            exception = std::current_exception();
+            return;
+        }
+        // Nobody awaits a detached task. The exception ends it, and its
+        // frame is freed by final_suspend().
+        try
+        {
+            throw;
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("detached coroutine failed: {MSG}", "MSG", e.what());
+        }
+        catch (...)
+        {
+            lg2::error("detached coroutine failed with an unknown exception");
+        }
+    }
+
+    std::coroutine_handle<> continuation;
+
+  protected:
+    void rethrow()
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+
+  private:
+    std::exception_ptr exception;
+};
+
+template <class T>
+class Promise : public PromiseBase
+{
+  public:
+    Task<T> get_return_object() noexcept;
+
+    template <class U>
+        requires std::is_convertible_v<U&&, T>
+    void return_value(U&& v)
+    {
+        value.emplace(std::forward<U>(v));
+    }
+
+    T result()
+    {
+        rethrow();
+        return std::move(*value);
+    }
+
+  private:
+    std::optional<T> value;
+};
+
+template <>
+class Promise<void> : public PromiseBase
+{
+  public:
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result()
+    {
+        rethrow();
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief A lazily started coroutine returning T.
+ *
+ * The task starts running when it is co_awaited, and resumes the awaiting
+ * coroutine on completion by symmetric transfer. A top level task is started
+ * by spawn(). The commands are completed on the io_context, so the
+ * coroutines run on the io_context thread like the callbacks do.
+ */
+template <class T>
+class [[nodiscard]] Task
+{
+  public:
+    using promise_type = detail::Promise<T>;
+
+    Task() = default;
+
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            std::coroutine_handle<promise_type> h;
+
+            bool await_ready() noexcept
+            {
+                // an empty task, e.g. a moved-from one, has no result
+                assert(h && "co_await on an empty coro::Task");
+                return h.done();
+            }
+
+            std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<> caller) noexcept
+            {
+                h.promise().continuation = caller;
+                return h;
+            }
+
+            T await_resume()
+            {
+                return h.promise().result();
+            }
+        };
+        return Awaiter{handle};
+    }
+
+    // Give up the ownership of the frame
+    std::coroutine_handle<promise_type> release() noexcept
+    {
+        return std::exchange(handle, {});
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+namespace detail
+{
+
+template <class T>
+Task<T> Promise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept
+{
+    return Task<void>(
+        std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/**
+ * @brief Start a detached task, which frees itself on completion.
+ *
+ * The task runs until its first suspension before spawn() returns.
+ */
+inline void spawn(Task<>&& task)
+{
+    auto h = task.release();
+    if (h)
+    {
+        h.resume();
+    }
+}
+
+} // namespace coro
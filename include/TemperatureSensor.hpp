@@ -0,0 +1,60 @@
+#pragma once
+#include <PropertyBatch.hpp>
+#include <ShadowProperty.hpp>
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/object.hpp>
+#include <xyz/openbmc_project/Association/Definitions/server.hpp>
+#include <xyz/openbmc_project/Sensor/Threshold/Critical/server.hpp>
+#include <xyz/openbmc_project/Sensor/Threshold/Warning/server.hpp>
+#include <xyz/openbmc_project/Sensor/Value/server.hpp>
+
+#include <memory>
+#include <optional>
+#include <string>
+
+using SensorValue = sdbusplus::xyz::openbmc_project::Sensor::server::Value;
+using WarningThreshold =
+    sdbusplus::xyz::openbmc_project::Sensor::Threshold::server::Warning;
+using CriticalThreshold =
+    sdbusplus::xyz::openbmc_project::Sensor::Threshold::server::Critical;
+using Associations =
+    sdbusplus::xyz::openbmc_project::Association::server::Definitions;
+
+using SensorInterfaces =
+    sdbusplus::server::object::object<SensorValue, WarningThreshold,
+                                      CriticalThreshold, Associations>;
+
+/**
+ * @brief The composite temperature sensor of a drive.
+ *
+ * The sensor is published below /xyz/openbmc_project/sensors/temperature and
+ * associated with the drive. Its value is NaN while no reading is available,
+ * so that a fan controller falls back to its failsafe. The thresholds are
+ * the warning and critical composite temperatures reported by the drive.
+ */
+class TemperatureSensor
+{
+  public:
+    TemperatureSensor(sdbusplus::bus_t& bus, const std::string& name,
+                      const std::string& drivePath);
+
+    TemperatureSensor(const TemperatureSensor&) = delete;
+    TemperatureSensor& operator=(const TemperatureSensor&) = delete;
+
+    // the thresholds in Celsius, empty if not reported by the drive
+    void setThresholds(std::optional<int16_t> warning,
+                       std::optional<int16_t> critical);
+
+    // a reading in Celsius, empty if unavailable
+    void update(std::optional<int16_t> celsius);
+
+  private:
+    void updateAlarms();
+
+    std::unique_ptr<SensorInterfaces> iface;
+    PropertyBatch changedProps;
+    ShadowProperty<std::optional<int16_t>> publishedValue;
+    std::optional<int16_t> reading;
+    std::optional<int16_t> warningHigh;
+    std::optional<int16_t> criticalHigh;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <class Signature, size_t BufSize = 64>
+class UniqueFunction;
+
+/**
+ * @brief A move-only type-erased callable with small buffer storage.
+ *
+ * Similar to std::move_only_function, but callable through a const
+ * reference like std::function. A callable no larger than BufSize, and
+ * nothrow move constructible, is stored inline so that constructing and
+ * moving the wrapper never allocates. A larger callable falls back to the
+ * heap.
+ */
+template <class R, class... Args, size_t BufSize>
+class UniqueFunction<R(Args...), BufSize>
+{
+  public:
+    UniqueFunction() noexcept = default;
+
+    UniqueFunction(std::nullptr_t) noexcept {}
+
+    template <class F>
+        requires(!std::is_same_v<std::remove_cvref_t<F>, UniqueFunction> &&
+                 std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    UniqueFunction(F&& f)
+    {
+        using T = std::decay_t<F>;
+        if constexpr (isLocal<T>)
+        {
+            new (storage) T(std::forward<F>(f));
+            ops = &localOps<T>;
+        }
+        else
+        {
+            *reinterpret_cast<T**>(storage) = new T(std::forward<F>(f));
+            ops = &heapOps<T>;
+        }
+    }
+
+    UniqueFunction(UniqueFunction&& other) noexcept : ops(other.ops)
+    {
+        if (ops != nullptr)
+        {
+            ops->move(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    UniqueFunction& operator=(UniqueFunction&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            if (other.ops != nullptr)
+            {
+                other.ops->move(storage, other.storage);
+                ops = std::exchange(other.ops, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    UniqueFunction& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    UniqueFunction(const UniqueFunction&) = delete;
+    UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+    ~UniqueFunction()
+    {
+        reset();
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops != nullptr;
+    }
+
+    R operator()(Args... args) const
+    {
+        if (ops == nullptr)
+        {
+            throw std::bad_function_call();
+        }
+        return ops->invoke(storage, std::forward<Args>(args)...);
+    }
+
+  private:
+    struct Ops
+    {
+        R (*invoke)(std::byte*, Args&&...);
+        // move-construct dst from src and destroy src
+        void (*move)(std::byte* dst, std::byte* src) noexcept;
+        void (*destroy)(std::byte*) noexcept;
+    };
+
+    template <class T>
+    static constexpr bool isLocal =
+        sizeof(T) <= BufSize && alignof(T) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<T>;
+
+    template <class T>
+    static constexpr Ops localOps{
+        [](std::byte* s, Args&&... args) -> R {
+            return std::invoke(*std::launder(reinterpret_cast<T*>(s)),
+                               std::forward<Args>(args)...);
+        },
+        [](std::byte* dst, std::byte* src) noexcept {
+            T* from = std::launder(reinterpret_cast<T*>(src));
+            new (dst) T(std::move(*from));
+            from->~T();
+        },
+        [](std::byte* s) noexcept {
+            std::launder(reinterpret_cast<T*>(s))->~T();
+        }};
+
+    template <class T>
+    static constexpr Ops heapOps{
+        [](std::byte* s, Args&&... args) -> R {
+            return std::invoke(**reinterpret_cast<T**>(s),
+                               std::forward<Args>(args)...);
+        },
+        [](std::byte* dst, std::byte* src) noexcept {
+            *reinterpret_cast<T**>(dst) = *reinterpret_cast<T**>(src);
+        },
+        [](std::byte* s) noexcept { delete *reinterpret_cast<T**>(s); }};
+
+    void reset() noexcept
+    {
+        if (ops != nullptr)
+        {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+    static_assert(BufSize >= sizeof(void*));
+
+    const Ops* ops = nullptr;
+    alignas(std::max_align_t) mutable std::byte storage[BufSize];
+};
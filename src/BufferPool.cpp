@@ -0,0 +1,112 @@
+#include "BufferPool.hpp"
+
+#include <cstring>
+#include <utility>
+
+BufferPool::BufferPool(size_t maxIdle) : maxIdle(maxIdle)
+{
+    // put() must not allocate
+    idle.reserve(maxIdle);
+}
+
+BufferPool::Lease BufferPool::lease()
+{
+    return Lease(shared_from_this());
+}
+
+std::unique_ptr<uint8_t[]> BufferPool::get()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!idle.empty())
+        {
+            auto slab = std::move(idle.back());
+            idle.pop_back();
+            return slab;
+        }
+    }
+    return std::make_unique_for_overwrite<uint8_t[]>(slabSize);
+}
+
+void BufferPool::put(std::unique_ptr<uint8_t[]> slab) noexcept
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (idle.size() < maxIdle)
+    {
+        idle.push_back(std::move(slab));
+    }
+}
+
+BufferPool::Lease::Lease(std::shared_ptr<BufferPool> pool) :
+    pool(std::move(pool))
+{}
+
+BufferPool::Lease::Lease(Lease&& other) noexcept :
+    pool(std::move(other.pool)), buf(std::move(other.buf)),
+    len(std::exchange(other.len, 0)),
+    capacity(std::exchange(other.capacity, 0)),
+    pooled(std::exchange(other.pooled, false))
+{}
+
+BufferPool::Lease& BufferPool::Lease::operator=(Lease&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pool = std::move(other.pool);
+        buf = std::move(other.buf);
+        len = std::exchange(other.len, 0);
+        capacity = std::exchange(other.capacity, 0);
+        pooled = std::exchange(other.pooled, false);
+    }
+    return *this;
+}
+
+BufferPool::Lease::~Lease()
+{
+    release();
+}
+
+void BufferPool::Lease::release() noexcept
+{
+    if (pooled && pool)
+    {
+        pool->put(std::move(buf));
+    }
+    buf.reset();
+    len = 0;
+    capacity = 0;
+    pooled = false;
+}
+
+void BufferPool::Lease::resize(size_t size)
+{
+    if (size > capacity)
+    {
+        std::unique_ptr<uint8_t[]> grown;
+        bool fromPool = pool && size <= slabSize;
+        if (fromPool)
+        {
+            grown = pool->get();
+        }
+        else
+        {
+            grown = std::make_unique_for_overwrite<uint8_t[]>(size);
+        }
+        if (len > 0)
+        {
+            std::memcpy(grown.get(), buf.get(), len);
+        }
+        size_t kept = len;
+        release();
+        buf = std::move(grown);
+        capacity = fromPool ? slabSize : size;
+        pooled = fromPool;
+        len = kept;
+    }
+    if (size > len)
+    {
+        std::memset(buf.get() + len, 0, size - len);
+    }
+    len = size;
+}
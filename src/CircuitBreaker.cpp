@@ -0,0 +1,63 @@
+#include "CircuitBreaker.hpp"
+
+#include <algorithm>
+
+CircuitBreaker::CircuitBreaker() : rng(std::random_device{}()) {}
+
+CircuitBreaker::Admission CircuitBreaker::admit(Clock::time_point now)
+{
+    switch (current)
+    {
+        case State::Closed:
+            return Admission::Pass;
+        case State::Open:
+            if (now < retryAt)
+            {
+                return Admission::Reject;
+            }
+            current = State::HalfOpen;
+            return Admission::Probe;
+        case State::HalfOpen:
+            // the probe is in flight
+            return Admission::Reject;
+    }
+    return Admission::Reject;
+}
+
+void CircuitBreaker::success()
+{
+    current = State::Closed;
+    failures = 0;
+    backoff = initialBackoff;
+}
+
+void CircuitBreaker::failure(Clock::time_point now)
+{
+    if (current == State::HalfOpen)
+    {
+        backoff = std::min(backoff * 2, maxBackoff);
+        open(now);
+        return;
+    }
+    if (current == State::Closed && ++failures >= failureThreshold)
+    {
+        open(now);
+    }
+}
+
+void CircuitBreaker::trip(Clock::time_point now)
+{
+    if (current == State::Closed)
+    {
+        open(now);
+    }
+}
+
+void CircuitBreaker::open(Clock::time_point now)
+{
+    // a random wait between half and the whole backoff
+    std::uniform_int_distribution<int64_t> dist(backoff.count() / 2,
+                                                backoff.count());
+    current = State::Open;
+    retryAt = now + std::chrono::milliseconds(dist(rng));
+}
@@ -0,0 +1,98 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <new>
+#include <utility>
+
+namespace
+{
+
+// The frame is prefixed with a header holding the owning arena, padded to
+// keep the frame aligned as operator new would.
+struct FrameHeader
+{
+    std::shared_ptr<FrameArena> arena;
+};
+
+constexpr size_t headerSize =
+    (sizeof(FrameHeader) + __STDCPP_DEFAULT_NEW_ALIGNMENT__ - 1) /
+    __STDCPP_DEFAULT_NEW_ALIGNMENT__ * __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+} // namespace
+
+FrameArena::~FrameArena()
+{
+    for (FreeBlock* head : freeLists)
+    {
+        while (head != nullptr)
+        {
+            FreeBlock* next = head->next;
+            ::operator delete(head);
+            head = next;
+        }
+    }
+}
+
+size_t FrameArena::sizeClass(size_t size)
+{
+    size_t block = std::bit_ceil(std::max(size, minBlock));
+    return static_cast<size_t>(std::countr_zero(block) -
+                               std::countr_zero(minBlock));
+}
+
+void* FrameArena::allocate(size_t size)
+{
+    if (size > maxBlock)
+    {
+        return ::operator new(size);
+    }
+
+    size_t cls = sizeClass(size);
+    FreeBlock* block = freeLists[cls];
+    if (block != nullptr)
+    {
+        freeLists[cls] = block->next;
+        return block;
+    }
+    return ::operator new(minBlock << cls);
+}
+
+void FrameArena::deallocate(void* block, size_t size) noexcept
+{
+    if (size > maxBlock)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    size_t cls = sizeClass(size);
+    freeLists[cls] = new (block) FreeBlock{freeLists[cls]};
+}
+
+void* FrameArena::allocateFrame(const std::shared_ptr<FrameArena>& arena,
+                                size_t size)
+{
+    size_t total = size + headerSize;
+    void* block = arena ? arena->allocate(total) : ::operator new(total);
+    new (block) FrameHeader{arena};
+    return static_cast<std::byte*>(block) + headerSize;
+}
+
+void FrameArena::deallocateFrame(void* frame, size_t size) noexcept
+{
+    void* block = static_cast<std::byte*>(frame) - headerSize;
+    auto* header = std::launder(static_cast<FrameHeader*>(block));
+    std::shared_ptr<FrameArena> arena = std::move(header->arena);
+    header->~FrameHeader();
+
+    size_t total = size + headerSize;
+    if (arena)
+    {
+        arena->deallocate(block, total);
+    }
+    else
+    {
+        ::operator delete(block);
+    }
+}
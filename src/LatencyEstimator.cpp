@@ -0,0 +1,43 @@
+#include "LatencyEstimator.hpp"
+
+#include <algorithm>
+#include <limits>
+
+void LatencyEstimator::record(std::chrono::microseconds sample)
+{
+    auto us = std::clamp<int64_t>(sample.count(), 0,
+                                  std::numeric_limits<uint32_t>::max());
+    samples[next] = static_cast<uint32_t>(us);
+    next = (next + 1) % window;
+    count = std::min(count + 1, window);
+
+    if (count == 1)
+    {
+        ewma = std::chrono::microseconds(us);
+    }
+    else
+    {
+        ewma = (ewma * 7 + std::chrono::microseconds(us)) / 8;
+    }
+
+    std::array<uint32_t, window> sorted = samples;
+    size_t rank = (count * tailPercent + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + rank,
+                     sorted.begin() + count);
+    tail = std::chrono::microseconds(sorted[rank]);
+}
+
+std::chrono::milliseconds
+    LatencyEstimator::timeout(std::chrono::milliseconds fallback,
+                              std::chrono::milliseconds floor,
+                              std::chrono::milliseconds ceiling) const
+{
+    if (count < minSamples)
+    {
+        return std::clamp(fallback, floor, ceiling);
+    }
+    auto estimate = std::max(ewma * meanFactor, tail * tailFactor);
+    return std::clamp(
+        std::chrono::ceil<std::chrono::milliseconds>(estimate), floor,
+        ceiling);
+}
@@ -0,0 +1,309 @@
+#include "MetricHistory.hpp"
+
+#include <boost/endian/conversion.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+
+// the snapshot is local to the BMC, so it is in host byte order
+constexpr uint32_t snapshotMagic = 0x484d564e;
+constexpr uint32_t snapshotVersion = 1;
+// a change of the capacities invalidates the snapshots
+constexpr uint32_t snapshotLayout = sizeof(MetricHistory);
+
+constexpr uint32_t minuteWidth = 60;
+constexpr uint32_t hourWidth = 60 * 60;
+
+template <class T>
+void write(std::ostream& os, const T& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class T>
+bool read(std::istream& is, T& value)
+{
+    return static_cast<bool>(
+        is.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+void packValue(std::vector<uint8_t>& out, uint32_t value)
+{
+    value = boost::endian::native_to_little(value);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+void packSample(std::vector<uint8_t>& out, const MetricHistory::Sample& sample)
+{
+    packValue(out, sample.time);
+    packValue(out, std::bit_cast<uint32_t>(sample.min));
+    packValue(out, std::bit_cast<uint32_t>(sample.max));
+    packValue(out, std::bit_cast<uint32_t>(sample.mean));
+}
+
+} // namespace
+
+template <size_t N>
+void MetricHistory::Ring<N>::push(const Sample& sample)
+{
+    samples[(head + count) % N] = sample;
+    if (count < N)
+    {
+        count++;
+    }
+    else
+    {
+        head = (head + 1) % N;
+    }
+}
+
+template <size_t N>
+void MetricHistory::Ring<N>::pack(std::vector<uint8_t>& out) const
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        packSample(out, samples[(head + i) % N]);
+    }
+}
+
+std::optional<MetricHistory::Sample>
+    MetricHistory::Bucket::add(const Sample& sample, uint32_t width)
+{
+    std::optional<Sample> done;
+    uint32_t bucketStart = sample.time - sample.time % width;
+    if (count != 0 && bucketStart != start)
+    {
+        done = this->sample();
+        count = 0;
+    }
+    if (count == 0)
+    {
+        start = bucketStart;
+        min = sample.min;
+        max = sample.max;
+        sum = 0;
+    }
+    min = std::min(min, sample.min);
+    max = std::max(max, sample.max);
+    sum += sample.mean;
+    count++;
+    return done;
+}
+
+MetricHistory::Sample MetricHistory::Bucket::sample() const
+{
+    return {start, min, max, static_cast<float>(sum / count)};
+}
+
+void MetricHistory::add(uint32_t time, float value)
+{
+    Sample sample{time, value, value, value};
+    raw.push(sample);
+    if (auto minuteDone = minuteBucket.add(sample, minuteWidth))
+    {
+        minute.push(*minuteDone);
+        if (auto hourDone = hourBucket.add(*minuteDone, hourWidth))
+        {
+            hour.push(*hourDone);
+        }
+    }
+}
+
+std::vector<uint8_t> MetricHistory::query(Tier tier) const
+{
+    std::vector<uint8_t> out;
+    switch (tier)
+    {
+        case Tier::Raw:
+            out.reserve(raw.count * packedSize);
+            raw.pack(out);
+            break;
+        case Tier::Minute:
+            out.reserve((minute.count + 1) * packedSize);
+            minute.pack(out);
+            if (minuteBucket.count != 0)
+            {
+                packSample(out, minuteBucket.sample());
+            }
+            break;
+        case Tier::Hour:
+            out.reserve((hour.count + 1) * packedSize);
+            hour.pack(out);
+            if (hourBucket.count != 0)
+            {
+                packSample(out, hourBucket.sample());
+            }
+            break;
+    }
+    return out;
+}
+
+void MetricHistory::save(std::ostream& os) const
+{
+    write(os, raw);
+    write(os, minute);
+    write(os, hour);
+    write(os, minuteBucket);
+    write(os, hourBucket);
+}
+
+bool MetricHistory::load(std::istream& is)
+{
+    if (!read(is, raw) || !read(is, minute) || !read(is, hour) ||
+        !read(is, minuteBucket) || !read(is, hourBucket))
+    {
+        return false;
+    }
+    return raw.head < rawCapacity && raw.count <= rawCapacity &&
+           minute.head < minuteCapacity && minute.count <= minuteCapacity &&
+           hour.head < hourCapacity && hour.count <= hourCapacity;
+}
+
+std::optional<DriveHistory::Metric>
+    DriveHistory::metricFromString(std::string_view name)
+{
+    if (name == "Temperature")
+    {
+        return Metric::Temperature;
+    }
+    if (name == "LifeUsed")
+    {
+        return Metric::LifeUsed;
+    }
+    if (name == "AvailableSpare")
+    {
+        return Metric::AvailableSpare;
+    }
+    if (name == "MediaErrors")
+    {
+        return Metric::MediaErrors;
+    }
+    if (name == "ErrorLogEntries")
+    {
+        return Metric::ErrorLogEntries;
+    }
+    return std::nullopt;
+}
+
+std::optional<MetricHistory::Tier>
+    DriveHistory::tierFromString(std::string_view name)
+{
+    if (name == "Raw")
+    {
+        return MetricHistory::Tier::Raw;
+    }
+    if (name == "Minute")
+    {
+        return MetricHistory::Tier::Minute;
+    }
+    if (name == "Hour")
+    {
+        return MetricHistory::Tier::Hour;
+    }
+    return std::nullopt;
+}
+
+void DriveHistory::add(Metric metric, float value)
+{
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto time = std::chrono::duration_cast<std::chrono::seconds>(now);
+    metrics[static_cast<size_t>(metric)].add(
+        static_cast<uint32_t>(time.count()), value);
+}
+
+void DriveHistory::load(const std::string& driveSerial)
+{
+    if (serial != driveSerial)
+    {
+        // another drive in the slot, its history starts over
+        metrics.fill(MetricHistory{});
+    }
+    serial = driveSerial;
+
+    std::ifstream is(file, std::ios::binary);
+    if (!is)
+    {
+        return;
+    }
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t layout = 0;
+    uint32_t length = 0;
+    if (!read(is, magic) || !read(is, version) || !read(is, layout) ||
+        !read(is, length) || magic != snapshotMagic ||
+        version != snapshotVersion || layout != snapshotLayout ||
+        length != serial.size())
+    {
+        lg2::info("ignore the history snapshot {FILE}", "FILE", file);
+        return;
+    }
+    std::string saved(length, '\0');
+    if (!is.read(saved.data(), length) || saved != serial)
+    {
+        // the snapshot of another drive
+        lg2::info("ignore the history snapshot {FILE}", "FILE", file);
+        return;
+    }
+
+    // the histories are too large for the stack
+    auto loaded = std::make_unique<std::array<MetricHistory, numMetric>>();
+    for (auto& metric : *loaded)
+    {
+        if (!metric.load(is))
+        {
+            lg2::error("corrupted history snapshot {FILE}", "FILE", file);
+            return;
+        }
+    }
+    metrics = *loaded;
+}
+
+void DriveHistory::save() const
+{
+    if (serial.empty())
+    {
+        // the drive was never identified
+        return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(
+        std::filesystem::path(file).parent_path(), ec);
+    std::string tmp = file + ".tmp";
+    {
+        std::ofstream os(tmp, std::ios::binary | std::ios::trunc);
+        write(os, snapshotMagic);
+        write(os, snapshotVersion);
+        write(os, snapshotLayout);
+        write(os, static_cast<uint32_t>(serial.size()));
+        os.write(serial.data(), static_cast<std::streamsize>(serial.size()));
+        for (const auto& metric : metrics)
+        {
+            metric.save(os);
+        }
+        if (!os.flush())
+        {
+            lg2::error("fail to save the history snapshot {FILE}", "FILE",
+                       file);
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    // replace the previous snapshot atomically
+    std::filesystem::rename(tmp, file, ec);
+    if (ec)
+    {
+        lg2::error("fail to save the history snapshot {FILE}: {MSG}", "FILE",
+                   file, "MSG", ec.message());
+    }
+}
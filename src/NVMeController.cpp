@@ -0,0 +1,63 @@
+#include <NVMeController.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+void NVMeController::publish(sdbusplus::bus_t& bus,
+                             const std::string& drivePath, Identity id)
+{
+    auto path = drivePath + "/controllers/" + std::to_string(id.cntlid);
+    changedProps.emplace(bus, path);
+    iface = std::make_unique<ControllerInterfaces>(
+        bus, path.c_str(), ControllerInterfaces::action::defer_emit);
+
+    iface->Item::present(true, true);
+    iface->Item::prettyName("Controller " + std::to_string(id.cntlid), true);
+    iface->Asset::manufacturer(id.manufacturer, true);
+    iface->Asset::serialNumber(id.serialNumber, true);
+    iface->Asset::model(id.model, true);
+    iface->Version::version(id.firmware, true);
+    iface->Health::health(Health::HealthType::OK, true);
+    iface->Associations::associations(
+        {{"drive", "storage_controller", drivePath}});
+    iface->emit_object_added();
+
+    identity = std::move(id);
+}
+
+void NVMeController::updateSmart(const NVMeMiIntf::BatchResult& result)
+{
+    // only the critical warning of the SMART log is of interest here
+    constexpr size_t length = offsetof(nvme_smart_log, critical_warning) +
+                              sizeof(uint8_t);
+
+    if (!iface)
+    {
+        return;
+    }
+    if (result.ec)
+    {
+        lg2::error("fail to query SMART for the controller {CNTLID} "
+                   "{ERR}:{MSG}",
+                   "CNTLID", identity->cntlid, "ERR", result.ec.value(),
+                   "MSG", result.ec.message());
+        return;
+    }
+    auto smart = result.view<nvme_smart_log, length>();
+    auto cw = smart.get<offsetof(nvme_smart_log, critical_warning), uint8_t>();
+    if (cw == smartWarning)
+    {
+        return;
+    }
+    smartWarning = cw;
+    iface->Health::health(cw != 0 ? Health::HealthType::Warning
+                                  : Health::HealthType::OK,
+                          true);
+    changedProps->changed(Health::interface, "Health");
+}
+
+void NVMeController::flushProperties()
+{
+    if (changedProps)
+    {
+        changedProps->flush();
+    }
+}
@@ -1,13 +1,19 @@
 #include <nvme-mi_config.h>
 
 #include <NVMeDevice.hpp>
-#include <boost/multiprecision/cpp_int.hpp>
+#include <boost/endian/conversion.hpp>
 #include <dbusutil.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <array>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <tuple>
 
 const std::string driveFailureResolution{
     "Ensure all cables are properly and securely connected. Ensure all drives "
@@ -25,33 +31,183 @@ const std::string redfishDriveName{"NVMe Drive"};
 const std::string driveConfig{"/usr/share/nvidia-nvme-manager/drive.json"};
 
 const std::uint8_t maxIdentifyCmdRetry = 3;
-const std::uint8_t pollInterval = 5;
+// a composite temperature within the margin of the warning threshold is
+// polled at the minimum interval
+const int tempMargin = 10;
+// the composite temperature field of the health status poll reports no
+// temperature data
+const int8_t noTempData = -128;
 using Level = sdbusplus::xyz::openbmc_project::Logging::server::Entry::Level;
 
 using Json = nlohmann::json;
 
+inline const char* breakerStateName(NVMeMiIntf::BreakerState state)
+{
+    switch (state)
+    {
+        case NVMeMiIntf::BreakerState::Closed:
+            return "Closed";
+        case NVMeMiIntf::BreakerState::Open:
+            return "Open";
+        case NVMeMiIntf::BreakerState::HalfOpen:
+            return "HalfOpen";
+    }
+    return "";
+}
+
 NVMeDevice::NVMeDevice(boost::asio::io_service& io,
                        sdbusplus::asio::object_server& objectServer,
                        std::shared_ptr<sdbusplus::asio::connection>& conn,
-                       uint8_t eid, uint32_t bus, std::vector<uint8_t> addr,
-                       std::string path) :
+                       PollScheduler& scheduler, uint8_t eid, uint32_t bus,
+                       std::vector<uint8_t> addr, std::string path) :
     NvmeInterfaces(static_cast<sdbusplus::bus::bus&>(*conn), path.c_str(),
                    NvmeInterfaces::action::defer_emit),
     std::enable_shared_from_this<NVMeDevice>(), conn(conn),
-    objServer(objectServer), scanTimer(io), driveFunctional(false),
-    smartWarning(0xff), inProgress(false), objPath(path), eid(eid), bus(bus),
+    objServer(objectServer), scanTimer(io), tempTimer(io),
+    driveFunctional(false),
+    smartWarning(0xff), compositeTemp(noTempData), warningTemp(0),
+    pollInterval(std::chrono::seconds(pollIntervalMin),
+                 std::chrono::seconds(pollIntervalMax)),
+    pollSlot(scheduler.join()),
+    changedProps(static_cast<sdbusplus::bus::bus&>(*conn), path),
+    cancelToken(std::make_shared<NVMeMiIntf::CancelToken>()),
+    arena(std::make_shared<FrameArena>()),
+    tempSampling(false), inProgress(false), objPath(path), eid(eid), bus(bus),
     retry(1), backupDeviceErr(false), temperatureErr(false), degradesErr(false),
     mediaErr(false), capacityErr(false)
 {
     std::filesystem::path p(path);
 
     driveIndex = p.filename();
+    history = std::make_unique<DriveHistory>(std::string(historyDir) + "/" +
+                                             driveIndex);
+    tempSensor = std::make_unique<TemperatureSensor>(
+        static_cast<sdbusplus::bus::bus&>(*conn), driveIndex, path);
 
     // assume the drive is good and update Dbus properties at the first place.
     markFunctional(true);
 
-    nvmeIntf = NVMeIntf::create<NVMeMi>(io, conn, addr, eid);
+    if constexpr (nativeMctp)
+    {
+        nvmeIntf = NVMeIntf::create<NVMeMiNative>(
+            io, conn, objectServer, static_cast<int>(bus), addr, eid);
+    }
+    else
+    {
+        nvmeIntf = NVMeIntf::create<NVMeMi>(io, conn, objectServer,
+                                             static_cast<int>(bus), addr, eid);
+    }
     intf = std::get<std::shared_ptr<NVMeMiIntf>>(nvmeIntf.getInferface());
+
+    breakerIface = objServer.add_interface(objPath, breakerInterface);
+    breakerIface->register_property(
+        "State",
+        std::string(breakerStateName(NVMeMiIntf::BreakerState::Closed)));
+    breakerIface->initialize();
+    intf->watchBreaker([iface{std::weak_ptr(breakerIface)}](
+                           NVMeMiIntf::BreakerState state) {
+        if (auto ptr = iface.lock())
+        {
+            ptr->set_property("State", std::string(breakerStateName(state)));
+        }
+    });
+
+    addSmartInterface();
+    addHistoryInterface();
+}
+
+void NVMeDevice::addHistoryInterface()
+{
+    historyIface = objServer.add_interface(objPath, historyInterface);
+    // The samples of the metric in the tier, oldest first, see
+    // MetricHistory::query() for their packing.
+    historyIface->register_method(
+        "Query", [this](const std::string& metric, const std::string& tier) {
+        auto m = DriveHistory::metricFromString(metric);
+        auto t = DriveHistory::tierFromString(tier);
+        if (!m || !t)
+        {
+            throw sdbusplus::xyz::openbmc_project::Common::Error::
+                InvalidArgument();
+        }
+        return history->query(*m, *t);
+    });
+    historyIface->initialize();
+}
+
+void NVMeDevice::saveHistory()
+{
+    history->save();
+}
+
+// The property reads the field, so that a coalesced PropertiesChanged
+// carries its latest value.
+template <class T>
+static void registerSmartProperty(sdbusplus::asio::dbus_interface& iface,
+                                  const char* name, const T& field)
+{
+    iface.register_property_r(name, field,
+                              sdbusplus::vtable::property_::emits_change,
+                              [&field](const T&) { return field; });
+}
+
+template <class T>
+static void updateSmartProperty(PropertyBatch& batch, T& field, T value,
+                                const char* name)
+{
+    if (field != value)
+    {
+        field = value;
+        batch.changed(NVMeDevice::smartInterface, name);
+    }
+}
+
+// a 128-bit SMART counter, saturated to 64 bits
+static uint64_t smartCounter(std::span<const uint8_t, 16> bytes)
+{
+    if (std::any_of(bytes.begin() + sizeof(uint64_t), bytes.end(),
+                    [](uint8_t byte) { return byte != 0; }))
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    uint64_t value = 0;
+    std::memcpy(&value, bytes.data(), sizeof(value));
+    return boost::endian::little_to_native(value);
+}
+
+void NVMeDevice::addSmartInterface()
+{
+    smartIface = objServer.add_interface(objPath, smartInterface);
+    auto& iface = *smartIface;
+    registerSmartProperty(iface, "CompositeTemperature",
+                          smart.compositeTemperature);
+    registerSmartProperty(iface, "AvailableSpare", smart.availableSpare);
+    registerSmartProperty(iface, "AvailableSpareThreshold",
+                          smart.availableSpareThreshold);
+    registerSmartProperty(iface, "PercentageUsed", smart.percentageUsed);
+    registerSmartProperty(iface, "DataUnitsRead", smart.dataUnitsRead);
+    registerSmartProperty(iface, "DataUnitsWritten", smart.dataUnitsWritten);
+    registerSmartProperty(iface, "HostReadCommands", smart.hostReadCommands);
+    registerSmartProperty(iface, "HostWriteCommands",
+                          smart.hostWriteCommands);
+    registerSmartProperty(iface, "ControllerBusyTime",
+                          smart.controllerBusyTime);
+    registerSmartProperty(iface, "PowerCycles", smart.powerCycles);
+    registerSmartProperty(iface, "PowerOnHours", smart.powerOnHours);
+    registerSmartProperty(iface, "UnsafeShutdowns", smart.unsafeShutdowns);
+    registerSmartProperty(iface, "MediaErrors", smart.mediaErrors);
+    registerSmartProperty(iface, "ErrorLogEntries", smart.errorLogEntries);
+    registerSmartProperty(iface, "WarningTemperatureTime",
+                          smart.warningTemperatureTime);
+    registerSmartProperty(iface, "CriticalTemperatureTime",
+                          smart.criticalTemperatureTime);
+    registerSmartProperty(iface, "ThermalTemp1TransitionCount",
+                          smart.thermalTransitions1);
+    registerSmartProperty(iface, "ThermalTemp2TransitionCount",
+                          smart.thermalTransitions2);
+    registerSmartProperty(iface, "ThermalTemp1TotalTime", smart.thermalTime1);
+    registerSmartProperty(iface, "ThermalTemp2TotalTime", smart.thermalTime2);
+    iface.initialize();
 }
 
 inline Drive::DriveFormFactor getDriveFormFactor(std::string form)
@@ -123,11 +279,11 @@ inline Drive::DriveFormFactor getDriveFormFactor(std::string form)
     return Drive::DriveFormFactor::U2;
 }
 
-std::string NVMeDevice::stripString(char* src, size_t len)
+std::string NVMeDevice::stripString(std::span<const uint8_t> src)
 {
     std::string s;
 
-    s.assign(src, src + len);
+    s.assign(src.begin(), src.end());
     s.erase(s.find_last_not_of(' ') + 1);
     return s;
 }
@@ -136,28 +292,40 @@ void NVMeDevice::updateFormFactor(std::string form)
 {
     size_t pos = form.find_last_of(".");
     auto formFactor = getDriveFormFactor(form.substr(pos + 1));
-    Drive::formFactor(formFactor, false);
+    Drive::formFactor(formFactor, true);
+    changedProps.changed(Drive::interface, "FormFactor");
+    flushProperties();
 }
 
 void NVMeDevice::updateDriveAssociations()
 {
     HealthType healthType = Health::health();
-    assocs = {};
+    AssociationList list;
 
     // Read the current Health state and restore for associations
     if (healthType == HealthType::Critical)
     {
-        assocs.emplace_back("health", "critical", objPath.c_str());
+        list.emplace_back("health", "critical", objPath.c_str());
     }
     else if (healthType == HealthType::Warning)
     {
-        assocs.emplace_back("health", "warning", objPath.c_str());
+        list.emplace_back("health", "warning", objPath.c_str());
     }
 
     // Set Drive's association
-    assocs.emplace_back("chassis", "drive", driveAssociation.c_str());
+    list.emplace_back("chassis", "drive", driveAssociation.c_str());
 
-    Associations::associations(assocs);
+    publishAssociations(std::move(list));
+    flushProperties();
+}
+
+void NVMeDevice::publishAssociations(AssociationList list)
+{
+    if (publishedAssocs.update(list))
+    {
+        Associations::associations(std::move(list), true);
+        changedProps.changed(Associations::interface, "Associations");
+    }
 }
 
 std::string NVMeDevice::getManufacture(uint16_t vid)
@@ -215,92 +383,206 @@ inline uint32_t getCurrLinkSpeed(uint8_t speed, uint8_t lanes)
     return base * lanes;
 }
 
-void NVMeDevice::getDriveInfo()
+NVMeMiIntf::CommandOptions NVMeDevice::cmdOptions() const
 {
-    getIntf()->adminIdentify(
-        ctrl, nvme_identify_cns::NVME_IDENTIFY_CNS_CTRL, NVME_NSID_NONE, 0,
-        identifyRspLength,
-        [self{shared_from_this()}](const std::error_code& ec,
-                                   std::span<uint8_t> data) {
-        if (ec)
-        {
-            // Identify command's length is up to 4K. There's possibility
-            // to get I2C transcation timeout during the transmission.
-            // Implement retry method.
-            lg2::error("eid:{ID} Retry Identify command {COUNT} times", "ID",
-                       self->eid, "COUNT", self->retry);
-            if (self->retry < maxIdentifyCmdRetry)
-            {
-                self->retry++;
-                self->getDriveInfo();
-            }
-            else
-            {
-                // give up and move forward next command.
-                self->retry = 0;
-                self->getDriveLink();
-            }
-            return;
-        }
-
-        struct nvme_id_ctrl* id = (struct nvme_id_ctrl*)data.data();
-
-        self->Asset::manufacturer(self->getManufacture(id->vid), true);
-        self->Asset::serialNumber(self->stripString(id->sn, sizeof(id->sn)),
-                                  true);
-        self->Asset::model(self->stripString(id->mn, sizeof(id->mn)), true);
+    NVMeMiIntf::CommandOptions opts;
+    opts.cancel = cancelToken;
+    return opts;
+}
 
-        std::string fr;
-        fr.assign(id->fr, id->fr + 8);
-        self->Version::version(fr, true);
+NVMeMiIntf::CommandOptions NVMeDevice::pollOptions() const
+{
+    // a poll result older than the next poll is useless
+    NVMeMiIntf::CommandOptions opts = cmdOptions();
+    opts.deadline = std::chrono::steady_clock::now() +
+                    pollInterval.current();
+    return opts;
+}
 
-        uint64_t drive_capacity[2];
-        memcpy(&drive_capacity, id->tnvmcap, 16);
+void NVMeDevice::stop()
+{
+    cancelToken->cancel();
+    scanTimer.cancel();
+    tempTimer.cancel();
+}
 
+NVMeController::Identity
+    NVMeDevice::makeIdentity(const NVMeMiIntf::BatchResult& result)
+{
+    auto id = result.view<nvme_id_ctrl, identifyRspLength>();
+    auto frBytes = id.bytes<offsetof(nvme_id_ctrl, fr),
+                            sizeof(nvme_id_ctrl::fr)>();
+
+    return {
+        id.get<offsetof(nvme_id_ctrl, cntlid), uint16_t>(),
+        getManufacture(id.get<offsetof(nvme_id_ctrl, vid), uint16_t>()),
+        stripString(id.bytes<offsetof(nvme_id_ctrl, sn),
+                             sizeof(nvme_id_ctrl::sn)>()),
+        stripString(id.bytes<offsetof(nvme_id_ctrl, mn),
+                             sizeof(nvme_id_ctrl::mn)>()),
+        std::string(frBytes.begin(), frBytes.end()),
         /* 8 bytes presenting the drive capacity is enough to support all
          * drives outside market.
          */
-        self->Drive::capacity(drive_capacity[0], true);
+        id.get<offsetof(nvme_id_ctrl, tnvmcap), uint64_t>(),
+        id.get<offsetof(nvme_id_ctrl, sanicap), uint32_t>(),
+        id.get<offsetof(nvme_id_ctrl, wctemp), uint16_t>(),
+        id.get<offsetof(nvme_id_ctrl, cctemp), uint16_t>()};
+}
+
+coro::Task<> NVMeDevice::identifyControllers()
+{
+    static_assert(offsetof(nvme_id_ctrl, sanicap) + sizeof(uint32_t) <=
+                      identifyRspLength,
+                  "identify_rsp_length is too short for the drive info");
+
+    std::vector<NVMeController*> pending;
+    std::vector<NVMeController*> failed;
+    std::vector<NVMeMiIntf::BatchCommand> cmds;
+    for (auto& controller : controllers)
+    {
+        pending.push_back(&controller);
+    }
 
-        // check the drive sanitize capability
-        std::vector<EraseMethod> saniCap;
-        if (id->sanicap & (NVME_CTRL_SANICAP_OWS))
+    // a batch defaults to the class of the polls, identify goes ahead of them
+    NVMeMiIntf::CommandOptions opts = cmdOptions();
+    opts.priority = NVMeMiIntf::Priority::Lifecycle;
+
+    while (!pending.empty())
+    {
+        failed.clear();
+        for (size_t i = 0; i < pending.size(); i += NVMeMiIntf::maxBatch)
         {
-            saniCap.push_back(EraseMethod::Overwrite);
+            auto chunk = std::span(pending).subspan(
+                i, std::min(NVMeMiIntf::maxBatch, pending.size() - i));
+            cmds.clear();
+            for (auto* controller : chunk)
+            {
+                cmds.push_back(NVMeMiIntf::BatchCommand::identify<
+                               nvme_id_ctrl, identifyRspLength>(
+                    controller->getHandle(), NVME_NSID_NONE, 0));
+            }
+
+            auto [ec, results] = co_await coro::submitBatch(*intf, cmds, opts);
+            if (ec == std::errc::operation_canceled)
+            {
+                co_return;
+            }
+            if (ec == std::errc::host_unreachable)
+            {
+                // the drive is down, a retry would be rejected as well
+                lg2::error("eid:{ID} Identify command rejected, drive is down",
+                           "ID", eid);
+                retry = 0;
+                co_return;
+            }
+            for (size_t j = 0; j < chunk.size(); j++)
+            {
+                if (ec || results[j].ec)
+                {
+                    failed.push_back(chunk[j]);
+                    continue;
+                }
+                // the response is only valid until the next suspension
+                chunk[j]->publish(static_cast<sdbusplus::bus::bus&>(*conn),
+                                  objPath, makeIdentity(results[j]));
+            }
         }
-        if (id->sanicap & (NVME_CTRL_SANICAP_BES))
+        if (failed.empty())
         {
-            saniCap.push_back(EraseMethod::BlockErase);
+            co_return;
         }
-        if (id->sanicap & (NVME_CTRL_SANICAP_CES))
+
+        // Identify command's length is up to 4K. There's possibility
+        // to get I2C transcation timeout during the transmission.
+        // Implement retry method.
+        lg2::error("eid:{ID} Retry Identify command {COUNT} times", "ID", eid,
+                   "COUNT", retry);
+        if (retry >= maxIdentifyCmdRetry)
         {
-            saniCap.push_back(EraseMethod::CryptoErase);
+            // give up and move forward next command.
+            retry = 0;
+            co_return;
         }
-        self->SecureErase::sanitizeCapability(saniCap, true);
-        self->setNodmmas(id->sanicap);
+        retry++;
+        std::swap(pending, failed);
+    }
+}
 
-        self->getDriveLink();
-    });
+coro::Task<> NVMeDevice::getDriveInfo()
+{
+    co_await identifyControllers();
+
+    // the drive level data is the one of the primary controller
+    if (controllers.empty() || !controllers.back().getIdentity())
+    {
+        co_return;
+    }
+    const auto& id = *controllers.back().getIdentity();
+    if (id.wctemp != 0)
+    {
+        warningTemp = static_cast<int16_t>(id.wctemp - 273);
+    }
+    tempSensor->setThresholds(
+        id.wctemp != 0 ? std::optional<int16_t>(id.wctemp - 273)
+                       : std::nullopt,
+        id.cctemp != 0 ? std::optional<int16_t>(id.cctemp - 273)
+                       : std::nullopt);
+    if (!publishedIdentity.update(id))
+    {
+        // a rescan found the same primary controller
+        co_return;
+    }
+    history->load(id.serialNumber);
+
+    Asset::manufacturer(id.manufacturer, true);
+    Asset::serialNumber(id.serialNumber, true);
+    Asset::model(id.model, true);
+    changedProps.changed(Asset::interface, "Manufacturer");
+    changedProps.changed(Asset::interface, "SerialNumber");
+    changedProps.changed(Asset::interface, "Model");
+    Version::version(id.firmware, true);
+    changedProps.changed(Version::interface, "Version");
+    Drive::capacity(id.capacity, true);
+    changedProps.changed(Drive::interface, "Capacity");
+
+    // check the drive sanitize capability
+    std::vector<EraseMethod> saniCap;
+    if (id.sanicap & (NVME_CTRL_SANICAP_OWS))
+    {
+        saniCap.push_back(EraseMethod::Overwrite);
+    }
+    if (id.sanicap & (NVME_CTRL_SANICAP_BES))
+    {
+        saniCap.push_back(EraseMethod::BlockErase);
+    }
+    if (id.sanicap & (NVME_CTRL_SANICAP_CES))
+    {
+        saniCap.push_back(EraseMethod::CryptoErase);
+    }
+    SecureErase::sanitizeCapability(saniCap, true);
+    changedProps.changed(SecureErase::interface, "SanitizeCapability");
+    setNodmmas(id.sanicap);
 }
 
-void NVMeDevice::getDriveLink()
+coro::Task<> NVMeDevice::getDriveLink()
 {
-    intf->miPCIePortInformation(
-        [self{shared_from_this()}](const std::error_code& err,
-                                   nvme_mi_read_port_info* port) {
-        if (err)
-        {
-            lg2::error("eid:{ID} - fail to get PCIePortInformation", "ID",
-                       self->eid);
-            self->pollDrive();
-            return;
-        }
-        self->PortInfo::maxSpeed(
-            getMaxLinkSpeed(port->pcie.sls, port->pcie.mlw), true);
-        self->PortInfo::currentSpeed(
-            getCurrLinkSpeed(port->pcie.cls, port->pcie.nlw), true);
-        self->pollDrive();
-    });
+    auto [err, port] = co_await coro::miPCIePortInformation(*intf,
+                                                            cmdOptions());
+    if (err)
+    {
+        lg2::error("eid:{ID} - fail to get PCIePortInformation", "ID", eid);
+        co_return;
+    }
+    uint32_t maxSpeed = getMaxLinkSpeed(port->pcie.sls, port->pcie.mlw);
+    uint32_t currentSpeed = getCurrLinkSpeed(port->pcie.cls, port->pcie.nlw);
+    if (publishedLinkSpeed.update({maxSpeed, currentSpeed}))
+    {
+        PortInfo::maxSpeed(maxSpeed, true);
+        PortInfo::currentSpeed(currentSpeed, true);
+        changedProps.changed(PortInfo::interface, "MaxSpeed");
+        changedProps.changed(PortInfo::interface, "CurrentSpeed");
+    }
 }
 
 void NVMeDevice::initialize()
@@ -312,54 +594,104 @@ void NVMeDevice::initialize()
 
     NvmeInterfaces::emit_object_added();
 
-    intf->miScanCtrl([self{shared_from_this()}](
-                         const std::error_code& ec,
-                         const std::vector<nvme_mi_ctrl_t>& ctrlList) mutable {
-        if (ec || ctrlList.size() == 0)
+    coro::spawn(run(shared_from_this()));
+    // the sampler outlives the re-initializations of the drive
+    if (!tempSampling)
+    {
+        tempSampling = true;
+        coro::spawn(sampleTemperature(shared_from_this()));
+    }
+}
+
+coro::Task<> NVMeDevice::run(std::shared_ptr<NVMeDevice> self)
+{
+    // self keeps the device alive until the coroutine completes
+    (void)self;
+
+    auto [ec, ctrlList] = co_await coro::miScanCtrl(*intf, cmdOptions());
+    if (ec || ctrlList.size() == 0)
+    {
+        lg2::error(
+            "eid:{ID} - fail to scan controllers for the nvme subsystem {ERR}: {MSG}",
+            "ID", eid, "ERR", ec.value(), "MSG", ec.message());
+        presence = false;
+        if (publishedPresent.update(false))
         {
-            lg2::error(
-                "eid:{ID} - fail to scan controllers for the nvme subsystem {ERR}: {MSG}",
-                "ID", self->eid, "ERR", ec.value(), "MSG", ec.message());
-            self->presence = false;
-            self->Item::present(false, true);
-            return;
+            Item::present(false, true);
+            changedProps.changed(Item::interface, "Present");
         }
-        self->presence = true;
-        self->Item::present(true, true);
+        controllers.clear();
+        pollCmds.clear();
+        fullPollCmds.clear();
+        flushProperties();
+        co_return;
+    }
+    presence = true;
+    if (publishedPresent.update(true))
+    {
+        Item::present(true, true);
+        changedProps.changed(Item::interface, "Present");
+    }
 
-        self->ctrl = ctrlList.back();
-        self->getDriveInfo();
-    });
+    // the handles of the previous scan are stale
+    controllers.clear();
+    pollCmds.clear();
+    fullPollCmds.clear();
+    for (nvme_mi_ctrl_t handle : ctrlList)
+    {
+        controllers.emplace_back(handle);
+        pollCmds.push_back(
+            NVMeMiIntf::BatchCommand::getLog<nvme_smart_log, smartHotLength>(
+                handle, NVME_NSID_ALL));
+        fullPollCmds.push_back(
+            NVMeMiIntf::BatchCommand::getLog<nvme_smart_log, smartLength>(
+                handle, NVME_NSID_ALL));
+    }
+    // the first poll reads the full SMART log
+    nextFullSmart = {};
+    ctrl = ctrlList.back();
+    pollInterval.reset();
+
+    co_await getDriveInfo();
+    if (cancelToken->isCancelled())
+    {
+        co_return;
+    }
+    co_await getDriveLink();
+    flushProperties();
+    co_await pollDrive();
 }
 
 void NVMeDevice::markStatus(std::string status)
 {
-    assocs = {};
+    AssociationList list;
+    HealthType healthType = HealthType::OK;
 
     if (status == "critical")
     {
-        assocs.emplace_back("health", status, objPath.c_str());
-        Health::health(HealthType::Critical, true);
+        list.emplace_back("health", status, objPath.c_str());
+        healthType = HealthType::Critical;
     }
     else if (status == "warning")
     {
-        assocs.emplace_back("health", status, objPath.c_str());
-        Health::health(HealthType::Warning, true);
+        list.emplace_back("health", status, objPath.c_str());
+        healthType = HealthType::Warning;
     }
-    else
+    if (publishedHealth.update(healthType))
     {
-        Health::health(HealthType::OK, true);
+        Health::health(healthType, true);
+        changedProps.changed(Health::interface, "Health");
     }
 
     if (!driveAssociation.empty())
     {
-        assocs.emplace_back("chassis", "drive", driveAssociation.c_str());
+        list.emplace_back("chassis", "drive", driveAssociation.c_str());
     }
     else
     {
-        assocs.emplace_back("chassis", "drive", driveLocation);
+        list.emplace_back("chassis", "drive", driveLocation);
     }
-    Associations::associations(assocs);
+    publishAssociations(std::move(list));
 }
 
 void NVMeDevice::markFunctional(bool functional)
@@ -371,6 +703,8 @@ void NVMeDevice::markFunctional(bool functional)
         {
             OperationalStatus::functional(false, true);
             OperationalStatus::state(OperationalStatus::StateType::Fault, true);
+            changedProps.changed(OperationalStatus::interface, "Functional");
+            changedProps.changed(OperationalStatus::interface, "State");
             markStatus("critical");
 
             createLogEntry(conn, "ResourceEvent.1.0.ResourceErrorsDetected",
@@ -382,6 +716,8 @@ void NVMeDevice::markFunctional(bool functional)
         {
             OperationalStatus::functional(true, true);
             OperationalStatus::state(OperationalStatus::StateType::None, true);
+            changedProps.changed(OperationalStatus::interface, "Functional");
+            changedProps.changed(OperationalStatus::interface, "State");
             markStatus("ok");
         }
     }
@@ -445,7 +781,11 @@ void NVMeDevice::updatePercent(uint32_t endTime)
         endTime = driveSanitizeTime;
         lg2::info("no estimated sanitize time is reported by drive");
     }
-    auto time = getEstimateTime() + pollInterval;
+    // The polls are spaced by the scheduler, with jitter and an adaptive
+    // interval, so the time elapsed is measured rather than counted.
+    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - sanitizeStart);
+    auto time = static_cast<uint32_t>(elapsed.count());
     auto percent = (time * 100) / endTime;
 
     lg2::info("percent: {NUM} - {ECLTIME} / {MAXTIME}\n", "NUM", percent,
@@ -456,219 +796,490 @@ void NVMeDevice::updatePercent(uint32_t endTime)
     {
         percent = 99;
     }
-    Progress::progress(percent);
+    Progress::progress(percent, true);
+    changedProps.changed(Progress::interface, "Progress");
     setEstimateTime(time);
 }
 
-void NVMeDevice::pollDrive()
+coro::Task<> NVMeDevice::pollDrive()
 {
-    scanTimer.expires_from_now(std::chrono::seconds(pollInterval));
-    scanTimer.async_wait(
-        [self{shared_from_this()}](const boost::system::error_code errorCode) {
+    while (!cancelToken->isCancelled())
+    {
+        auto due = pollSlot->next(pollInterval.current());
+        auto errorCode = co_await coro::sleep(
+            scanTimer, due - std::chrono::steady_clock::now());
         if (errorCode == boost::asio::error::operation_aborted)
         {
-            return; // we're being canceled
+            co_return; // we're being canceled
         }
         else if (errorCode)
         {
             lg2::error("Error: {MSG}", "MSG", errorCode.message());
-            return;
+            co_return;
         }
         // try to re-initialize the drive
-        if (self->presence == false)
+        if (presence == false)
         {
-            self->initialize();
-            return;
+            initialize();
+            co_return;
         }
 
-        auto miIntf = self->getIntf();
-        if (self->Operation::operation() == OperationType::Sanitize &&
-            self->inProgress == true)
+        if (Operation::operation() == OperationType::Sanitize &&
+            inProgress == true)
         {
-            miIntf->adminGetLogPage(
-                self->ctrl, NVME_LOG_LID_SANITIZE, 0, 0, 0,
-                [self](const std::error_code& ec, std::span<uint8_t> status) {
-                if (ec)
-                {
-                    lg2::error(
-                        "fail to query satinize status for the nvme subsystem {ERR}:{MSG}",
-                        "ERR", ec.value(), "MSG", ec.message());
-                    return;
-                }
+            // not do health polling during the sanitize process.
+            co_await pollSanitize();
+        }
+        else
+        {
+            co_await pollStatus();
+        }
+        flushProperties();
+        pollSlot->done();
+        pollInterval.next(pollUrgent());
+    }
+}
 
-                struct nvme_sanitize_log_page* log =
-                    (struct nvme_sanitize_log_page*)status.data();
+void NVMeDevice::flushProperties()
+{
+    changedProps.flush();
+    for (auto& controller : controllers)
+    {
+        controller.flushProperties();
+    }
+}
 
-                uint8_t res = log->sstat & NVME_SANITIZE_SSTAT_STATUS_MASK;
-                if (res == NVME_SANITIZE_SSTAT_STATUS_COMPLETE_SUCCESS ||
-                    res == NVME_SANITIZE_SSTAT_STATUS_ND_COMPLETE_SUCCESS)
-                {
-                    self->Progress::status(OperationStatus::Completed);
-                    self->Progress::progress(100);
-                    self->inProgress = false;
-                }
-                else if (res == NVME_SANITIZE_SSTAT_STATUS_COMPLETED_FAILED)
-                {
-                    self->Progress::status(OperationStatus::Failed);
-                    self->Progress::progress(0);
-                    self->inProgress = false;
-                }
-                if (res != NVME_SANITIZE_SSTAT_STATUS_IN_PROGESS)
-                {
-                    // sanitize is done no matter that the result it success
-                    // or fail
-                    self->pollDrive();
-                    return;
-                }
+bool NVMeDevice::pollUrgent() const
+{
+    // a sanitize in progress, a fault or a critical warning, including the
+    // unknown one before the first SMART read
+    if (inProgress || !driveFunctional || smartWarning != 0)
+    {
+        return true;
+    }
+    return warningTemp != 0 && compositeTemp != noTempData &&
+           compositeTemp + tempMargin >= warningTemp;
+}
 
-                auto type = self->getEraseType();
-                auto noDeAlloc = self->getNodmmas();
-                uint32_t time = 0;
-                if (type == EraseMethod::CryptoErase)
-                {
-                    if (noDeAlloc)
-                    {
-                        time = log->etcend;
-                    }
-                    else
-                    {
-                        time = log->etce;
-                    }
-                }
-                else if (type == EraseMethod::BlockErase)
-                {
-                    if (noDeAlloc)
-                    {
-                        time = log->etbend;
-                    }
-                    else
-                    {
-                        time = log->etbe;
-                    }
-                }
-                else if (type == EraseMethod::Overwrite)
-                {
-                    if (noDeAlloc)
-                    {
-                        time = log->etond;
-                    }
-                    else
-                    {
-                        time = log->eto;
-                    }
-                }
-                self->updatePercent(time);
-            });
-            // not do health polling during the sanitize process.
-            self->pollDrive();
-            return;
+coro::Task<> NVMeDevice::pollSanitize()
+{
+    using Sanitize = nvme_sanitize_log_page;
+
+    auto [ec, log] = co_await coro::getLog<Sanitize>(*intf, ctrl,
+                                                     NVME_NSID_NONE,
+                                                     pollOptions());
+    if (ec)
+    {
+        lg2::error(
+            "fail to query satinize status for the nvme subsystem {ERR}:{MSG}",
+            "ERR", ec.value(), "MSG", ec.message());
+        co_return;
+    }
+
+    uint8_t res = log.get<offsetof(Sanitize, sstat), uint16_t>() &
+                  NVME_SANITIZE_SSTAT_STATUS_MASK;
+    if (res == NVME_SANITIZE_SSTAT_STATUS_COMPLETE_SUCCESS ||
+        res == NVME_SANITIZE_SSTAT_STATUS_ND_COMPLETE_SUCCESS)
+    {
+        Progress::status(OperationStatus::Completed, true);
+        Progress::progress(100, true);
+        changedProps.changed(Progress::interface, "Status");
+        changedProps.changed(Progress::interface, "Progress");
+        inProgress = false;
+    }
+    else if (res == NVME_SANITIZE_SSTAT_STATUS_COMPLETED_FAILED)
+    {
+        Progress::status(OperationStatus::Failed, true);
+        Progress::progress(0, true);
+        changedProps.changed(Progress::interface, "Status");
+        changedProps.changed(Progress::interface, "Progress");
+        inProgress = false;
+    }
+    if (res != NVME_SANITIZE_SSTAT_STATUS_IN_PROGESS)
+    {
+        // sanitize is done no matter that the result it success or fail
+        co_return;
+    }
+
+    auto type = getEraseType();
+    auto noDeAlloc = getNodmmas();
+    uint32_t time = 0;
+    if (type == EraseMethod::CryptoErase)
+    {
+        if (noDeAlloc)
+        {
+            time = log.get<offsetof(Sanitize, etcend), uint32_t>();
+        }
+        else
+        {
+            time = log.get<offsetof(Sanitize, etce), uint32_t>();
+        }
+    }
+    else if (type == EraseMethod::BlockErase)
+    {
+        if (noDeAlloc)
+        {
+            time = log.get<offsetof(Sanitize, etbend), uint32_t>();
         }
+        else
+        {
+            time = log.get<offsetof(Sanitize, etbe), uint32_t>();
+        }
+    }
+    else if (type == EraseMethod::Overwrite)
+    {
+        if (noDeAlloc)
+        {
+            time = log.get<offsetof(Sanitize, etond), uint32_t>();
+        }
+        else
+        {
+            time = log.get<offsetof(Sanitize, eto), uint32_t>();
+        }
+    }
+    updatePercent(time);
+}
 
-        miIntf->miSubsystemHealthStatusPoll(
-            [self](__attribute__((unused)) const std::error_code& err,
-                   nvme_mi_nvm_ss_health_status* ss) {
-            if (err)
+coro::Task<> NVMeDevice::pollStatus()
+{
+    const std::array health{NVMeMiIntf::BatchCommand::healthStatusPoll()};
+    auto [healthEc, healthResults] = co_await coro::submitBatch(*intf, health,
+                                                                pollOptions());
+    if (healthEc == std::errc::host_unreachable)
+    {
+        // the drive is down, which is reported by the breaker state
+        co_return;
+    }
+    if (healthEc)
+    {
+        lg2::error("fail to poll the nvme subsystem {ERR}:{MSG}", "ERR",
+                   healthEc.value(), "MSG", healthEc.message());
+        co_return;
+    }
+    bool changed = updateHealth(healthResults[0]);
+
+    // The SMART log is only read when the health poll flags a change of its
+    // fields. The full log is read at a slow cadence regardless, as a
+    // safety net, and the polls in between only read its hot fields.
+    auto now = std::chrono::steady_clock::now();
+    bool full = now >= nextFullSmart;
+    if (!full && !changed)
+    {
+        co_return;
+    }
+    const auto& list = full ? fullPollCmds : pollCmds;
+
+    // the SMART logs of the controllers are queued in batches
+    for (size_t i = 0; i < list.size(); i += NVMeMiIntf::maxBatch)
+    {
+        auto cmds = std::span(list).subspan(
+            i, std::min(NVMeMiIntf::maxBatch, list.size() - i));
+        auto [ec, results] = co_await coro::submitBatch(*intf, cmds,
+                                                        pollOptions());
+        if (ec == std::errc::host_unreachable)
+        {
+            co_return;
+        }
+        if (ec)
+        {
+            lg2::error("fail to read SMART of the nvme subsystem {ERR}:{MSG}",
+                       "ERR", ec.value(), "MSG", ec.message());
+            co_return;
+        }
+        for (size_t j = 0; j < results.size(); j++)
+        {
+            auto& controller = controllers[i + j];
+            controller.updateSmart(results[j]);
+            if (controller.getHandle() == ctrl)
             {
-                lg2::error("fail to query SubSystemHealthPoll for the nvme "
-                           "subsystem {ERR}:{MSG}",
-                           "ERR", err.value(), "MSG", err.message());
-                return;
+                updateSmart(results[j]);
             }
-            self->NVMeStatus::driveLifeUsed(std::to_string(ss->pdlu), true);
+        }
+    }
+    if (full)
+    {
+        nextFullSmart = now + std::chrono::seconds(smartFullInterval);
+    }
+}
 
-            // the percentage is allowed to exceed 100 based on the spec.
-            auto percentage = (ss->pdlu > 100) ? 100 : ss->pdlu;
-            self->sdbusplus::xyz::openbmc_project::Inventory::Item::server::
-                Drive::predictedMediaLifeLeftPercent(100 - percentage, true);
+coro::Task<> NVMeDevice::sampleTemperature(std::shared_ptr<NVMeDevice> self)
+{
+    // self keeps the device alive until the coroutine completes
+    (void)self;
 
-            self->markFunctional(ss->nss & 0x20);
-        });
+    // The sample leaves the status change flags to the health poll of
+    // pollDrive, which gates the SMART read on them.
+    const std::array health{
+        NVMeMiIntf::BatchCommand::healthStatusPoll(false)};
+    const auto period = std::chrono::milliseconds(tempSampleIntervalMs);
 
-        miIntf->adminGetLogPage(
-            self->ctrl, NVME_LOG_LID_SMART, 0xFFFFFFFF, 0, 0,
-            [self](const std::error_code& ec, std::span<uint8_t> smart) {
-            if (ec)
-            {
-                lg2::error(
-                    "fail to query SMART for the nvme subsystem {ERR}:{MSG}",
-                    "ERR", ec.value(), "MSG", ec.message());
-                self->pollDrive();
-                return;
-            }
+    auto due = std::chrono::steady_clock::now();
+    while (!cancelToken->isCancelled())
+    {
+        // The samples stay on a fixed grid, a late one neither drifts nor
+        // bunches up the next ones.
+        auto now = std::chrono::steady_clock::now();
+        due += period;
+        if (due < now)
+        {
+            due += (now - due) / period * period + period;
+        }
+        auto errorCode = co_await coro::sleep(tempTimer, due - now);
+        if (errorCode == boost::asio::error::operation_aborted)
+        {
+            co_return; // we're being canceled
+        }
+        else if (errorCode)
+        {
+            lg2::error("Error: {MSG}", "MSG", errorCode.message());
+            co_return;
+        }
 
-            struct nvme_smart_log* log;
-            log = (struct nvme_smart_log*)smart.data();
+        if (presence == false ||
+            (Operation::operation() == OperationType::Sanitize &&
+             inProgress == true))
+        {
+            // no health polling during the sanitize process either
+            tempSensor->update(std::nullopt);
+            continue;
+        }
 
-            auto cw = log->critical_warning;
+        // ahead of the SMART polls of the drives, and useless once the next
+        // sample is due
+        NVMeMiIntf::CommandOptions opts = cmdOptions();
+        opts.priority = NVMeMiIntf::Priority::Lifecycle;
+        opts.deadline = due + period;
+        auto [ec, results] = co_await coro::submitBatch(*intf, health, opts);
+        if (ec || results[0].ec)
+        {
+            tempSensor->update(std::nullopt);
+            continue;
+        }
+        auto ss = results[0].view<nvme_mi_nvm_ss_health_status>();
+        auto ctemp = static_cast<int8_t>(ss->ctemp);
+        tempSensor->update(ctemp != noTempData ? std::optional<int16_t>(ctemp)
+                                               : std::nullopt);
+    }
+}
 
-            // overwrite the warning triggered from Dbus
-            if (self->backupDeviceErr)
-            {
-                cw |= (NVME_SMART_CRIT_VOLATILE_MEMORY);
-            }
-            if (self->capacityErr)
-            {
-                cw |= (NVME_SMART_CRIT_SPARE);
-            }
-            if (self->temperatureErr)
-            {
-                cw |= (NVME_SMART_CRIT_TEMPERATURE);
-            }
-            if (self->degradesErr)
-            {
-                cw |= (NVME_SMART_CRIT_DEGRADED);
-            }
-            if (self->mediaErr)
-            {
-                cw |= (NVME_SMART_CRIT_MEDIA);
-            }
+bool NVMeDevice::updateHealth(const NVMeMiIntf::BatchResult& result)
+{
+    // the change flags of the fields of the SMART log, they are cleared by
+    // every poll
+    constexpr uint16_t smartChanges = NVME_MI_CCS_CTEMP | NVME_MI_CCS_PDLU |
+                                      NVME_MI_CCS_SPARE | NVME_MI_CCS_CCWARN;
 
-            if (cw != self->smartWarning)
-            {
-                // the error indicator is from smart warning
-                self->NVMeStatus::backupDeviceFault(
-                    cw & (NVME_SMART_CRIT_VOLATILE_MEMORY), true);
+    if (result.ec)
+    {
+        lg2::error("fail to query SubSystemHealthPoll for the nvme "
+                   "subsystem {ERR}:{MSG}",
+                   "ERR", result.ec.value(), "MSG", result.ec.message());
+        // a change may have been missed
+        return true;
+    }
+    auto ss = result.view<nvme_mi_nvm_ss_health_status>();
+    compositeTemp = static_cast<int8_t>(ss->ctemp);
+    if (compositeTemp != noTempData)
+    {
+        history->add(DriveHistory::Metric::Temperature, compositeTemp);
+    }
+    history->add(DriveHistory::Metric::LifeUsed, ss->pdlu);
+    if (publishedLifeUsed.update(ss->pdlu))
+    {
+        NVMeStatus::driveLifeUsed(std::to_string(ss->pdlu), true);
+        changedProps.changed(NVMeStatus::interface, "DriveLifeUsed");
+
+        // the percentage is allowed to exceed 100 based on the spec.
+        auto percentage = (ss->pdlu > 100) ? 100 : ss->pdlu;
+        sdbusplus::xyz::openbmc_project::Inventory::Item::server::Drive::
+            predictedMediaLifeLeftPercent(100 - percentage, true);
+        changedProps.changed(Drive::interface,
+                             "PredictedMediaLifeLeftPercent");
+    }
 
-                self->NVMeStatus::capacityFault(cw & (NVME_SMART_CRIT_SPARE),
-                                                true);
+    markFunctional(ss->nss & 0x20);
 
-                self->NVMeStatus::temperatureFault(
-                    cw & (NVME_SMART_CRIT_TEMPERATURE), true);
+    return (boost::endian::little_to_native(ss->ccs) & smartChanges) != 0;
+}
 
-                self->NVMeStatus::degradesFault(cw & (NVME_SMART_CRIT_DEGRADED),
-                                                true);
+void NVMeDevice::updateSmart(const NVMeMiIntf::BatchResult& result)
+{
+    if (result.ec)
+    {
+        lg2::error("fail to query SMART for the nvme subsystem {ERR}:{MSG}",
+                   "ERR", result.ec.value(), "MSG", result.ec.message());
+        return;
+    }
+    updateSmartTelemetry(result);
 
-                self->NVMeStatus::mediaFault(cw & ((NVME_SMART_CRIT_MEDIA)),
-                                             true);
+    // the hot fields lead both the partial and the full read
+    auto log = result.view<nvme_smart_log, smartHotLength>();
 
-                self->NVMeStatus::smartWarnings(std::to_string(cw), true);
+    auto cw = log.get<offsetof(nvme_smart_log, critical_warning), uint8_t>();
 
-                if (cw != 0)
-                {
-                    self->markStatus("warning");
-                }
-                else
-                {
-                    self->markStatus("ok");
-                }
-                self->generateRedfishEventbySmart(cw);
-            }
-            self->smartWarning = cw;
-            boost::multiprecision::uint128_t powerOnHours;
-            memcpy((void*)&powerOnHours, log->power_on_hours,
-                   sizeof(powerOnHours));
-            self->pollDrive();
-        });
-    });
+    // overwrite the warning triggered from Dbus
+    if (backupDeviceErr)
+    {
+        cw |= (NVME_SMART_CRIT_VOLATILE_MEMORY);
+    }
+    if (capacityErr)
+    {
+        cw |= (NVME_SMART_CRIT_SPARE);
+    }
+    if (temperatureErr)
+    {
+        cw |= (NVME_SMART_CRIT_TEMPERATURE);
+    }
+    if (degradesErr)
+    {
+        cw |= (NVME_SMART_CRIT_DEGRADED);
+    }
+    if (mediaErr)
+    {
+        cw |= (NVME_SMART_CRIT_MEDIA);
+    }
+
+    if (cw != smartWarning)
+    {
+        // the error indicator is from smart warning
+        NVMeStatus::backupDeviceFault(cw & (NVME_SMART_CRIT_VOLATILE_MEMORY),
+                                      true);
+
+        NVMeStatus::capacityFault(cw & (NVME_SMART_CRIT_SPARE), true);
+
+        NVMeStatus::temperatureFault(cw & (NVME_SMART_CRIT_TEMPERATURE), true);
+
+        NVMeStatus::degradesFault(cw & (NVME_SMART_CRIT_DEGRADED), true);
+
+        NVMeStatus::mediaFault(cw & ((NVME_SMART_CRIT_MEDIA)), true);
+
+        NVMeStatus::smartWarnings(std::to_string(cw), true);
+
+        for (const char* name : {"BackupDeviceFault", "CapacityFault",
+                                 "TemperatureFault", "DegradesFault",
+                                 "MediaFault", "SmartWarnings"})
+        {
+            changedProps.changed(NVMeStatus::interface, name);
+        }
+
+        if (cw != 0)
+        {
+            markStatus("warning");
+        }
+        else
+        {
+            markStatus("ok");
+        }
+        generateRedfishEventbySmart(cw);
+    }
+    smartWarning = cw;
+}
+
+void NVMeDevice::updateSmartTelemetry(const NVMeMiIntf::BatchResult& result)
+{
+    using Log = nvme_smart_log;
+
+    auto hot = result.view<Log, smartHotLength>();
+    // the composite temperature is in Kelvin, 0 if not reported
+    auto kelvin = hot.get<offsetof(Log, temperature), uint16_t>();
+    if (kelvin != 0)
+    {
+        updateSmartProperty(changedProps, smart.compositeTemperature,
+                            static_cast<double>(kelvin - 273),
+                            "CompositeTemperature");
+    }
+    else if (!std::isnan(smart.compositeTemperature))
+    {
+        updateSmartProperty(changedProps, smart.compositeTemperature,
+                            std::numeric_limits<double>::quiet_NaN(),
+                            "CompositeTemperature");
+    }
+    updateSmartProperty(changedProps, smart.availableSpare,
+                        hot.get<offsetof(Log, avail_spare), uint8_t>(),
+                        "AvailableSpare");
+    updateSmartProperty(changedProps, smart.availableSpareThreshold,
+                        hot.get<offsetof(Log, spare_thresh), uint8_t>(),
+                        "AvailableSpareThreshold");
+    updateSmartProperty(changedProps, smart.percentageUsed,
+                        hot.get<offsetof(Log, percent_used), uint8_t>(),
+                        "PercentageUsed");
+    history->add(DriveHistory::Metric::AvailableSpare, smart.availableSpare);
+
+    auto full = result.view<Log, smartLength>();
+    if (!full)
+    {
+        // only the hot fields were read
+        return;
+    }
+    const std::array counters{
+        std::tuple{&smart.dataUnitsRead, "DataUnitsRead",
+                   full.bytes<offsetof(Log, data_units_read), 16>()},
+        std::tuple{&smart.dataUnitsWritten, "DataUnitsWritten",
+                   full.bytes<offsetof(Log, data_units_written), 16>()},
+        std::tuple{&smart.hostReadCommands, "HostReadCommands",
+                   full.bytes<offsetof(Log, host_reads), 16>()},
+        std::tuple{&smart.hostWriteCommands, "HostWriteCommands",
+                   full.bytes<offsetof(Log, host_writes), 16>()},
+        std::tuple{&smart.controllerBusyTime, "ControllerBusyTime",
+                   full.bytes<offsetof(Log, ctrl_busy_time), 16>()},
+        std::tuple{&smart.powerCycles, "PowerCycles",
+                   full.bytes<offsetof(Log, power_cycles), 16>()},
+        std::tuple{&smart.powerOnHours, "PowerOnHours",
+                   full.bytes<offsetof(Log, power_on_hours), 16>()},
+        std::tuple{&smart.unsafeShutdowns, "UnsafeShutdowns",
+                   full.bytes<offsetof(Log, unsafe_shutdowns), 16>()},
+        std::tuple{&smart.mediaErrors, "MediaErrors",
+                   full.bytes<offsetof(Log, media_errors), 16>()},
+        std::tuple{&smart.errorLogEntries, "ErrorLogEntries",
+                   full.bytes<offsetof(Log, num_err_log_entries), 16>()},
+    };
+    for (const auto& [field, name, bytes] : counters)
+    {
+        updateSmartProperty(changedProps, *field, smartCounter(bytes), name);
+    }
+    history->add(DriveHistory::Metric::MediaErrors,
+                 static_cast<float>(smart.mediaErrors));
+    history->add(DriveHistory::Metric::ErrorLogEntries,
+                 static_cast<float>(smart.errorLogEntries));
+
+    updateSmartProperty(changedProps, smart.warningTemperatureTime,
+                        full.get<offsetof(Log, warning_temp_time), uint32_t>(),
+                        "WarningTemperatureTime");
+    updateSmartProperty(
+        changedProps, smart.criticalTemperatureTime,
+        full.get<offsetof(Log, critical_comp_time), uint32_t>(),
+        "CriticalTemperatureTime");
+    updateSmartProperty(
+        changedProps, smart.thermalTransitions1,
+        full.get<offsetof(Log, thm_temp1_trans_count), uint32_t>(),
+        "ThermalTemp1TransitionCount");
+    updateSmartProperty(
+        changedProps, smart.thermalTransitions2,
+        full.get<offsetof(Log, thm_temp2_trans_count), uint32_t>(),
+        "ThermalTemp2TransitionCount");
+    updateSmartProperty(
+        changedProps, smart.thermalTime1,
+        full.get<offsetof(Log, thm_temp1_total_time), uint32_t>(),
+        "ThermalTemp1TotalTime");
+    updateSmartProperty(
+        changedProps, smart.thermalTime2,
+        full.get<offsetof(Log, thm_temp2_total_time), uint32_t>(),
+        "ThermalTemp2TotalTime");
 }
 
 void NVMeDevice::updateSanitizeStatus(EraseMethod type)
 {
     setEstimateTime(0);
-    Progress::status(OperationStatus::InProgress);
+    sanitizeStart = std::chrono::steady_clock::now();
+    // the progress is sampled at the minimum interval from the start
+    pollInterval.reset();
+    Progress::status(OperationStatus::InProgress, true);
+    changedProps.changed(Progress::interface, "Status");
     inProgress = true;
     setEraseType(type);
     Operation::operation(OperationType::Sanitize, true);
+    changedProps.changed(Operation::interface, "Operation");
+    flushProperties();
 }
 
 void NVMeDevice::erase(uint16_t overwritePasses, EraseMethod type)
@@ -685,59 +1296,59 @@ void NVMeDevice::erase(uint16_t overwritePasses, EraseMethod type)
         return;
     }
 
+    coro::spawn(sanitize(shared_from_this(), overwritePasses, type));
+}
+
+coro::Task<> NVMeDevice::sanitize(std::shared_ptr<NVMeDevice> self,
+                                  uint16_t overwritePasses, EraseMethod type)
+{
+    // self keeps the device alive until the coroutine completes
+    (void)self;
+
+    nvme_sanitize_sanact sanact{};
+    uint8_t owpass = 0;
+    uint32_t pattern = 0;
+    std::string_view name;
     if (type == EraseMethod::Overwrite)
     {
-        uint32_t pattern = ~0x04030201;
-        intf->adminSanitize(
-            ctrl, NVME_SANITIZE_SANACT_START_OVERWRITE, overwritePasses,
-            pattern,
-            [self{shared_from_this()},
-             type](const std::error_code& ec,
-                   __attribute__((unused)) std::span<uint8_t> status) {
-            if (ec)
-            {
-                self->Progress::status(OperationStatus::Failed);
-                self->inProgress = false;
-                lg2::error("fail to do sanitize(Overwite)");
-                return;
-            }
-            self->updateSanitizeStatus(type);
-        });
+        sanact = NVME_SANITIZE_SANACT_START_OVERWRITE;
+        owpass = static_cast<uint8_t>(overwritePasses);
+        pattern = ~0x04030201;
+        name = "Overwite";
     }
-    if (type == EraseMethod::CryptoErase)
+    else if (type == EraseMethod::CryptoErase)
     {
-        intf->adminSanitize(
-            ctrl, NVME_SANITIZE_SANACT_START_CRYPTO_ERASE, 0, 0,
-            [self{shared_from_this()},
-             type](const std::error_code& ec,
-                   __attribute__((unused)) std::span<uint8_t> status) {
-            if (ec)
-            {
-                self->Progress::status(OperationStatus::Failed);
-                self->inProgress = false;
-                lg2::error("fail to do sanitize(CryptoErase)");
-                return;
-            }
-            self->updateSanitizeStatus(type);
-        });
+        sanact = NVME_SANITIZE_SANACT_START_CRYPTO_ERASE;
+        name = "CryptoErase";
     }
-    if (type == EraseMethod::BlockErase)
+    else if (type == EraseMethod::BlockErase)
     {
-        intf->adminSanitize(
-            ctrl, NVME_SANITIZE_SANACT_START_BLOCK_ERASE, 0, 0,
-            [self{shared_from_this()},
-             type](const std::error_code& ec,
-                   __attribute__((unused)) std::span<uint8_t> status) {
-            if (ec)
-            {
-                self->Progress::status(OperationStatus::Failed);
-                self->inProgress = false;
-                lg2::error("fail to do sanitize(BlockErase)");
-                return;
-            }
-            self->updateSanitizeStatus(type);
-        });
+        sanact = NVME_SANITIZE_SANACT_START_BLOCK_ERASE;
+        name = "BlockErase";
     }
+    else
+    {
+        co_return;
+    }
+
+    auto [ec, status] = co_await coro::adminSanitize(*intf, ctrl, sanact,
+                                                     owpass, pattern,
+                                                     cmdOptions());
+    if (ec)
+    {
+        Progress::status(OperationStatus::Failed, true);
+        changedProps.changed(Progress::interface, "Status");
+        flushProperties();
+        inProgress = false;
+        lg2::error("fail to do sanitize({TYPE})", "TYPE", name);
+        co_return;
+    }
+    updateSanitizeStatus(type);
 }
 
-NVMeDevice::~NVMeDevice() {}
+NVMeDevice::~NVMeDevice()
+{
+    objServer.remove_interface(breakerIface);
+    objServer.remove_interface(smartIface);
+    objServer.remove_interface(historyIface);
+}
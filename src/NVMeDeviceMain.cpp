@@ -3,15 +3,19 @@
 
 #include <MCTPDiscovery.hpp>
 #include <NVMeDevice.hpp>
+#include <boost/asio/signal_set.hpp>
 #include <boost/asio/steady_timer.hpp>
 
 #include <iostream>
+#include <limits>
 #include <optional>
 #include <regex>
 #include <vector>
 
 const constexpr char* mctpEpsPath = "/xyz/openbmc_project/mctp";
 
+// spreads the polls of the drives, it outlives them
+std::unique_ptr<PollScheduler> pollScheduler;
 std::unordered_map<uint8_t, std::shared_ptr<NVMeDevice>> driveMap;
 
 static void handleEmEndpoints(const ManagedObjectType& objData)
@@ -182,7 +186,8 @@ static void handleMCTPEndpoints(
             p += std::string(drivePrefix);
             p += std::to_string(eid);
             auto DrivePtr = std::make_shared<NVMeDevice>(
-                io, objectServer, dbusConnection, eid, bus, std::move(addr), p);
+                io, objectServer, dbusConnection, *pollScheduler, eid, bus,
+                std::move(addr), p);
 
             // put drive object to map in order to implement drive removal.
             driveMap.emplace(eid, DrivePtr);
@@ -219,21 +224,42 @@ static void interfaceRemoved(sdbusplus::message::message& message)
         return;
     }
 
-    std::string objectName;
-    boost::container::flat_map<std::string, std::variant<size_t>> values;
+    sdbusplus::message::object_path objectPath;
+    std::vector<std::string> interfaces;
 
     try
     {
-        message.read(objectName, values);
+        message.read(objectPath, interfaces);
 
-        auto findEid = values.find("EID");
-        if (findEid != values.end())
+        if (std::find(interfaces.begin(), interfaces.end(),
+                      NVMeDevice::mctpEpInterface) == interfaces.end())
         {
-            auto obj = findEid->second;
-            auto eid = std::get<size_t>(obj);
-            lg2::info("Remove Drive:{EID}.", "EID", eid);
-            // Todo: implement it for drive hotplug.
+            return;
         }
+
+        // the MCTP endpoint object is named after its EID
+        unsigned long value = std::stoul(objectPath.filename());
+        if (value > std::numeric_limits<uint8_t>::max())
+        {
+            lg2::error("invalid MCTP endpoint EID: {EID}", "EID", value);
+            return;
+        }
+        auto eid = static_cast<uint8_t>(value);
+        auto findDrive = driveMap.find(eid);
+        if (findDrive == driveMap.end())
+        {
+            return;
+        }
+        lg2::info("Remove Drive:{EID}.", "EID", eid);
+        findDrive->second->saveHistory();
+        // drop the queued commands so that they don't hit the removed drive
+        findDrive->second->stop();
+        driveMap.erase(findDrive);
+    }
+    catch (const std::logic_error& e)
+    {
+        // std::stoul throws invalid_argument or out_of_range
+        lg2::error("invalid MCTP endpoint path: {ERRMSG}", "ERRMSG", e.what());
     }
     catch (const sdbusplus::exception::SdBusError& e)
     {
@@ -247,6 +273,9 @@ int main()
     auto bus = std::make_shared<sdbusplus::asio::connection>(io);
     sdbusplus::asio::object_server objectServer(bus, true);
     objectServer.add_manager("/xyz/openbmc_project/inventory/system/nvme");
+    pollScheduler = std::make_unique<PollScheduler>(
+        objectServer, "/xyz/openbmc_project/inventory/system/nvme",
+        std::chrono::seconds(pollIntervalMin));
 
     std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
 
@@ -331,5 +360,32 @@ int main()
     });
     matches.emplace_back(std::move(ifaceRemovedMatch));
 
+    // the trend history of the drives survives a restart
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([&io](const boost::system::error_code& ec, int) {
+        if (ec)
+        {
+            return;
+        }
+        for (const auto& [_, context] : driveMap)
+        {
+            context->saveHistory();
+            context->stop();
+        }
+        driveMap.clear();
+        io.stop();
+    });
+
     io.run();
+
+    // The drives go away on io while the connection and the object server
+    // are alive: the dropped commands complete, and the workers exit with
+    // the last reference to their endpoints.
+    io.restart();
+    while (NVMeMi::hasWorkers())
+    {
+        io.run_for(std::chrono::milliseconds(10));
+    }
+    io.poll();
+    pollScheduler.reset();
 }
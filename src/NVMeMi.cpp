@@ -1,14 +1,23 @@
 
 #include "NVMeMi.hpp"
 
+#include <nvme-mi_config.h>
+
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/steady_timer.hpp>
 #include <boost/endian.hpp>
 #include <phosphor-logging/elog-errors.hpp>
 #include <phosphor-logging/lg2.hpp>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
 #include <cerrno>
+#include <filesystem>
 #include <iostream>
+#include <regex>
 
 std::map<int, std::weak_ptr<NVMeMi::Worker>> NVMeMi::workerMap{};
 
@@ -19,9 +28,11 @@ constexpr size_t maxNVMeMILength = 4096;
 
 NVMeMi::NVMeMi(boost::asio::io_context& io,
                std::shared_ptr<sdbusplus::asio::connection> conn,
+               sdbusplus::asio::object_server& objServer, int bus,
                std::vector<uint8_t> sockName, uint8_t eid) :
     io(io),
-    conn(conn), dbus(*conn.get()), eid(eid)
+    conn(conn), dbus(*conn.get()), bus(bus), eid(eid), xferTime(0),
+    defaultTimeout(0)
 {
     // reset to unassigned nid/eid and endpoint
     nid = -1;
@@ -36,12 +47,16 @@ NVMeMi::NVMeMi(boost::asio::io_context& io,
 
     addr.assign(sockName.begin() + 1, sockName.end());
 
-    // only create one share worker for all drives
-    auto res = workerMap.find(0);
+    // share one worker among the drives behind the same i2c root bus. The
+    // drives with unknown bus fall into the same worker keyed by -1.
+    int rootBus = getRootBus(bus);
+    auto res = workerMap.find(rootBus);
     if (res == workerMap.end() || res->second.expired())
     {
-        worker = std::make_shared<Worker>();
-        workerMap[0] = worker;
+        lg2::info("[addr:{ADDR}] create NVMe-MI worker for i2c root bus {BUS}",
+                  "ADDR", addr, "BUS", rootBus);
+        worker = std::make_shared<Worker>(objServer, rootBus);
+        workerMap[rootBus] = worker;
     }
     else
     {
@@ -60,477 +75,1026 @@ NVMeMi::NVMeMi(boost::asio::io_context& io,
         lg2::error("[addr:{ADDR}] can't open MCTP endpoint {MSG}", "ADDR", addr,
                    "MSG", str);
     }
+    else
+    {
+        defaultTimeout =
+            std::chrono::milliseconds(nvme_mi_ep_get_timeout(nvmeEP));
+    }
+}
+
+NVMeMi::TimedCall NVMeMi::beginCall(uint16_t key, unsigned timeoutMs)
+{
+    std::chrono::milliseconds timeout(timeoutMs);
+    if (timeoutMs == 0)
+    {
+        timeout = latency[key].timeout(
+            defaultTimeout, std::chrono::milliseconds(mctpTimeoutFloor),
+            std::chrono::milliseconds(mctpTimeoutCeiling));
+    }
+    nvme_mi_ep_set_timeout(nvmeEP, static_cast<unsigned>(timeout.count()));
+    return {key, timeout, std::chrono::steady_clock::now()};
 }
 
-NVMeMi::Worker::Worker()
-{ // start worker thread
-    workerStop = false;
-    thread = std::thread([&io = workerIO, &stop = workerStop, &mtx = workerMtx,
-                          &cv = workerCv]() {
-        // With BOOST_ASIO_DISABLE_THREADS, boost::asio::executor_work_guard
-        // issues null_event across the thread, which caused invalid invokation.
-        // We implement a simple invoke machenism based std::condition_variable.
-        while (1)
+void NVMeMi::endCall(const TimedCall& call, int rc, size_t length)
+{
+    int err = errno;
+    auto now = std::chrono::steady_clock::now();
+    if (rc < 0)
+    {
+        // A timed out command took at least the timeout. Recording it as a
+        // sample raises the next timeout, so a drive that became slower is
+        // not timed out forever. Other errors say nothing about the latency.
+        if (err == ETIMEDOUT)
         {
-            io.run();
-            io.restart();
-            {
-                std::unique_lock<std::mutex> lock(mtx);
-                cv.wait(lock);
-                if (stop)
-                {
-                    // exhaust all tasks and exit
-                    io.run();
-                    break;
-                }
-            }
+            latency[call.key].record(call.timeout);
         }
-    });
+    }
+    else
+    {
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                  call.start);
+        size_t messages = std::max<size_t>(
+            1, (length + nvme_mi_xfer_size - 1) / nvme_mi_xfer_size);
+        latency[call.key].record(elapsed / messages);
+    }
+
+    // Only a missing response counts against the endpoint and its bus, any
+    // other outcome shows that both are alive.
+    if (rc < 0 && (err == ETIMEDOUT || err == EIO || err == EHOSTUNREACH ||
+                   err == ENETUNREACH || err == ENXIO))
+    {
+        breaker.failure(now);
+        worker->busFailure(*this, now);
+    }
+    else
+    {
+        breaker.success();
+        worker->busSuccess(*this);
+    }
+    publishBreaker();
+    errno = err;
 }
 
-NVMeMi::Worker::~Worker()
+bool NVMeMi::admit()
 {
-    // close worker
-    workerStop = true;
+    auto now = std::chrono::steady_clock::now();
+    auto verdict = worker->admitBus(*this, now);
+    if (verdict == CircuitBreaker::Admission::Pass)
+    {
+        verdict = breaker.admit(now);
+    }
+    switch (verdict)
     {
-        std::unique_lock<std::mutex> lock(workerMtx);
-        workerCv.notify_all();
+        case CircuitBreaker::Admission::Pass:
+            return true;
+        case CircuitBreaker::Admission::Reject:
+            return false;
+        case CircuitBreaker::Admission::Probe:
+            break;
     }
-    thread.join();
+    publishBreaker();
+
+    // The health status poll is the cheapest command of the endpoint. The
+    // status change flags are left for the next real poll.
+    nvme_mi_nvm_ss_health_status ss_health;
+    auto call = beginCall(miKey(nvme_mi_mi_opcode_subsys_health_status_poll));
+    int rc = nvme_mi_mi_subsystem_health_status_poll(nvmeEP, false,
+                                                     &ss_health);
+    endCall(call, rc);
+    return effectiveBreakerState() == BreakerState::Closed;
 }
-NVMeMi::~NVMeMi()
+
+NVMeMi::BreakerState NVMeMi::effectiveBreakerState() const
 {
-    // closeMCTP();
+    BreakerState state = worker->busState(bus);
+    return state == BreakerState::Closed ? breaker.state() : state;
 }
 
-void NVMeMi::Worker::post(std::function<void(void)>&& func)
+void NVMeMi::publishBreaker()
 {
-    if (!workerStop)
+    BreakerState state = effectiveBreakerState();
+    if (state == breakerState)
     {
-        std::unique_lock<std::mutex> lock(workerMtx);
-        if (!workerStop)
+        return;
+    }
+    breakerState = state;
+    boost::asio::post(io, [self{shared_from_this()}, state]() {
+        static constexpr std::array<const char*, 3> stateName{
+            "closed", "open", "half-open"};
+        lg2::warning("[addr:{ADDR}, eid:{EID}] circuit breaker is {STATE}",
+                     "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                     "STATE", stateName[static_cast<size_t>(state)]);
+        if (self->breakerObserver)
         {
-            workerIO.post(std::move(func));
-            workerCv.notify_all();
-            return;
+            self->breakerObserver(state);
         }
-    }
-    throw std::runtime_error("NVMeMi has been stopped");
+    });
 }
 
-void NVMeMi::post(std::function<void(void)>&& func)
+void NVMeMi::watchBreaker(UniqueFunction<void(BreakerState)>&& cb)
 {
-    worker->post(
-        [self{std::move(shared_from_this())}, func{std::move(func)}]() {
-        std::unique_lock<std::mutex> lock(self->mctpMtx);
-        func();
-    });
+    breakerObserver = std::move(cb);
 }
 
-// Calls .post(), catching runtime_error and returning an error code on failure.
-std::error_code NVMeMi::try_post(std::function<void(void)>&& func)
+int NVMeMi::getRootBus(int bus)
 {
-    try
+    if (bus < 0)
     {
-        post([self{shared_from_this()}, func{std::move(func)}]() { func(); });
+        return -1;
     }
-    catch (const std::runtime_error& e)
+
+    // A muxed bus is a child of the mux device on its parent adapter, e.g.
+    // /sys/devices/.../i2c-3/3-0070/i2c-17. The first i2c adapter along the
+    // canonical sysfs path is the root bus.
+    std::error_code ec;
+    auto path = std::filesystem::canonical(
+        "/sys/bus/i2c/devices/i2c-" + std::to_string(bus), ec);
+    if (ec)
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        return std::make_error_code(std::errc::no_such_device);
+        return bus;
+    }
+
+    static const std::regex adapter("i2c-([0-9]+)");
+    for (const auto& comp : path)
+    {
+        std::smatch match;
+        std::string name = comp.string();
+        if (std::regex_match(name, match, adapter))
+        {
+            return std::stoi(match[1].str());
+        }
     }
-    return std::error_code();
+    return bus;
 }
 
-void NVMeMi::miPCIePortInformation(
-    std::function<void(const std::error_code&, nvme_mi_read_port_info*)>&& cb)
+NVMeMi::Worker::Worker(sdbusplus::asio::object_server& objServer,
+                       int rootBus) :
+    workerStop(false),
+    workerIdle(false), objServer(objServer),
+    bufferPool(std::make_shared<BufferPool>(bufferPoolIdle))
 {
-    if (!nvmeEP)
+    doorbell = eventfd(0, EFD_CLOEXEC);
+    if (doorbell < 0)
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] vme endpoint is invalid", "ADDR",
-                   addr, "EID", static_cast<int>(eid));
-
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), nullptr);
-        });
-        return;
+        throw std::system_error(errno, std::generic_category(),
+                                "fail to create eventfd for NVMeMi worker");
     }
 
-    try
-    {
-        post([self{shared_from_this()}, cb{std::move(cb)}]() {
-            nvme_mi_read_nvm_ss_info ss_info;
-            auto rc = nvme_mi_mi_read_mi_data_subsys(self->nvmeEP, &ss_info);
-            if (rc < 0)
-            {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] mi_read_mi_data_subsys: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
+    // publish the queue depth and the queuing delay of each command class
+    std::string path = "/xyz/openbmc_project/nvme/scheduler/";
+    path += (rootBus < 0) ? "shared" : ("i2c" + std::to_string(rootBus));
+    statsIface = objServer.add_interface(path, "com.nvidia.Nvme.Scheduler");
 
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       nullptr);
-                });
-                return;
-            }
-            else if (rc > 0)
-            {
-                std::string_view errMsg =
-                    statusToString(static_cast<nvme_mi_resp_status>(rc));
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] mi_read_mi_data_subsys: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", errMsg);
+    static constexpr std::array<const char*, numPriority> className{
+        "Interactive", "Lifecycle", "Background"};
+    for (size_t i = 0; i < numPriority; i++)
+    {
+        ClassStats& st = stats[i];
+        statsIface->register_property_r(
+            std::string(className[i]) + "QueueDepth", uint32_t(0),
+            sdbusplus::vtable::property_::none,
+            [&st](const uint32_t&) { return st.depth.load(); });
+        statsIface->register_property_r(
+            std::string(className[i]) + "WaitTimeAvgUs", uint64_t(0),
+            sdbusplus::vtable::property_::none, [&st](const uint64_t&) {
+            uint64_t num = st.dispatched.load();
+            return num ? st.totalWaitUs.load() / num : 0;
+        });
+        statsIface->register_property_r(
+            std::string(className[i]) + "WaitTimeMaxUs", uint64_t(0),
+            sdbusplus::vtable::property_::none,
+            [&st](const uint64_t&) { return st.maxWaitUs.load(); });
+    }
+    statsIface->initialize();
 
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), nullptr);
-                });
-                return;
-            }
-            struct nvme_mi_read_port_info port;
-            memset(&port, 0, sizeof(port));
-            for (auto i = 0; i <= ss_info.nump; i++)
-            {
-                auto rc = nvme_mi_mi_read_mi_data_port(self->nvmeEP, i, &port);
-                if (rc != 0)
-                {
-                    std::string_view errMsg =
-                        statusToString(static_cast<nvme_mi_resp_status>(rc));
-                    lg2::error(
-                        "[addr:{ADDR}, eid:{EID}] mi_read_mi_data_subsys: {ERR}",
-                        "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                        "ERR", errMsg);
-                    self->io.post([cb{std::move(cb)}]() {
-                        cb(std::make_error_code(std::errc::bad_message),
-                           nullptr);
-                    });
-                    return;
-                }
-                // only select PCIe port
-                if (port.portt == 0x1)
-                {
-                    break;
-                }
-            }
+    // start worker thread
+    thread = std::thread([this]() { run(); });
+}
 
-            self->io.post([cb{std::move(cb)}, port{std::move(port)}]() mutable {
-                cb({}, &port);
-            });
-        });
+void NVMeMi::Worker::enqueue(Job&& job)
+{
+    ClassQueue& cq = pending[static_cast<size_t>(job.prio)];
+    NVMeMi* ep = job.ep.get();
+    auto it = cq.flows.find(ep);
+    if (it == cq.flows.end())
+    {
+        if (cq.idle.empty())
+        {
+            it = cq.flows.try_emplace(ep).first;
+        }
+        else
+        {
+            auto node = std::move(cq.idle.back());
+            cq.idle.pop_back();
+            node.key() = ep;
+            it = cq.flows.insert(std::move(node)).position;
+        }
+        cq.active.push_back(ep);
     }
-    catch (const std::runtime_error& e)
+    Flow& flow = it->second;
+    if (spare.empty())
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}]  {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
+        flow.jobs.emplace_back(std::move(job));
         return;
     }
+    spare.front() = std::move(job);
+    flow.jobs.splice(flow.jobs.end(), spare, spare.begin());
 }
 
-void NVMeMi::miSubsystemHealthStatusPoll(
-    std::function<void(const std::error_code&, nvme_mi_nvm_ss_health_status*)>&&
-        cb)
+NVMeMi::Worker::Job NVMeMi::Worker::dequeue(ClassQueue& cq, NVMeMi* ep)
 {
-    if (!nvmeEP)
+    Flow& flow = cq.flows.find(ep)->second;
+    Job job = std::move(flow.jobs.front());
+    spare.splice(spare.end(), flow.jobs, flow.jobs.begin());
+    if (flow.jobs.empty())
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid ", "ADDR",
-                   addr, "EID", static_cast<int>(eid));
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), nullptr);
-        });
-        return;
+        // an idle endpoint doesn't accumulate credit, and the endpoint may
+        // go away once its commands are done
+        flow.deficit = std::chrono::microseconds(0);
+        cq.active.erase(std::find(cq.active.begin(), cq.active.end(), ep));
+        cq.idle.push_back(cq.flows.extract(ep));
     }
 
-    try
+    ClassStats& st = stats[static_cast<size_t>(job.prio)];
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - job.enqueued)
+                          .count();
+    st.depth--;
+    st.dispatched++;
+    st.totalWaitUs += waitUs;
+    if (waitUs > st.maxWaitUs.load())
     {
-        post([self{shared_from_this()}, cb{std::move(cb)}]() {
-            nvme_mi_nvm_ss_health_status ss_health;
-            auto rc = nvme_mi_mi_subsystem_health_status_poll(self->nvmeEP,
-                                                              true, &ss_health);
-            if (rc < 0)
-            {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] subsystem_health_status_poll: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
+        st.maxWaitUs.store(waitUs);
+    }
+    return job;
+}
 
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       nullptr);
-                });
-                return;
-            }
-            else if (rc > 0)
-            {
-                std::string_view errMsg =
-                    statusToString(static_cast<nvme_mi_resp_status>(rc));
+std::optional<NVMeMi::Worker::Job> NVMeMi::Worker::next()
+{
+    auto now = std::chrono::steady_clock::now();
 
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] subsystem_health_status_poll:{MSG}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "MSG", errMsg);
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), nullptr);
-                });
-                return;
+    // the most overdue command among the aged ones goes first
+    std::optional<size_t> pick;
+    NVMeMi* pickEp = nullptr;
+    std::chrono::steady_clock::duration overdue{};
+    for (size_t i = 1; i < numPriority; i++)
+    {
+        for (NVMeMi* ep : pending[i].active)
+        {
+            const Job& head = pending[i].flows.find(ep)->second.jobs.front();
+            auto late = now - head.enqueued - agingLimit[i];
+            if (late >= std::chrono::steady_clock::duration::zero() &&
+                (!pick || late > overdue))
+            {
+                pick = i;
+                pickEp = ep;
+                overdue = late;
             }
-
-            self->io.post(
-                [cb{std::move(cb)}, ss_health{std::move(ss_health)}]() mutable {
-                cb({}, &ss_health);
-            });
-        });
+        }
     }
-    catch (const std::runtime_error& e)
+    if (pick)
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
-        return;
+        return dequeue(pending[*pick], pickEp);
+    }
+
+    // otherwise strict priority, and deficit round-robin within the class
+    for (ClassQueue& cq : pending)
+    {
+        if (cq.active.empty())
+        {
+            continue;
+        }
+        while (true)
+        {
+            NVMeMi* ep = cq.active.front();
+            Flow& flow = cq.flows.find(ep)->second;
+            if (flow.deficit >= ep->xferTime)
+            {
+                return dequeue(cq, ep);
+            }
+            flow.deficit += quantum;
+            cq.active.pop_front();
+            cq.active.push_back(ep);
+        }
     }
+    return std::nullopt;
 }
 
-void NVMeMi::miScanCtrl(std::function<void(const std::error_code&,
-                                           const std::vector<nvme_mi_ctrl_t>&)>
-                            cb)
+void NVMeMi::Worker::charge(const Job& job, std::chrono::microseconds elapsed)
 {
-    if (!nvmeEP)
-    {
-        lg2::error("nvme endpoint is invalid");
+    NVMeMi* ep = job.ep.get();
+    ep->xferTime = (ep->xferTime * 7 + elapsed) / 8;
 
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
-        return;
+    ClassQueue& cq = pending[static_cast<size_t>(job.prio)];
+    auto it = cq.flows.find(ep);
+    if (it != cq.flows.end() && !it->second.jobs.empty())
+    {
+        it->second.deficit -= elapsed;
     }
+}
 
-    try
+CircuitBreaker::Admission
+    NVMeMi::Worker::admitBus(NVMeMi& ep,
+                             std::chrono::steady_clock::time_point now)
+{
+    BusHealth& health = buses[ep.bus];
+    BusMember& member = health.members[&ep];
+    if (member.ep.expired())
     {
-        post([self{shared_from_this()}, cb{std::move(cb)}]() {
-            int rc = nvme_mi_scan_ep(self->nvmeEP, true);
-            if (rc < 0)
-            {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to scan controllers:{ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       {});
-                });
-                return;
-            }
-            else if (rc > 0)
-            {
-                std::string_view errMsg =
-                    statusToString(static_cast<nvme_mi_resp_status>(rc));
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to scan controllers: {MSG}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "MSG", errMsg);
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), {});
-                });
-                return;
-            }
+        // a new endpoint, or a new one at the address of a removed endpoint
+        member = {ep.weak_from_this(), {}};
+    }
 
-            std::vector<nvme_mi_ctrl_t> list;
-            nvme_mi_ctrl_t c;
-            nvme_mi_for_each_ctrl(self->nvmeEP, c)
-            {
-                list.push_back(c);
-            }
-            self->io.post(
-                [cb{std::move(cb)}, list{std::move(list)}]() { cb({}, list); });
-        });
+    auto verdict = health.breaker.admit(now);
+    if (verdict == CircuitBreaker::Admission::Probe)
+    {
+        lg2::info("i2c bus {BUS} probe through [addr:{ADDR}, eid:{EID}]",
+                  "BUS", ep.bus, "ADDR", ep.addr, "EID",
+                  static_cast<int>(ep.eid));
+        publishBus(health);
     }
-    catch (const std::runtime_error& e)
+    return verdict;
+}
+
+void NVMeMi::Worker::busSuccess(NVMeMi& ep)
+{
+    BusHealth& health = buses[ep.bus];
+    health.members[&ep].lastFailure = {};
+    if (health.breaker.state() == BreakerState::Closed)
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
         return;
     }
+    health.breaker.success();
+    lg2::info("i2c bus {BUS} recovered, resume polling", "BUS", ep.bus);
+    publishBus(health);
 }
 
-void NVMeMi::adminIdentify(
-    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
-    uint16_t read_length,
-    std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb)
+void NVMeMi::Worker::busFailure(NVMeMi& ep,
+                                std::chrono::steady_clock::time_point now)
 {
-    if (!nvmeEP)
+    BusHealth& health = buses[ep.bus];
+    health.members[&ep].lastFailure = now;
+    if (health.breaker.state() == BreakerState::HalfOpen)
+    {
+        // the probe failed, the bus stays down for a longer backoff
+        health.breaker.failure(now);
+        publishBus(health);
+        return;
+    }
+    if (health.breaker.state() != BreakerState::Closed)
     {
-        lg2::error("nvme endpoint is invalid");
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
         return;
     }
 
-    lg2::debug("[eid:{EID}] identify cmd resp length: {RSPLEN}", "EID",
-               static_cast<int>(eid), "RSPLEN",
-               static_cast<unsigned int>(read_length));
+    std::erase_if(health.members,
+                  [](const auto& item) { return item.second.ep.expired(); });
+    size_t failed = 0;
+    for (const auto& [_, member] : health.members)
+    {
+        if (member.lastFailure != std::chrono::steady_clock::time_point{} &&
+            now - member.lastFailure < faultWindow)
+        {
+            failed++;
+        }
+    }
+    if (failed < 2 || failed * 2 <= health.members.size())
+    {
+        return;
+    }
+    // one log for the bus instead of one per drive
+    lg2::error("i2c bus {BUS} fault: {FAILED} of {TOTAL} endpoints are not "
+               "responding, suspend polling",
+               "BUS", ep.bus, "FAILED", failed, "TOTAL",
+               health.members.size());
+    health.breaker.trip(now);
+    publishBus(health);
+}
 
-    if ((read_length > 0) && (read_length < NVME_IDENTIFY_DATA_SIZE))
-        NVMeMi::adminIdentifyPartial(ctrl, cns, nsid, cntid, read_length,
-                                     std::move(cb));
-    else
-        NVMeMi::adminIdentifyFull(ctrl, cns, nsid, cntid, std::move(cb));
+NVMeMi::BreakerState NVMeMi::Worker::busState(int bus) const
+{
+    auto it = buses.find(bus);
+    return it == buses.end() ? BreakerState::Closed
+                             : it->second.breaker.state();
 }
 
-void NVMeMi::adminIdentifyFull(
-    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
-    std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb)
+void NVMeMi::Worker::publishBus(const BusHealth& health)
 {
-    try
+    for (const auto& [_, member] : health.members)
     {
-        post([ctrl, cns, nsid, cntid, self{shared_from_this()},
-              cb{std::move(cb)}]() {
-            int rc = 0;
-            std::vector<uint8_t> data;
-
-            data.resize(NVME_IDENTIFY_DATA_SIZE);
-            nvme_identify_args args{};
-            memset(&args, 0, sizeof(args));
-            args.result = nullptr;
-            args.data = data.data();
-            args.args_size = sizeof(args);
-            args.cns = cns;
-            args.csi = NVME_CSI_NVM;
-            args.nsid = nsid;
-            args.cntid = cntid;
-            args.cns_specific_id = NVME_CNSSPECID_NONE;
-            args.uuidx = NVME_UUID_NONE,
+        if (auto ep = member.ep.lock())
+        {
+            ep->publishBreaker();
+            // the last reference to the endpoint is dropped on io, see
+            // retire()
+            boost::asio::io_context& io = ep->io;
+            boost::asio::post(io, [ep{std::move(ep)}]() {});
+        }
+    }
+}
 
-            rc = nvme_mi_admin_identify(ctrl, &args);
+void NVMeMi::Worker::run()
+{
+    while (true)
+    {
+        // Sort the newly arrived commands before each dispatch, so that a
+        // command of higher class overtakes the backlog at the next
+        // transaction boundary.
+        while (auto job = queue.pop())
+        {
+            enqueue(std::move(*job));
+        }
 
-            if (rc < 0)
+        if (auto job = next())
+        {
+            auto start = std::chrono::steady_clock::now();
+            if ((job->cancel && job->cancel->isCancelled()) ||
+                start > job->deadline)
             {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to do nvme identify: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       {});
-                });
-                return;
+                // stale command, drop it before it touches the bus
+                job->func(std::make_error_code(std::errc::operation_canceled));
+                retire(std::move(*job));
+                continue;
             }
-            else if (rc > 0)
             {
-                std::string_view errMsg =
-                    statusToString(static_cast<nvme_mi_resp_status>(rc));
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to do nvme identify: {MSG}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "MSG", errMsg);
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), {});
-                });
-                return;
+                std::unique_lock<std::mutex> lock(job->ep->mctpMtx);
+                if (job->ep->admit())
+                {
+                    job->func({});
+                }
+                else
+                {
+                    // the drive is down, don't wait for another timeout
+                    job->func(
+                        std::make_error_code(std::errc::host_unreachable));
+                }
             }
+            charge(*job, std::chrono::duration_cast<std::chrono::microseconds>(
+                             std::chrono::steady_clock::now() - start));
+            retire(std::move(*job));
+            continue;
+        }
 
-            self->io.post([cb{std::move(cb)}, data{std::move(data)}]() mutable {
-                std::span<uint8_t> span{data.data(), data.size()};
-                cb({}, span);
-            });
-        });
-    }
-    catch (const std::runtime_error& e)
-    {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
-        return;
+        if (workerStop.load())
+        {
+            // all tasks are exhausted
+            break;
+        }
+
+        // Announce the idle state before the last check on the queue, so that
+        // a producer either sees the flag and rings the doorbell or its
+        // command is seen by the check below.
+        workerIdle.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!queue.empty() || workerStop.load())
+        {
+            workerIdle.store(false);
+            continue;
+        }
+
+        uint64_t count = 0;
+        while (read(doorbell, &count, sizeof(count)) < 0 && errno == EINTR)
+        {}
+        workerIdle.store(false);
     }
 }
 
-void NVMeMi::adminIdentifyPartial(
-    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
-    uint16_t read_length,
-    std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb)
+void NVMeMi::Worker::retire(Job&& job)
 {
-    try
-    {
-        post([ctrl, cns, nsid, cntid, read_length, self{shared_from_this()},
-              cb{std::move(cb)}]() {
-            int rc = 0;
-            std::vector<uint8_t> data;
-            switch (cns)
-            {
-                case NVME_IDENTIFY_CNS_SECONDARY_CTRL_LIST:
-                    data.resize(sizeof(nvme_secondary_ctrl_list));
-                    break;
-
-                default:
-                    data.resize(read_length);
-            }
+    boost::asio::io_context& io = job.ep->io;
+    boost::asio::post(io, [ep{std::move(job.ep)},
+                           func{std::move(job.func)}]() {});
+}
 
-            nvme_identify_args args{};
-            memset(&args, 0, sizeof(args));
-            args.result = nullptr;
-            args.data = data.data();
-            args.args_size = sizeof(args);
-            args.cns = cns;
-            args.csi = NVME_CSI_NVM;
-            args.nsid = nsid;
-            args.cntid = cntid;
-            args.cns_specific_id = NVME_CNSSPECID_NONE;
-            args.uuidx = NVME_UUID_NONE,
+NVMeMi::Worker::~Worker()
+{
+    // the getters of the stats read the worker
+    objServer.remove_interface(statsIface);
 
-            rc = nvme_mi_admin_identify_partial(ctrl, &args, 0, data.size());
+    // close worker
+    workerStop.store(true);
+    uint64_t one = 1;
+    while (write(doorbell, &one, sizeof(one)) < 0 && errno == EINTR)
+    {}
+    if (thread.get_id() == std::this_thread::get_id())
+    {
+        // The worker thread dropped the last endpoint, which retire() is
+        // there to prevent. Joining would throw.
+        lg2::error("NVMe-MI worker destroyed by its own thread");
+        thread.detach();
+    }
+    else
+    {
+        thread.join();
+    }
+    close(doorbell);
+}
+bool NVMeMi::hasWorkers()
+{
+    return std::any_of(workerMap.begin(), workerMap.end(),
+                       [](const auto& item) { return !item.second.expired(); });
+}
 
-            if (rc < 0)
-            {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to do nvme identify partial: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       {});
-                });
-                return;
-            }
-            else if (rc > 0)
+NVMeMi::~NVMeMi()
+{
+    // closeMCTP();
+}
+
+std::error_code NVMeMi::Worker::post(Priority prio,
+                                     std::shared_ptr<NVMeMi> ep,
+                                     const CommandOptions& opts, Task& func)
+{
+    if (workerStop.load())
+    {
+        return std::make_error_code(std::errc::no_such_device);
+    }
+
+    ClassStats& st = stats[static_cast<size_t>(prio)];
+    st.depth++;
+    auto deadline =
+        opts.deadline.value_or(std::chrono::steady_clock::time_point::max());
+    Job job{prio, std::move(ep), std::chrono::steady_clock::now(), deadline,
+            opts.cancel, std::move(func)};
+    if (!queue.push(std::move(job)))
+    {
+        st.depth--;
+        func = std::move(job.func);
+        return std::make_error_code(std::errc::device_or_resource_busy);
+    }
+
+    // only ring the doorbell if the worker is (about to be) blocked on it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (workerIdle.exchange(false))
+    {
+        uint64_t one = 1;
+        while (write(doorbell, &one, sizeof(one)) < 0 && errno == EINTR)
+        {}
+    }
+    return {};
+}
+
+void NVMeMi::post(Priority prio, const CommandOptions& opts, Task&& func)
+{
+    // the worker holds mctpMtx of the endpoint while running the func
+    std::error_code ec = worker->post(opts.priority.value_or(prio),
+                                      shared_from_this(), opts, func);
+    if (ec)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] fail to queue the command: {MSG}",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "MSG",
+                   ec.message());
+        func(ec);
+    }
+}
+
+bool NVMeMi::coalesceRead(const ReadKey& key, ReadCallback& cb)
+{
+    auto it = inflightReads.find(key);
+    bool inserted = it == inflightReads.end();
+    if (inserted && !spareRead.empty())
+    {
+        spareRead.key() = key;
+        it = inflightReads.insert(std::move(spareRead)).position;
+    }
+    else if (inserted)
+    {
+        it = inflightReads.try_emplace(key).first;
+    }
+    it->second.emplace_back(std::move(cb));
+    if (!inserted)
+    {
+        lg2::debug("[addr:{ADDR}, eid:{EID}] coalesce read, opcode {OPCODE}",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "OPCODE",
+                   static_cast<int>(key.opcode));
+        return true;
+    }
+
+    // The result is delivered on io, the same thread issuing the reads. All
+    // waiters share the same buffer.
+    cb = [self{shared_from_this()}, key](const std::error_code& ec,
+                                         std::span<uint8_t> data) {
+        auto node = self->inflightReads.extract(key);
+        if (node.empty())
+        {
+            return;
+        }
+        for (auto& waiter : node.mapped())
+        {
+            waiter(ec, data);
+        }
+        node.mapped().clear();
+        self->spareRead = std::move(node);
+    };
+    return false;
+}
+
+void NVMeMi::miPCIePortInformation(
+    UniqueFunction<void(const std::error_code&, nvme_mi_read_port_info*)>&& cb,
+    const CommandOptions& opts)
+{
+    if (!nvmeEP)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] vme endpoint is invalid", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::no_such_device), nullptr);
+        });
+        return;
+    }
+
+    post(Priority::Lifecycle, opts,
+         [self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, nullptr); });
+            return;
+        }
+
+        nvme_mi_read_nvm_ss_info ss_info;
+        auto call = self->beginCall(miKey(nvme_mi_mi_opcode_mi_data_read));
+        auto rc = nvme_mi_mi_read_mi_data_subsys(self->nvmeEP, &ss_info);
+        self->endCall(call, rc);
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] mi_read_mi_data_subsys: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   nullptr);
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] mi_read_mi_data_subsys: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", errMsg);
+
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), nullptr);
+            });
+            return;
+        }
+        struct nvme_mi_read_port_info port;
+        memset(&port, 0, sizeof(port));
+        for (auto i = 0; i <= ss_info.nump; i++)
+        {
+            call = self->beginCall(miKey(nvme_mi_mi_opcode_mi_data_read));
+            auto rc = nvme_mi_mi_read_mi_data_port(self->nvmeEP, i, &port);
+            self->endCall(call, rc);
+            if (rc != 0)
             {
                 std::string_view errMsg =
                     statusToString(static_cast<nvme_mi_resp_status>(rc));
                 lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to do nvme identify partial: {MSG}",
+                    "[addr:{ADDR}, eid:{EID}] mi_read_mi_data_subsys: {ERR}",
                     "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "MSG", errMsg);
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), {});
+                    "ERR", errMsg);
+                boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                    cb(std::make_error_code(std::errc::bad_message),
+                       nullptr);
                 });
                 return;
             }
+            // only select PCIe port
+            if (port.portt == 0x1)
+            {
+                break;
+            }
+        }
+
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, port{std::move(port)}]() mutable {
+            cb({}, &port);
+        });
+    });
+}
+
+void NVMeMi::miSubsystemHealthStatusPoll(
+    UniqueFunction<void(const std::error_code&,
+                        nvme_mi_nvm_ss_health_status*)>&& cb,
+    const CommandOptions& opts)
+{
+    if (!nvmeEP)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid ", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::no_such_device), nullptr);
+        });
+        return;
+    }
+
+    post(Priority::Background, opts,
+         [self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, nullptr); });
+            return;
+        }
+
+        nvme_mi_nvm_ss_health_status ss_health;
+        auto call = self->beginCall(
+            miKey(nvme_mi_mi_opcode_subsys_health_status_poll));
+        auto rc = nvme_mi_mi_subsystem_health_status_poll(self->nvmeEP,
+                                                          true, &ss_health);
+        self->endCall(call, rc);
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] subsystem_health_status_poll: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   nullptr);
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
 
-            self->io.post([cb{std::move(cb)}, data{std::move(data)}]() mutable {
-                std::span<uint8_t> span{data.data(), data.size()};
-                cb({}, span);
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] subsystem_health_status_poll:{MSG}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg);
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), nullptr);
             });
+            return;
+        }
+
+        boost::asio::post(self->io,
+            [cb{std::move(cb)}, ss_health{std::move(ss_health)}]() mutable {
+            cb({}, &ss_health);
+        });
+    });
+}
+
+void NVMeMi::miScanCtrl(UniqueFunction<void(const std::error_code&,
+                                            const std::vector<nvme_mi_ctrl_t>&)>
+                            cb,
+                        const CommandOptions& opts)
+{
+    if (!nvmeEP)
+    {
+        lg2::error("nvme endpoint is invalid");
+
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::no_such_device), {});
         });
+        return;
     }
-    catch (const std::runtime_error& e)
+
+    post(Priority::Lifecycle, opts,
+         [self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
+
+        // the scan reads the controller list from the MI data structure
+        auto call = self->beginCall(miKey(nvme_mi_mi_opcode_mi_data_read));
+        int rc = nvme_mi_scan_ep(self->nvmeEP, true);
+        self->endCall(call, rc);
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to scan controllers:{ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {});
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to scan controllers: {MSG}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg);
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), {});
+            });
+            return;
+        }
+
+        std::vector<nvme_mi_ctrl_t> list;
+        nvme_mi_ctrl_t c;
+        nvme_mi_for_each_ctrl(self->nvmeEP, c)
+        {
+            list.push_back(c);
+        }
+        boost::asio::post(self->io,
+            [cb{std::move(cb)}, list{std::move(list)}]() { cb({}, list); });
+    });
+}
+
+void NVMeMi::adminIdentify(
+    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
+    uint16_t read_length,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    if (!nvmeEP)
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
+        lg2::error("nvme endpoint is invalid");
+        boost::asio::post(io, [cb{std::move(cb)}]() {
             cb(std::make_error_code(std::errc::no_such_device), {});
         });
         return;
     }
+
+    lg2::debug("[eid:{EID}] identify cmd resp length: {RSPLEN}", "EID",
+               static_cast<int>(eid), "RSPLEN",
+               static_cast<unsigned int>(read_length));
+
+    if (coalesceRead({ctrl, nvme_admin_identify, static_cast<uint8_t>(cns),
+                      nsid, cntid, 0, 0, read_length, opts.cancel.get()},
+                     cb))
+    {
+        return;
+    }
+
+    if ((read_length > 0) && (read_length < NVME_IDENTIFY_DATA_SIZE))
+        NVMeMi::adminIdentifyPartial(ctrl, cns, nsid, cntid, read_length,
+                                     std::move(cb), opts);
+    else
+        NVMeMi::adminIdentifyFull(ctrl, cns, nsid, cntid, std::move(cb),
+                                  opts);
+}
+
+void NVMeMi::adminIdentifyFull(
+    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    post(Priority::Lifecycle, opts,
+         [ctrl, cns, nsid, cntid, self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
+
+        int rc = 0;
+        BufferPool::Lease data = self->worker->lease();
+
+        data.resize(NVME_IDENTIFY_DATA_SIZE);
+        nvme_identify_args args{};
+        memset(&args, 0, sizeof(args));
+        args.result = nullptr;
+        args.data = data.data();
+        args.args_size = sizeof(args);
+        args.cns = cns;
+        args.csi = NVME_CSI_NVM;
+        args.nsid = nsid;
+        args.cntid = cntid;
+        args.cns_specific_id = NVME_CNSSPECID_NONE;
+        args.uuidx = NVME_UUID_NONE;
+
+        auto call = self->beginCall(adminKey(nvme_admin_identify));
+        rc = nvme_mi_admin_identify(ctrl, &args);
+        self->endCall(call, rc, data.size());
+
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to do nvme identify: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {});
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to do nvme identify: {MSG}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg);
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), {});
+            });
+            return;
+        }
+
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, data{std::move(data)}]() mutable {
+            std::span<uint8_t> span{data.data(), data.size()};
+            cb({}, span);
+        });
+    });
+}
+
+void NVMeMi::adminIdentifyPartial(
+    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
+    uint16_t read_length,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    post(Priority::Lifecycle, opts,
+         [ctrl, cns, nsid, cntid, read_length, self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
+
+        int rc = 0;
+        BufferPool::Lease data = self->worker->lease();
+        switch (cns)
+        {
+            case NVME_IDENTIFY_CNS_SECONDARY_CTRL_LIST:
+                data.resize(sizeof(nvme_secondary_ctrl_list));
+                break;
+
+            default:
+                data.resize(read_length);
+        }
+
+        nvme_identify_args args{};
+        memset(&args, 0, sizeof(args));
+        args.result = nullptr;
+        args.data = data.data();
+        args.args_size = sizeof(args);
+        args.cns = cns;
+        args.csi = NVME_CSI_NVM;
+        args.nsid = nsid;
+        args.cntid = cntid;
+        args.cns_specific_id = NVME_CNSSPECID_NONE;
+        args.uuidx = NVME_UUID_NONE;
+
+        auto call = self->beginCall(adminKey(nvme_admin_identify));
+        rc = nvme_mi_admin_identify_partial(ctrl, &args, 0, data.size());
+        self->endCall(call, rc, data.size());
+
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to do nvme identify partial: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {});
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to do nvme identify partial: {MSG}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg);
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), {});
+            });
+            return;
+        }
+
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, data{std::move(data)}]() mutable {
+            std::span<uint8_t> span{data.data(), data.size()};
+            cb({}, span);
+        });
+    });
 }
 
 static int nvme_mi_admin_get_log_telemetry_host_rae(nvme_mi_ctrl_t ctrl,
@@ -543,7 +1107,7 @@ static int nvme_mi_admin_get_log_telemetry_host_rae(nvme_mi_ctrl_t ctrl,
 // Get Temetery Log header and return the size for hdr + data area (Area 1, 2,
 // 3, or maybe 4)
 int getTelemetryLog(nvme_mi_ctrl_t ctrl, bool host, bool create,
-                    std::vector<uint8_t>& data)
+                    BufferPool::Lease& data)
 {
     int rc = 0;
     data.resize(sizeof(nvme_telemetry_log));
@@ -591,505 +1155,811 @@ int getTelemetryLog(nvme_mi_ctrl_t ctrl, bool host, bool create,
 void NVMeMi::adminSanitize(
     nvme_mi_ctrl_t ctrl, nvme_sanitize_sanact sanact, uint8_t owpass,
     uint32_t owpattern,
-    std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb)
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
 {
     if (!nvmeEP)
     {
         lg2::error("nvme endpoint is invalid");
-        io.post([cb{std::move(cb)}]() {
+        boost::asio::post(io, [cb{std::move(cb)}]() {
             cb(std::make_error_code(std::errc::no_such_device), {});
         });
         return;
     }
-    try
-    {
-        post([ctrl, sanact, owpass, owpattern, self{shared_from_this()},
-              cb{std::move(cb)}]() {
-            int rc = 0;
-            std::vector<uint8_t> data(8);
-            struct nvme_sanitize_nvm_args args;
-            memset(&args, 0, sizeof(args));
+    post(Priority::Interactive, opts,
+         [ctrl, sanact, owpass, owpattern, self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
 
-            args.args_size = sizeof(args);
-            args.sanact = sanact;
-            args.owpass = owpass;
-            args.nodas = 0x1;
-            args.ovrpat = owpattern;
-            args.result = (uint32_t*)data.data();
-
-            rc = nvme_mi_admin_sanitize_nvm(ctrl, &args);
-            if (rc < 0)
-            {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to do nvme sanitize: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       {});
-                });
-                return;
-            }
-            else if (rc > 0)
-            {
-                std::string_view errMsg =
-                    statusToString(static_cast<nvme_mi_resp_status>(rc));
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to do nvme sanitize: {MSG} rc: {RC}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "MSG", errMsg, "RC", std::to_string(rc));
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), {});
-                });
-                return;
-            }
+        int rc = 0;
+        BufferPool::Lease data = self->worker->lease();
+        data.resize(8);
+        struct nvme_sanitize_nvm_args args;
+        memset(&args, 0, sizeof(args));
 
-            self->io.post([cb{std::move(cb)}, data{std::move(data)}]() mutable {
-                std::span<uint8_t> span{data.data(), data.size()};
-                cb({}, span);
+        args.args_size = sizeof(args);
+        args.sanact = sanact;
+        args.owpass = owpass;
+        args.nodas = 0x1;
+        args.ovrpat = owpattern;
+        args.result = (uint32_t*)data.data();
+
+        auto call = self->beginCall(adminKey(nvme_admin_sanitize_nvm));
+        rc = nvme_mi_admin_sanitize_nvm(ctrl, &args);
+        self->endCall(call, rc);
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to do nvme sanitize: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {});
             });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to do nvme sanitize: {MSG} rc: {RC}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg, "RC", std::to_string(rc));
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), {});
+            });
+            return;
+        }
+
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, data{std::move(data)}]() mutable {
+            std::span<uint8_t> span{data.data(), data.size()};
+            cb({}, span);
         });
-    }
-    catch (const std::runtime_error& e)
-    {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {});
-        });
-        return;
-    }
+    });
     return;
 }
 
 void NVMeMi::adminGetLogPage(
     nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint32_t nsid, uint8_t lsp,
     uint16_t lsi,
-    std::function<void(const std::error_code&, std::span<uint8_t>)>&& cb)
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
 {
     if (!nvmeEP)
     {
         lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid", "ADDR",
                    addr, "EID", static_cast<int>(eid));
-        io.post([cb{std::move(cb)}]() {
+        boost::asio::post(io, [cb{std::move(cb)}]() {
             cb(std::make_error_code(std::errc::no_such_device), {});
         });
         return;
     }
 
-    try
+    if (coalesceRead({ctrl, nvme_admin_get_log_page, static_cast<uint8_t>(lid),
+                      nsid, lsi, lsp, 0, 0, opts.cancel.get()},
+                     cb))
     {
-        post([ctrl, nsid, lid, lsp, lsi, self{shared_from_this()},
-              cb{std::move(cb)}]() {
-            std::vector<uint8_t> data;
+        return;
+    }
+
+    // telemetry is pulled on demand of the D-Bus client, the rest are polled
+    Priority prio = (lid == NVME_LOG_LID_TELEMETRY_HOST ||
+                     lid == NVME_LOG_LID_TELEMETRY_CTRL)
+                        ? Priority::Interactive
+                        : Priority::Background;
+    post(prio, opts,
+         [ctrl, nsid, lid, lsp, lsi, self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
 
-            int rc = 0;
-            switch (lid)
+        BufferPool::Lease data = self->worker->lease();
+
+        // the telemetry log takes several messages, whose latency is learned
+        // per message
+        auto call = self->beginCall(adminKey(nvme_admin_get_log_page));
+        int rc = 0;
+        switch (lid)
+        {
+            case NVME_LOG_LID_ERROR:
             {
-                case NVME_LOG_LID_ERROR:
+                data.resize(nvme_mi_xfer_size);
+                // The number of entries for most recent error logs.
+                // Currently we only do one nvme mi transfer for the
+                // error log to avoid blocking other tasks
+                static constexpr int num = nvme_mi_xfer_size /
+                                           sizeof(nvme_error_log_page);
+                nvme_error_log_page* log =
+                    reinterpret_cast<nvme_error_log_page*>(data.data());
+
+                rc = nvme_mi_admin_get_log_error(ctrl, num, false, log);
+                if (rc)
                 {
-                    data.resize(nvme_mi_xfer_size);
-                    // The number of entries for most recent error logs.
-                    // Currently we only do one nvme mi transfer for the
-                    // error log to avoid blocking other tasks
-                    static constexpr int num = nvme_mi_xfer_size /
-                                               sizeof(nvme_error_log_page);
-                    nvme_error_log_page* log =
-                        reinterpret_cast<nvme_error_log_page*>(data.data());
-
-                    rc = nvme_mi_admin_get_log_error(ctrl, num, false, log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get error log",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get error log",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
-                break;
-                case NVME_LOG_LID_SMART:
+            }
+            break;
+            case NVME_LOG_LID_SMART:
+            {
+                data.resize(sizeof(nvme_smart_log));
+                nvme_smart_log* log =
+                    reinterpret_cast<nvme_smart_log*>(data.data());
+
+                constexpr int read_len = sizeof(nvme_smart_log) -
+                                         sizeof(log->rsvd232);
+                rc = nvme_mi_admin_get_nsid_log(ctrl, false, lid, nsid,
+                                                read_len, log);
+                if (rc)
                 {
-                    data.resize(sizeof(nvme_smart_log));
-                    nvme_smart_log* log =
-                        reinterpret_cast<nvme_smart_log*>(data.data());
-
-                    constexpr int read_len = sizeof(nvme_smart_log) -
-                                             sizeof(log->rsvd232);
-                    rc = nvme_mi_admin_get_nsid_log(ctrl, false, lid, nsid,
-                                                    read_len, log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get smart log",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get smart log",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
-                break;
-                case NVME_LOG_LID_FW_SLOT:
+            }
+            break;
+            case NVME_LOG_LID_FW_SLOT:
+            {
+                data.resize(sizeof(nvme_firmware_slot));
+                nvme_firmware_slot* log =
+                    reinterpret_cast<nvme_firmware_slot*>(data.data());
+                rc = nvme_mi_admin_get_log_fw_slot(ctrl, false, log);
+                if (rc)
                 {
-                    data.resize(sizeof(nvme_firmware_slot));
-                    nvme_firmware_slot* log =
-                        reinterpret_cast<nvme_firmware_slot*>(data.data());
-                    rc = nvme_mi_admin_get_log_fw_slot(ctrl, false, log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get firmware slot",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get firmware slot",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
-                break;
-                case NVME_LOG_LID_CMD_EFFECTS:
-                {
-                    data.resize(sizeof(nvme_cmd_effects_log));
-                    nvme_cmd_effects_log* log =
-                        reinterpret_cast<nvme_cmd_effects_log*>(data.data());
-
-                    // nvme rev 1.3 doesn't support csi,
-                    // set to default csi = NVME_CSI_NVM
-                    rc = nvme_mi_admin_get_log_cmd_effects(ctrl, NVME_CSI_NVM,
-                                                           log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get cmd supported and effects log",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+            }
+            break;
+            case NVME_LOG_LID_CMD_EFFECTS:
+            {
+                data.resize(sizeof(nvme_cmd_effects_log));
+                nvme_cmd_effects_log* log =
+                    reinterpret_cast<nvme_cmd_effects_log*>(data.data());
+
+                // nvme rev 1.3 doesn't support csi,
+                // set to default csi = NVME_CSI_NVM
+                rc = nvme_mi_admin_get_log_cmd_effects(ctrl, NVME_CSI_NVM,
+                                                       log);
+                if (rc)
+                {
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get cmd supported and effects log",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
-                break;
-                case NVME_LOG_LID_DEVICE_SELF_TEST:
+            }
+            break;
+            case NVME_LOG_LID_DEVICE_SELF_TEST:
+            {
+                data.resize(sizeof(nvme_self_test_log));
+                nvme_self_test_log* log =
+                    reinterpret_cast<nvme_self_test_log*>(data.data());
+                rc = nvme_mi_admin_get_log_device_self_test(ctrl, log);
+                if (rc)
                 {
-                    data.resize(sizeof(nvme_self_test_log));
-                    nvme_self_test_log* log =
-                        reinterpret_cast<nvme_self_test_log*>(data.data());
-                    rc = nvme_mi_admin_get_log_device_self_test(ctrl, log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get device self test log",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get device self test log",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
-                break;
-                case NVME_LOG_LID_CHANGED_NS:
+            }
+            break;
+            case NVME_LOG_LID_CHANGED_NS:
+            {
+                data.resize(sizeof(nvme_ns_list));
+                nvme_ns_list* log =
+                    reinterpret_cast<nvme_ns_list*>(data.data());
+                rc = nvme_mi_admin_get_log_changed_ns_list(ctrl, false,
+                                                           log);
+                if (rc)
                 {
-                    data.resize(sizeof(nvme_ns_list));
-                    nvme_ns_list* log =
-                        reinterpret_cast<nvme_ns_list*>(data.data());
-                    rc = nvme_mi_admin_get_log_changed_ns_list(ctrl, false,
-                                                               log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get changed namespace list",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get changed namespace list",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
-                break;
-                case NVME_LOG_LID_TELEMETRY_HOST:
-                // fall through to NVME_LOG_LID_TELEMETRY_CTRL
-                case NVME_LOG_LID_TELEMETRY_CTRL:
+            }
+            break;
+            case NVME_LOG_LID_TELEMETRY_HOST:
+            // fall through to NVME_LOG_LID_TELEMETRY_CTRL
+            case NVME_LOG_LID_TELEMETRY_CTRL:
+            {
+                bool host = false;
+                bool create = false;
+                if (lid == NVME_LOG_LID_TELEMETRY_HOST)
                 {
-                    bool host = false;
-                    bool create = false;
-                    if (lid == NVME_LOG_LID_TELEMETRY_HOST)
+                    host = true;
+                    if (lsp == NVME_LOG_TELEM_HOST_LSP_CREATE)
                     {
-                        host = true;
-                        if (lsp == NVME_LOG_TELEM_HOST_LSP_CREATE)
-                        {
-                            create = true;
-                        }
-                        else if (lsp == NVME_LOG_TELEM_HOST_LSP_RETAIN)
-                        {
-                            create = false;
-                        }
-                        else
-                        {
-                            lg2::error(
-                                "[addr:{ADDR}, eid:{EID}] invalid lsp for telemetry host log",
-                                "ADDR", self->addr, "EID",
-                                static_cast<int>(self->eid));
-                            rc = -1;
-                            errno = EINVAL;
-                            break;
-                        }
+                        create = true;
                     }
-                    else
+                    else if (lsp == NVME_LOG_TELEM_HOST_LSP_RETAIN)
                     {
-                        host = false;
+                        create = false;
                     }
-
-                    rc = getTelemetryLog(ctrl, host, create, data);
-                }
-                break;
-                case NVME_LOG_LID_RESERVATION:
-                {
-                    data.resize(sizeof(nvme_resv_notification_log));
-                    nvme_resv_notification_log* log =
-                        reinterpret_cast<nvme_resv_notification_log*>(
-                            data.data());
-
-                    int rc = nvme_mi_admin_get_log_reservation(ctrl, false,
-                                                               log);
-                    if (rc)
+                    else
                     {
                         lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get reservation notification log",
+                            "[addr:{ADDR}, eid:{EID}] invalid lsp for telemetry host log",
                             "ADDR", self->addr, "EID",
                             static_cast<int>(self->eid));
+                        rc = -1;
+                        errno = EINVAL;
                         break;
                     }
                 }
-                break;
-                case NVME_LOG_LID_SANITIZE:
+                else
                 {
-                    data.resize(sizeof(nvme_sanitize_log_page));
-                    nvme_sanitize_log_page* log =
-                        reinterpret_cast<nvme_sanitize_log_page*>(data.data());
-
-                    int rc = nvme_mi_admin_get_log_sanitize(ctrl, false, log);
-                    if (rc)
-                    {
-                        lg2::error(
-                            "[addr:{ADDR}, eid:{EID}] fail to get sanitize status log",
-                            "ADDR", self->addr, "EID",
-                            static_cast<int>(self->eid));
-                        break;
-                    }
+                    host = false;
                 }
-                break;
-                default:
+
+                rc = getTelemetryLog(ctrl, host, create, data);
+            }
+            break;
+            case NVME_LOG_LID_RESERVATION:
+            {
+                data.resize(sizeof(nvme_resv_notification_log));
+                nvme_resv_notification_log* log =
+                    reinterpret_cast<nvme_resv_notification_log*>(
+                        data.data());
+
+                rc = nvme_mi_admin_get_log_reservation(ctrl, false, log);
+                if (rc)
                 {
                     lg2::error(
-                        "[addr:{ADDR}, eid:{EID}] unknown lid for GetLogPage",
-                        "ADDR", self->addr, "EID", static_cast<int>(self->eid));
-                    rc = -1;
-                    errno = EINVAL;
+                        "[addr:{ADDR}, eid:{EID}] fail to get reservation notification log",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
                 }
             }
-
-            if (rc < 0)
+            break;
+            case NVME_LOG_LID_SANITIZE:
             {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to get log page {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       {});
-                });
-                return;
+                data.resize(sizeof(nvme_sanitize_log_page));
+                nvme_sanitize_log_page* log =
+                    reinterpret_cast<nvme_sanitize_log_page*>(data.data());
+
+                rc = nvme_mi_admin_get_log_sanitize(ctrl, false, log);
+                if (rc)
+                {
+                    lg2::error(
+                        "[addr:{ADDR}, eid:{EID}] fail to get sanitize status log",
+                        "ADDR", self->addr, "EID",
+                        static_cast<int>(self->eid));
+                    break;
+                }
             }
-            else if (rc > 0)
+            break;
+            default:
             {
-                std::string_view errMsg =
-                    statusToString(static_cast<nvme_mi_resp_status>(rc));
-
                 lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to get log page: {MSG}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "MSG", errMsg);
-                self->io.post([cb{std::move(cb)}]() {
-                    cb(std::make_error_code(std::errc::bad_message), {});
-                    return;
-                });
+                    "[addr:{ADDR}, eid:{EID}] unknown lid for GetLogPage",
+                    "ADDR", self->addr, "EID", static_cast<int>(self->eid));
+                rc = -1;
+                errno = EINVAL;
             }
+        }
+        self->endCall(call, rc, data.size());
+
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to get log page {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {});
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
 
-            self->io.post([cb{std::move(cb)}, data{std::move(data)}]() mutable {
-                std::span<uint8_t> span{data.data(), data.size()};
-                cb({}, span);
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to get log page: {MSG}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg);
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), {});
             });
+            return;
+        }
+
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, data{std::move(data)}]() mutable {
+            std::span<uint8_t> span{data.data(), data.size()};
+            cb({}, span);
         });
-    }
-    catch (const std::runtime_error& e)
+    });
+}
+
+void NVMeMi::adminGetLog(
+    nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint32_t nsid, uint8_t lsp,
+    uint16_t lsi, uint32_t offset, uint32_t length,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    if (!nvmeEP)
     {
-        lg2::error(
-            "[addr:{ADDR}, eid:{EID}] NVMeMi adminGetLogPage throws: {MSG}",
-            "ADDR", addr, "EID", static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
+        lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+        boost::asio::post(io, [cb{std::move(cb)}]() {
             cb(std::make_error_code(std::errc::no_such_device), {});
         });
         return;
     }
+
+    if (coalesceRead({ctrl, nvme_admin_get_log_page, static_cast<uint8_t>(lid),
+                      nsid, lsi, lsp, offset, length, opts.cancel.get()},
+                     cb))
+    {
+        return;
+    }
+
+    post(Priority::Background, opts,
+         [ctrl, lid, nsid, lsp, lsi, offset, length, self{shared_from_this()},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
+
+        BufferPool::Lease data = self->worker->lease();
+        data.resize(length);
+
+        nvme_get_log_args args{};
+        args.lpo = offset;
+        args.result = nullptr;
+        args.log = data.data();
+        args.args_size = sizeof(args);
+        args.lid = lid;
+        args.len = length;
+        args.nsid = nsid;
+        args.csi = NVME_CSI_NVM;
+        args.lsi = lsi;
+        args.lsp = lsp;
+        args.uuidx = NVME_UUID_NONE;
+        args.rae = false;
+        args.ot = false;
+
+        auto call = self->beginCall(adminKey(nvme_admin_get_log_page));
+        int rc = nvme_mi_admin_get_log(ctrl, &args);
+        self->endCall(call, rc, length);
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to get log page {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {});
+            });
+            return;
+        }
+        else if (rc > 0)
+        {
+            std::string_view errMsg =
+                statusToString(static_cast<nvme_mi_resp_status>(rc));
+
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to get log page: {MSG}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "MSG", errMsg);
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::bad_message), {});
+            });
+            return;
+        }
+
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, data{std::move(data)}]() mutable {
+            std::span<uint8_t> span{data.data(), data.size()};
+            cb({}, span);
+        });
+    });
 }
 
-void NVMeMi::adminXfer(
-    nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& admin_req,
-    std::span<uint8_t> data, unsigned int timeout_ms,
-    std::function<void(const std::error_code&, const nvme_mi_admin_resp_hdr&,
-                       std::span<uint8_t>)>&& cb)
+void NVMeMi::submitBatch(
+    std::span<const BatchCommand> cmds,
+    UniqueFunction<void(const std::error_code&, std::span<const BatchResult>)>&&
+        cb,
+    const CommandOptions& opts)
 {
     if (!nvmeEP)
     {
         lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid", "ADDR",
                    addr, "EID", static_cast<int>(eid));
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device), {}, {});
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::no_such_device), {});
+        });
+        return;
+    }
+    if (cmds.empty() || cmds.size() > maxBatch ||
+        !std::all_of(cmds.begin(), cmds.end(),
+                     [](const BatchCommand& cmd) { return cmd.valid(); }))
+    {
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::invalid_argument), {});
         });
         return;
     }
-    try
-    {
-        std::vector<uint8_t> req(sizeof(nvme_mi_admin_req_hdr) + data.size());
-        memcpy(req.data(), &admin_req, sizeof(nvme_mi_admin_req_hdr));
-        memcpy(req.data() + sizeof(nvme_mi_admin_req_hdr), data.data(),
-               data.size());
-        post([ctrl, req{std::move(req)}, self{shared_from_this()}, timeout_ms,
-              cb{std::move(cb)}]() mutable {
-            int rc = 0;
-
-            nvme_mi_admin_req_hdr* reqHeader =
-                reinterpret_cast<nvme_mi_admin_req_hdr*>(req.data());
-
-            size_t respDataSize =
-                boost::endian::little_to_native<size_t>(reqHeader->dlen);
-            off_t respDataOffset =
-                boost::endian::little_to_native<off_t>(reqHeader->doff);
-            size_t bufSize = sizeof(nvme_mi_admin_resp_hdr) + respDataSize;
-            std::vector<uint8_t> buf(bufSize);
-            nvme_mi_admin_resp_hdr* respHeader =
-                reinterpret_cast<nvme_mi_admin_resp_hdr*>(buf.data());
-
-            // set timeout
-            unsigned timeout = nvme_mi_ep_get_timeout(self->nvmeEP);
-            nvme_mi_ep_set_timeout(self->nvmeEP, timeout_ms);
-
-            rc = nvme_mi_admin_xfer(ctrl, reqHeader,
-                                    req.size() - sizeof(nvme_mi_admin_req_hdr),
-                                    respHeader, respDataOffset, &respDataSize);
-            // revert to previous timeout
-            nvme_mi_ep_set_timeout(self->nvmeEP, timeout);
-
-            if (rc < 0)
+
+    // The batch buffer holds the commands, then a BatchSlot per command and
+    // then the responses, so queueing a batch doesn't allocate.
+    static_assert(std::is_trivially_copyable_v<BatchCommand>);
+    static_assert(sizeof(BatchCommand) % alignof(BatchSlot) == 0);
+    size_t count = cmds.size();
+    BufferPool::Lease batch = worker->lease();
+    batch.resize(count * (sizeof(BatchCommand) + sizeof(BatchSlot)));
+    std::memcpy(batch.data(), cmds.data(), cmds.size_bytes());
+
+    post(Priority::Background, opts,
+         [count, self{shared_from_this()}, batch{std::move(batch)},
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}); });
+            return;
+        }
+
+        // keep each response aligned for the typed views
+        constexpr size_t align = alignof(std::max_align_t);
+        size_t slotsOffset = count * sizeof(BatchCommand);
+        size_t end = slotsOffset + count * sizeof(BatchSlot);
+        for (size_t i = 0; i < count; i++)
+        {
+            BatchCommand cmd;
+            std::memcpy(&cmd, batch.data() + i * sizeof(BatchCommand),
+                        sizeof(cmd));
+
+            BatchSlot slot{};
+            slot.offset = static_cast<uint32_t>((end + align - 1) / align *
+                                                align);
+            slot.length = cmd.length;
+            end = slot.offset + slot.length;
+            batch.resize(end);
+
+            slot.err = self->runBatchCommand(cmd, batch.data() + slot.offset);
+            std::memcpy(batch.data() + slotsOffset + i * sizeof(BatchSlot),
+                        &slot, sizeof(slot));
+        }
+
+        boost::asio::post(self->io, [count, cb{std::move(cb)},
+                                     batch{std::move(batch)}]() mutable {
+            size_t slotsOffset = count * sizeof(BatchCommand);
+            std::array<BatchResult, maxBatch> results;
+            for (size_t i = 0; i < count; i++)
             {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] failed to nvme_mi_admin_xfer",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       {}, {});
-                });
-                return;
+                BatchSlot slot;
+                std::memcpy(&slot,
+                            batch.data() + slotsOffset + i * sizeof(BatchSlot),
+                            sizeof(slot));
+                if (slot.err != 0)
+                {
+                    results[i].ec =
+                        std::make_error_code(static_cast<std::errc>(slot.err));
+                    continue;
+                }
+                results[i].data = {batch.data() + slot.offset, slot.length};
             }
-            // the MI interface will only consume protocol/io errors
-            // The client will take the reponsibility to deal with nvme-mi
-            // status flag and nvme status field(cwd3). cmd specific return
-            // value (cdw0) is also client's job.
-
-            buf.resize(sizeof(nvme_mi_admin_resp_hdr) + respDataSize);
-            self->io.post([cb{std::move(cb)}, data{std::move(buf)}]() mutable {
-                std::span<uint8_t> span(
-                    data.begin() + sizeof(nvme_mi_admin_resp_hdr), data.end());
-                cb({}, *reinterpret_cast<nvme_mi_admin_resp_hdr*>(data.data()),
-                   span);
-            });
+            cb({}, std::span<const BatchResult>(results.data(), count));
         });
+    });
+}
+
+int NVMeMi::runBatchCommand(const BatchCommand& cmd, uint8_t* buf)
+{
+    if (effectiveBreakerState() != BreakerState::Closed)
+    {
+        // an earlier command of the batch found the drive or its bus down
+        return EHOSTUNREACH;
+    }
+
+    uint16_t key = adminKey(nvme_admin_get_log_page);
+    if (cmd.kind == BatchCommand::Kind::SubsystemHealthStatusPoll)
+    {
+        key = miKey(nvme_mi_mi_opcode_subsys_health_status_poll);
+    }
+    else if (cmd.kind == BatchCommand::Kind::Identify)
+    {
+        key = adminKey(nvme_admin_identify);
+    }
+    auto call = beginCall(key);
+
+    int rc = 0;
+    switch (cmd.kind)
+    {
+        case BatchCommand::Kind::SubsystemHealthStatusPoll:
+        {
+            nvme_mi_nvm_ss_health_status ss_health;
+            rc = nvme_mi_mi_subsystem_health_status_poll(nvmeEP, cmd.id != 0,
+                                                         &ss_health);
+            if (rc == 0)
+            {
+                // submitBatch() made room for it
+                std::memcpy(buf, &ss_health, sizeof(ss_health));
+            }
+        }
+        break;
+        case BatchCommand::Kind::GetLog:
+        {
+            nvme_get_log_args args{};
+            args.lpo = cmd.offset;
+            args.result = nullptr;
+            args.log = buf;
+            args.args_size = sizeof(args);
+            args.lid = static_cast<nvme_cmd_get_log_lid>(cmd.id);
+            args.len = cmd.length;
+            args.nsid = cmd.nsid;
+            args.csi = NVME_CSI_NVM;
+            args.lsi = cmd.specific;
+            args.lsp = cmd.lsp;
+            args.uuidx = NVME_UUID_NONE;
+            args.rae = false;
+            args.ot = false;
+            rc = nvme_mi_admin_get_log(cmd.ctrl, &args);
+        }
+        break;
+        case BatchCommand::Kind::Identify:
+        {
+            nvme_identify_args args{};
+            args.result = nullptr;
+            args.data = buf;
+            args.args_size = sizeof(args);
+            args.cns = static_cast<nvme_identify_cns>(cmd.id);
+            args.csi = NVME_CSI_NVM;
+            args.nsid = cmd.nsid;
+            args.cntid = cmd.specific;
+            args.cns_specific_id = NVME_CNSSPECID_NONE;
+            args.uuidx = NVME_UUID_NONE;
+            if (cmd.length < NVME_IDENTIFY_DATA_SIZE)
+            {
+                rc = nvme_mi_admin_identify_partial(cmd.ctrl, &args, 0,
+                                                    cmd.length);
+            }
+            else
+            {
+                rc = nvme_mi_admin_identify(cmd.ctrl, &args);
+            }
+        }
+        break;
+        default:
+        {
+            rc = -1;
+            errno = EINVAL;
+        }
+    }
+    endCall(call, rc, cmd.length);
+
+    if (rc < 0)
+    {
+        int err = errno;
+        lg2::error("[addr:{ADDR}, eid:{EID}] fail to run batch command "
+                   "{KIND}: {ERR}",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "KIND",
+                   static_cast<int>(cmd.kind), "ERR", std::strerror(err));
+        return err;
     }
-    catch (const std::runtime_error& e)
+    else if (rc > 0)
+    {
+        std::string_view errMsg =
+            statusToString(static_cast<nvme_mi_resp_status>(rc));
+        lg2::error("[addr:{ADDR}, eid:{EID}] fail to run batch command "
+                   "{KIND}: {MSG}",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "KIND",
+                   static_cast<int>(cmd.kind), "MSG", errMsg);
+        return EBADMSG;
+    }
+    return 0;
+}
+
+void NVMeMi::adminXfer(
+    nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& admin_req,
+    std::span<uint8_t> data, unsigned int timeout_ms,
+    UniqueFunction<void(const std::error_code&, const nvme_mi_admin_resp_hdr&,
+                        std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    if (!nvmeEP)
     {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
+        lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+        boost::asio::post(io, [cb{std::move(cb)}]() {
             cb(std::make_error_code(std::errc::no_such_device), {}, {});
         });
         return;
     }
+    std::vector<uint8_t> req(sizeof(nvme_mi_admin_req_hdr) + data.size());
+    memcpy(req.data(), &admin_req, sizeof(nvme_mi_admin_req_hdr));
+    memcpy(req.data() + sizeof(nvme_mi_admin_req_hdr), data.data(),
+           data.size());
+    post(Priority::Interactive, opts,
+         [ctrl, req{std::move(req)}, self{shared_from_this()}, timeout_ms,
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, {}, {}); });
+            return;
+        }
+
+        int rc = 0;
+
+        nvme_mi_admin_req_hdr* reqHeader =
+            reinterpret_cast<nvme_mi_admin_req_hdr*>(req.data());
+
+        size_t respDataSize =
+            boost::endian::little_to_native<size_t>(reqHeader->dlen);
+        off_t respDataOffset =
+            boost::endian::little_to_native<off_t>(reqHeader->doff);
+        size_t bufSize = sizeof(nvme_mi_admin_resp_hdr) + respDataSize;
+        BufferPool::Lease buf = self->worker->lease();
+        buf.resize(bufSize);
+        nvme_mi_admin_resp_hdr* respHeader =
+            reinterpret_cast<nvme_mi_admin_resp_hdr*>(buf.data());
+
+        // the caller's timeout overrides the learned one
+        auto call = self->beginCall(adminKey(reqHeader->opcode), timeout_ms);
+        rc = nvme_mi_admin_xfer(ctrl, reqHeader,
+                                req.size() - sizeof(nvme_mi_admin_req_hdr),
+                                respHeader, respDataOffset, &respDataSize);
+        self->endCall(call, rc, respDataSize);
+
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] failed to nvme_mi_admin_xfer",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   {}, {});
+            });
+            return;
+        }
+        // the MI interface will only consume protocol/io errors
+        // The client will take the reponsibility to deal with nvme-mi
+        // status flag and nvme status field(cwd3). cmd specific return
+        // value (cdw0) is also client's job.
+
+        buf.resize(sizeof(nvme_mi_admin_resp_hdr) + respDataSize);
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, data{std::move(buf)}]() mutable {
+            std::span<uint8_t> span(
+                data.data() + sizeof(nvme_mi_admin_resp_hdr),
+                data.size() - sizeof(nvme_mi_admin_resp_hdr));
+            cb({}, *reinterpret_cast<nvme_mi_admin_resp_hdr*>(data.data()),
+               span);
+        });
+    });
 }
 
 void NVMeMi::adminFwCommit(
     nvme_mi_ctrl_t ctrl, nvme_fw_commit_ca action, uint8_t slot, bool bpid,
-    std::function<void(const std::error_code&, nvme_status_field)>&& cb)
+    UniqueFunction<void(const std::error_code&, nvme_status_field)>&& cb,
+    const CommandOptions& opts)
 {
     if (!nvmeEP)
     {
         lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid", "ADDR",
                    addr, "EID", static_cast<int>(eid));
-        io.post([cb{std::move(cb)}]() {
+        boost::asio::post(io, [cb{std::move(cb)}]() {
             cb(std::make_error_code(std::errc::no_such_device),
                nvme_status_field::NVME_SC_MASK);
         });
         return;
     }
-    try
-    {
-        nvme_fw_commit_args args;
-        memset(&args, 0, sizeof(args));
-        args.args_size = sizeof(args);
-        args.action = action;
-        args.slot = slot;
-        args.bpid = bpid;
-        io.post([ctrl, args, cb{std::move(cb)},
-                 self{shared_from_this()}]() mutable {
-            int rc = nvme_mi_admin_fw_commit(ctrl, &args);
-            if (rc < 0)
-            {
-                lg2::error(
-                    "[addr:{ADDR}, eid:{EID}] fail to nvme_mi_admin_fw_commit: {ERR}",
-                    "ADDR", self->addr, "EID", static_cast<int>(self->eid),
-                    "ERR", std::strerror(errno));
-                self->io.post([cb{std::move(cb)}, last_errno{errno}]() {
-                    cb(std::make_error_code(static_cast<std::errc>(last_errno)),
-                       nvme_status_field::NVME_SC_MASK);
-                });
-                return;
-            }
-            else if (rc >= 0)
+    nvme_fw_commit_args args;
+    memset(&args, 0, sizeof(args));
+    args.args_size = sizeof(args);
+    args.action = action;
+    args.slot = slot;
+    args.bpid = bpid;
+    post(Priority::Interactive, opts,
+         [ctrl, args, cb{std::move(cb)},
+          self{shared_from_this()}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io, [cb{std::move(cb)}, ec]() {
+                cb(ec, nvme_status_field::NVME_SC_MASK);
+            });
+            return;
+        }
+
+        auto call = self->beginCall(adminKey(nvme_admin_fw_commit));
+        int rc = nvme_mi_admin_fw_commit(ctrl, &args);
+        self->endCall(call, rc);
+        if (rc < 0)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] fail to nvme_mi_admin_fw_commit: {ERR}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid),
+                "ERR", std::strerror(errno));
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, last_errno{errno}]() {
+                cb(std::make_error_code(static_cast<std::errc>(last_errno)),
+                   nvme_status_field::NVME_SC_MASK);
+            });
+            return;
+        }
+        else if (rc >= 0)
+        {
+            switch (rc & 0x7ff)
             {
-                switch (rc & 0x7ff)
-                {
-                    case NVME_SC_SUCCESS:
-                    case NVME_SC_FW_NEEDS_CONV_RESET:
-                    case NVME_SC_FW_NEEDS_SUBSYS_RESET:
-                    case NVME_SC_FW_NEEDS_RESET:
-                        self->io.post([rc, cb{std::move(cb)}]() {
-                            cb({}, static_cast<nvme_status_field>(rc));
-                        });
-                        break;
-                    default:
-                        std::string_view errMsg = statusToString(
-                            static_cast<nvme_mi_resp_status>(rc));
-                        lg2::error("fail to nvme_mi_admin_fw_commit: {MSG} ",
-                                   "MSG", errMsg);
-                        self->io.post([rc, cb{std::move(cb)}]() {
-                            cb(std::make_error_code(std::errc::bad_message),
-                               static_cast<nvme_status_field>(rc));
-                        });
-                }
-                return;
+                case NVME_SC_SUCCESS:
+                case NVME_SC_FW_NEEDS_CONV_RESET:
+                case NVME_SC_FW_NEEDS_SUBSYS_RESET:
+                case NVME_SC_FW_NEEDS_RESET:
+                    boost::asio::post(self->io, [rc, cb{std::move(cb)}]() {
+                        cb({}, static_cast<nvme_status_field>(rc));
+                    });
+                    break;
+                default:
+                    std::string_view errMsg = statusToString(
+                        static_cast<nvme_mi_resp_status>(rc));
+                    lg2::error("fail to nvme_mi_admin_fw_commit: {MSG} ",
+                               "MSG", errMsg);
+                    boost::asio::post(self->io, [rc, cb{std::move(cb)}]() {
+                        cb(std::make_error_code(std::errc::bad_message),
+                           static_cast<nvme_status_field>(rc));
+                    });
             }
-        });
-    }
-    catch (const std::runtime_error& e)
-    {
-        lg2::error("[addr:{ADDR}, eid:{EID}] {MSG}", "ADDR", addr, "EID",
-                   static_cast<int>(eid), "MSG", e.what());
-        io.post([cb{std::move(cb)}]() {
-            cb(std::make_error_code(std::errc::no_such_device),
-               nvme_status_field::NVME_SC_MASK);
-        });
-        return;
-    }
+            return;
+        }
+    });
 }
 
 void NVMeMi::adminSecuritySend(
     nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
     std::span<uint8_t> data,
-    std::function<void(const std::error_code&, int nvme_status)>&& cb)
+    UniqueFunction<void(const std::error_code&, int nvme_status)>&& cb,
+    const CommandOptions& opts)
 {
-    std::error_code post_err =
-        try_post([self{shared_from_this()}, ctrl, proto, proto_specific, data,
-                  cb{std::move(cb)}]() {
+    post(Priority::Interactive, opts,
+         [self{shared_from_this()}, ctrl, proto, proto_specific, data,
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, -1); });
+            return;
+        }
+
         struct nvme_security_send_args args;
         memset(&args, 0x0, sizeof(args));
         args.secp = proto;
@@ -1100,38 +1970,45 @@ void NVMeMi::adminSecuritySend(
         args.data_len = data.size_bytes();
         args.args_size = sizeof(struct nvme_security_send_args);
 
+        auto call = self->beginCall(adminKey(nvme_admin_security_send));
         int status = nvme_mi_admin_security_send(ctrl, &args);
-        self->io.post([cb{std::move(cb)}, nvme_errno{errno}, status]() {
+        self->endCall(call, status, data.size());
+        boost::asio::post(self->io,
+                          [cb{std::move(cb)}, nvme_errno{errno}, status]() {
             auto err = std::make_error_code(static_cast<std::errc>(nvme_errno));
             cb(err, status);
         });
     });
-    if (post_err)
-    {
-        lg2::error(
-            "[addr:{ADDR}, eid:{EID}] adminSecuritySend post failed: {MSG}",
-            "ADDR", addr, "EID", static_cast<int>(eid), "MSG",
-            post_err.message());
-        io.post([cb{std::move(cb)}, post_err]() { cb(post_err, -1); });
-    }
 }
 
 void NVMeMi::adminSecurityReceive(
     nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
     uint32_t transfer_length,
-    std::function<void(const std::error_code&, int nvme_status,
-                       std::span<uint8_t> data)>&& cb)
+    UniqueFunction<void(const std::error_code&, int nvme_status,
+                        std::span<uint8_t> data)>&& cb,
+    const CommandOptions& opts)
 {
     if (transfer_length > maxNVMeMILength)
     {
-        cb(std::make_error_code(std::errc::invalid_argument), -1, {});
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::invalid_argument), -1, {});
+        });
         return;
     }
 
-    std::error_code post_err =
-        try_post([self{shared_from_this()}, ctrl, proto, proto_specific,
-                  transfer_length, cb{std::move(cb)}]() {
-        std::vector<uint8_t> data(transfer_length);
+    post(Priority::Interactive, opts,
+         [self{shared_from_this()}, ctrl, proto, proto_specific,
+          transfer_length,
+          cb{std::move(cb)}](const std::error_code& ec) mutable {
+        if (ec)
+        {
+            boost::asio::post(self->io,
+                              [cb{std::move(cb)}, ec]() { cb(ec, -1, {}); });
+            return;
+        }
+
+        BufferPool::Lease data = self->worker->lease();
+        data.resize(transfer_length);
 
         struct nvme_security_receive_args args;
         memset(&args, 0x0, sizeof(args));
@@ -1143,33 +2020,27 @@ void NVMeMi::adminSecurityReceive(
         args.data_len = data.size();
         args.args_size = sizeof(struct nvme_security_receive_args);
 
+        auto call = self->beginCall(adminKey(nvme_admin_security_recv));
         int status = nvme_mi_admin_security_recv(ctrl, &args);
+        self->endCall(call, status, data.size());
         if (args.data_len > maxNVMeMILength)
         {
             lg2::error(
                 "[addr:{ADDR}, eid:{EID}] nvme_mi_admin_security_send returned excess data, {LEN}",
                 "ADDR", self->addr, "EID", static_cast<int>(self->eid), "LEN",
                 args.data_len);
-            self->io.post([cb]() {
+            boost::asio::post(self->io, [cb{std::move(cb)}]() {
                 cb(std::make_error_code(std::errc::protocol_error), -1, {});
             });
             return;
         }
 
         data.resize(args.data_len);
-        self->io.post(
-            [cb{std::move(cb)}, nvme_errno{errno}, status, data]() mutable {
+        boost::asio::post(self->io, [cb{std::move(cb)}, nvme_errno{errno},
+                                     status, data{std::move(data)}]() mutable {
             std::span<uint8_t> span{data.data(), data.size()};
             auto err = std::make_error_code(static_cast<std::errc>(nvme_errno));
             cb(err, status, span);
         });
     });
-    if (post_err)
-    {
-        lg2::error(
-            "[addr:{ADDR}, eid:{EID}] adminSecuritySend post failed: {MSG}",
-            "ADDR", addr, "EID", static_cast<int>(eid), "MSG",
-            post_err.message());
-        io.post([cb{std::move(cb)}, post_err]() { cb(post_err, -1, {}); });
-    }
 }
@@ -0,0 +1,92 @@
+#include "NVMeMiMessage.hpp"
+
+#include <boost/endian.hpp>
+
+#include <array>
+#include <cstring>
+
+namespace mi
+{
+
+namespace
+{
+
+constexpr std::array<uint32_t, 256> crcTable = []() {
+    // reflected Castagnoli polynomial
+    constexpr uint32_t poly = 0x82f63b78;
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < table.size(); i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+constexpr uint8_t rorResponse = 1 << 7;
+
+uint8_t nmp(nvme_mi_message_type nmimt, uint8_t slot)
+{
+    return static_cast<uint8_t>((nmimt & 0xf) << 3) | (slot & 1);
+}
+
+} // namespace
+
+uint32_t crc32c(std::span<const uint8_t> data)
+{
+    uint32_t crc = 0xffffffff;
+    for (uint8_t byte : data)
+    {
+        crc = crcTable[(crc ^ byte) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void setRequestHeader(nvme_mi_msg_hdr& hdr, nvme_mi_message_type nmimt,
+                      uint8_t slot)
+{
+    hdr.type = messageType;
+    hdr.nmp = nmp(nmimt, slot);
+    hdr.meb = 0;
+    hdr.rsvd0 = 0;
+}
+
+void seal(std::span<uint8_t> msg)
+{
+    uint32_t mic = boost::endian::native_to_little(
+        crc32c(msg.first(msg.size() - micSize)));
+    std::memcpy(msg.data() + msg.size() - micSize, &mic, micSize);
+}
+
+bool isResponse(std::span<const uint8_t> msg, nvme_mi_message_type nmimt,
+                uint8_t slot)
+{
+    if (msg.size() < sizeof(nvme_mi_msg_hdr) + micSize)
+    {
+        return false;
+    }
+    uint32_t mic = 0;
+    std::memcpy(&mic, msg.data() + msg.size() - micSize, micSize);
+    if (boost::endian::little_to_native(mic) !=
+        crc32c(msg.first(msg.size() - micSize)))
+    {
+        return false;
+    }
+    return msg[0] == messageType && msg[1] == (rorResponse | nmp(nmimt, slot));
+}
+
+int adminStatus(const nvme_mi_admin_resp_hdr& resp)
+{
+    if (resp.status != 0)
+    {
+        return resp.status | (NVME_STATUS_TYPE_MI << NVME_STATUS_TYPE_SHIFT);
+    }
+    // the status field is in bits 31:17 of the completion dword 3
+    return (boost::endian::little_to_native(resp.cdw3) >> 17) & 0x7fff;
+}
+
+} // namespace mi
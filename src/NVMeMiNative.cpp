@@ -0,0 +1,1302 @@
+#include "NVMeMiNative.hpp"
+
+#include <nvme-mi_config.h>
+
+#include <boost/endian.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+std::map<std::vector<uint8_t>, std::weak_ptr<NVMeMiNative::Link>>
+    NVMeMiNative::linkMap{};
+
+namespace
+{
+
+using boost::endian::little_to_native;
+using boost::endian::native_to_little;
+
+// the data structure types of the Read NVMe-MI Data Structure command
+constexpr uint8_t dtypSubsystem = 0x00;
+constexpr uint8_t dtypPort = 0x01;
+constexpr uint8_t dtypCtrlList = 0x02;
+
+constexpr uint8_t portTypePCIe = 0x1;
+
+// Only a missing response counts against the endpoint, any other outcome
+// shows that it is alive.
+bool transportError(const std::error_code& ec)
+{
+    return ec == std::errc::timed_out || ec == std::errc::io_error ||
+           ec == std::errc::host_unreachable ||
+           ec == std::errc::network_unreachable ||
+           ec == std::errc::no_such_device_or_address;
+}
+
+uint32_t readDataCdw0(uint8_t dtyp, uint8_t portId, uint16_t ctrlId)
+{
+    return static_cast<uint32_t>(dtyp) << 24 |
+           static_cast<uint32_t>(portId) << 16 | ctrlId;
+}
+
+} // namespace
+
+NVMeMiNative::Link::Link(boost::asio::io_context& io,
+                         const std::vector<uint8_t>& sockName) :
+    socket(io),
+    bufferPool(std::make_shared<BufferPool>(bufferPoolIdle)),
+    rxBuf(std::make_shared<RxBuffer>())
+{
+    // the name is an abstract socket name terminated for libnvme-mi
+    sockaddr_un sa{};
+    sa.sun_family = AF_UNIX;
+    size_t len = sockName.size();
+    if (len > 0 && sockName.back() == 0)
+    {
+        len--;
+    }
+    len = std::min(len, sizeof(sa.sun_path));
+    std::memcpy(sa.sun_path, sockName.data(), len);
+    boost::asio::generic::seq_packet_protocol::endpoint ep(
+        &sa, offsetof(sockaddr_un, sun_path) + len);
+
+    boost::system::error_code ec;
+    socket.open(ep.protocol(), ec);
+    if (!ec)
+    {
+        socket.connect(ep, ec);
+    }
+    if (!ec)
+    {
+        // subscribe to the NVMe-MI messages
+        uint8_t type = NVME_MI_MSGTYPE_NVME;
+        socket.send(boost::asio::buffer(&type, sizeof(type)), 0, ec);
+    }
+    if (ec)
+    {
+        lg2::error("can't connect to the MCTP demux daemon: {ERR}", "ERR",
+                   ec.message());
+        boost::system::error_code ignored;
+        socket.close(ignored);
+    }
+}
+
+void NVMeMiNative::Link::attach(uint8_t eid, NVMeMiNative* ep)
+{
+    endpoints[eid] = ep;
+    if (!receiving && connected())
+    {
+        receive();
+    }
+}
+
+void NVMeMiNative::Link::detach(uint8_t eid)
+{
+    endpoints.erase(eid);
+}
+
+void NVMeMiNative::Link::receive()
+{
+    receiving = true;
+    socket.async_receive(boost::asio::buffer(rxBuf->data), rxBuf->flags,
+                         [weak{weak_from_this()},
+                          buf{rxBuf}](const boost::system::error_code& ec,
+                                      size_t size) {
+        auto self = weak.lock();
+        if (!self)
+        {
+            return;
+        }
+        if (ec)
+        {
+            self->receiving = false;
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                // the commands in flight time out, the later ones fail
+                // with no_such_device
+                lg2::error("MCTP demux socket failed: {ERR}", "ERR",
+                           ec.message());
+                boost::system::error_code ignored;
+                self->socket.close(ignored);
+            }
+            return;
+        }
+
+        if (size > 1)
+        {
+            auto it = self->endpoints.find(buf->data[0]);
+            if (it != self->endpoints.end())
+            {
+                it->second->onMessage({buf->data.data() + 1, size - 1},
+                                      (buf->flags & MSG_TRUNC) != 0);
+            }
+        }
+        self->receive();
+    });
+}
+
+NVMeMiNative::NVMeMiNative(boost::asio::io_context& io,
+                           std::shared_ptr<sdbusplus::asio::connection> conn,
+                           sdbusplus::asio::object_server& /*objServer*/,
+                           int /*bus*/, std::vector<uint8_t> sockName,
+                           uint8_t eid) :
+    io(io),
+    conn(conn), eid(eid), timer(io)
+{
+    addr.assign(sockName.begin() + 1, sockName.end());
+
+    // share one connection among the endpoints behind the same socket
+    auto res = linkMap.find(sockName);
+    if (res != linkMap.end())
+    {
+        link = res->second.lock();
+    }
+    if (!link)
+    {
+        link = std::make_shared<Link>(io, sockName);
+        linkMap[sockName] = link;
+    }
+    link->attach(eid, this);
+
+    if (!link->connected())
+    {
+        lg2::error("[addr:{ADDR}] can't open MCTP endpoint {EID}", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+    }
+}
+
+NVMeMiNative::~NVMeMiNative()
+{
+    link->detach(eid);
+}
+
+NVMeMiNative::Request NVMeMiNative::miRequest(uint8_t opcode, uint32_t cdw0,
+                                              uint32_t cdw1)
+{
+    nvme_mi_mi_req_hdr hdr{};
+    hdr.opcode = opcode;
+    hdr.cdw0 = native_to_little(cdw0);
+    hdr.cdw1 = native_to_little(cdw1);
+
+    Request req{};
+    req.nmimt = NVME_MI_MT_MI;
+    req.key = miKey(opcode);
+    req.msg = link->lease();
+    req.msg.resize(1 + sizeof(hdr) + mi::micSize);
+    std::memcpy(req.msg.data() + 1, &hdr, sizeof(hdr));
+    return req;
+}
+
+NVMeMiNative::Request
+    NVMeMiNative::adminRequest(nvme_mi_ctrl_t ctrl,
+                               const nvme_mi_admin_req_hdr& hdr,
+                               std::span<const uint8_t> data)
+{
+    nvme_mi_admin_req_hdr req_hdr = hdr;
+    req_hdr.ctrl_id = native_to_little(ctrlId(ctrl));
+
+    Request req{};
+    req.nmimt = NVME_MI_MT_ADMIN;
+    req.key = adminKey(hdr.opcode);
+    req.msg = link->lease();
+    req.msg.resize(1 + sizeof(req_hdr) + data.size() + mi::micSize);
+    std::memcpy(req.msg.data() + 1, &req_hdr, sizeof(req_hdr));
+    if (!data.empty())
+    {
+        std::memcpy(req.msg.data() + 1 + sizeof(req_hdr), data.data(),
+                    data.size());
+    }
+    return req;
+}
+
+NVMeMiNative::Request
+    NVMeMiNative::getLogRequest(nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid,
+                                uint32_t nsid, uint8_t lsp, uint16_t lsi,
+                                uint64_t offset, uint32_t length)
+{
+    // the number of dwords, zero based
+    uint32_t numd = (length + 3) / 4 - 1;
+
+    nvme_mi_admin_req_hdr hdr{};
+    hdr.opcode = nvme_admin_get_log_page;
+    hdr.flags = mi::adminLengthValid;
+    hdr.cdw1 = native_to_little(nsid);
+    hdr.dlen = native_to_little(length);
+    hdr.cdw10 = native_to_little(static_cast<uint32_t>(lid) |
+                                 static_cast<uint32_t>(lsp & 0x7f) << 8 |
+                                 (numd & 0xffff) << 16);
+    hdr.cdw11 = native_to_little(numd >> 16 | static_cast<uint32_t>(lsi) << 16);
+    hdr.cdw12 = native_to_little(static_cast<uint32_t>(offset));
+    hdr.cdw13 = native_to_little(static_cast<uint32_t>(offset >> 32));
+    hdr.cdw14 = native_to_little(static_cast<uint32_t>(NVME_CSI_NVM) << 24);
+    return adminRequest(ctrl, hdr);
+}
+
+NVMeMiNative::Request NVMeMiNative::identifyRequest(nvme_mi_ctrl_t ctrl,
+                                                    uint8_t cns, uint32_t nsid,
+                                                    uint16_t cntid,
+                                                    uint32_t length)
+{
+    nvme_mi_admin_req_hdr hdr{};
+    hdr.opcode = nvme_admin_identify;
+    hdr.flags = mi::adminLengthValid;
+    hdr.cdw1 = native_to_little(nsid);
+    hdr.dlen = native_to_little(length);
+    hdr.cdw10 = native_to_little(static_cast<uint32_t>(cns) |
+                                 static_cast<uint32_t>(cntid) << 16);
+    hdr.cdw11 = native_to_little(static_cast<uint32_t>(NVME_CSI_NVM) << 24);
+    return adminRequest(ctrl, hdr);
+}
+
+void NVMeMiNative::submit(Priority prio, const CommandOptions& opts,
+                          Request&& req)
+{
+    if (!link->connected())
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] nvme endpoint is invalid", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+        boost::asio::post(io, [handler{std::move(req.handler)}]() {
+            handler(std::make_error_code(std::errc::no_such_device), {});
+        });
+        return;
+    }
+
+    req.deadline = opts.deadline.value_or(
+        std::chrono::steady_clock::time_point::max());
+    req.cancel = opts.cancel;
+
+    // reuse the list node of a completed command
+    auto& queue = pending[static_cast<size_t>(opts.priority.value_or(prio))];
+    if (spare.empty())
+    {
+        queue.push_back(std::move(req));
+    }
+    else
+    {
+        spare.front() = std::move(req);
+        queue.splice(queue.end(), spare, spare.begin());
+    }
+
+    // a command in flight dispatches the next one on completion
+    if (inflight.empty() && !dispatchPosted)
+    {
+        dispatchPosted = true;
+        boost::asio::post(io,
+                          [self{shared_from_this()}]() { self->dispatch(); });
+    }
+}
+
+void NVMeMiNative::dispatch()
+{
+    auto self = shared_from_this();
+    dispatchPosted = false;
+    while (inflight.empty())
+    {
+        auto queue = std::find_if(pending.begin(), pending.end(),
+                                  [](const auto& q) { return !q.empty(); });
+        if (queue == pending.end())
+        {
+            return;
+        }
+
+        const Request& req = queue->front();
+        auto now = std::chrono::steady_clock::now();
+        if ((req.cancel && req.cancel->isCancelled()) || now > req.deadline)
+        {
+            drop(*queue, std::errc::operation_canceled);
+            continue;
+        }
+
+        switch (breaker.admit(now))
+        {
+            case CircuitBreaker::Admission::Pass:
+                inflight.splice(inflight.end(), *queue, queue->begin());
+                break;
+            case CircuitBreaker::Admission::Reject:
+                drop(*queue, std::errc::host_unreachable);
+                continue;
+            case CircuitBreaker::Admission::Probe:
+                // The health status poll is the cheapest command of the
+                // endpoint. The status change flags are left for the next
+                // real poll. The queued command goes out once the probe
+                // closed the breaker.
+                publishBreaker();
+                inflight.push_back(miRequest(
+                    nvme_mi_mi_opcode_subsys_health_status_poll, 0, 0));
+                inflight.back().handler =
+                    [](const std::error_code&, std::span<uint8_t>) {};
+                break;
+        }
+        send();
+    }
+}
+
+void NVMeMiNative::drop(std::list<Request>& queue, std::errc err)
+{
+    spare.splice(spare.end(), queue, queue.begin());
+    Request& req = spare.back();
+    Handler handler = std::move(req.handler);
+    req.msg = {};
+    req.cancel.reset();
+    handler(std::make_error_code(err), {});
+}
+
+void NVMeMiNative::send()
+{
+    Request& req = inflight.front();
+    req.msg.data()[0] = eid;
+    nvme_mi_msg_hdr hdr;
+    mi::setRequestHeader(hdr, req.nmimt, slot);
+    std::memcpy(req.msg.data() + 1, &hdr, sizeof(hdr));
+    mi::seal({req.msg.data() + 1, req.msg.size() - 1});
+
+    sentTimeout = std::chrono::milliseconds(req.timeoutMs);
+    if (req.timeoutMs == 0)
+    {
+        sentTimeout = latency[req.key].timeout(
+            defaultTimeout, std::chrono::milliseconds(mctpTimeoutFloor),
+            std::chrono::milliseconds(mctpTimeoutCeiling));
+    }
+    sentAt = std::chrono::steady_clock::now();
+    uint32_t seq = ++sequence;
+
+    // the message is no longer needed once sent
+    auto buf = boost::asio::buffer(req.msg.data(), req.msg.size());
+    link->socket.async_send(buf, 0,
+                            [weak{weak_from_this()}, seq,
+                             msg{std::move(req.msg)}](
+                                const boost::system::error_code& ec, size_t) {
+        auto self = weak.lock();
+        if (!ec || !self || seq != self->sequence)
+        {
+            return;
+        }
+        self->finish(ec, {});
+    });
+
+    timer.expires_after(sentTimeout);
+    timer.async_wait([weak{weak_from_this()},
+                      seq](const boost::system::error_code& ec) {
+        auto self = weak.lock();
+        if (ec || !self || seq != self->sequence)
+        {
+            return;
+        }
+        // the endpoint may still respond in this slot, so that response
+        // can't be taken for the one of the next command
+        self->slot ^= 1;
+        self->finish(std::make_error_code(std::errc::timed_out), {});
+    });
+}
+
+void NVMeMiNative::onMessage(std::span<uint8_t> msg, bool truncated)
+{
+    if (truncated && !inflight.empty())
+    {
+        // the response to the command in flight, the only one expected
+        lg2::error("[addr:{ADDR}, eid:{EID}] response exceeds {MAX} bytes of "
+                   "data, fragmentation is not supported",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "MAX",
+                   mi::maxTransfer);
+        finish(std::make_error_code(std::errc::message_size), {});
+        return;
+    }
+    if (inflight.empty() ||
+        !mi::isResponse(msg, inflight.front().nmimt, slot))
+    {
+        lg2::debug("[addr:{ADDR}, eid:{EID}] drop unexpected message", "ADDR",
+                   addr, "EID", static_cast<int>(eid));
+        return;
+    }
+    finish({}, msg.first(msg.size() - mi::micSize));
+}
+
+void NVMeMiNative::finish(const std::error_code& ec, std::span<uint8_t> msg)
+{
+    auto self = shared_from_this();
+    // stale send and timeout completions ignore the sequence
+    sequence++;
+    timer.cancel();
+
+    auto now = std::chrono::steady_clock::now();
+    Request& req = inflight.front();
+    if (!ec)
+    {
+        auto elapsed =
+            std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                                  sentAt);
+        latency[req.key].record(elapsed);
+    }
+    else if (ec == std::errc::timed_out)
+    {
+        // see NVMeMi::endCall()
+        latency[req.key].record(sentTimeout);
+    }
+    if (transportError(ec))
+    {
+        breaker.failure(now);
+    }
+    else
+    {
+        breaker.success();
+    }
+    publishBreaker();
+
+    Handler handler = std::move(req.handler);
+    req.cancel.reset();
+    spare.splice(spare.end(), inflight, inflight.begin());
+    handler(ec, msg);
+
+    // the handler may have queued the next part of its transfer
+    dispatch();
+}
+
+void NVMeMiNative::publishBreaker()
+{
+    BreakerState state = breaker.state();
+    if (state == breakerState)
+    {
+        return;
+    }
+    breakerState = state;
+
+    static constexpr std::array<const char*, 3> stateName{"closed", "open",
+                                                          "half-open"};
+    lg2::warning("[addr:{ADDR}, eid:{EID}] circuit breaker is {STATE}", "ADDR",
+                 addr, "EID", static_cast<int>(eid), "STATE",
+                 stateName[static_cast<size_t>(state)]);
+    if (breakerObserver)
+    {
+        breakerObserver(state);
+    }
+}
+
+void NVMeMiNative::watchBreaker(UniqueFunction<void(BreakerState)>&& cb)
+{
+    breakerObserver = std::move(cb);
+}
+
+int NVMeMiNative::miStatus(std::span<uint8_t> msg, std::span<uint8_t>& data)
+{
+    if (msg.size() < sizeof(nvme_mi_mi_resp_hdr))
+    {
+        return -1;
+    }
+    data = msg.subspan(sizeof(nvme_mi_mi_resp_hdr));
+    return reinterpret_cast<const nvme_mi_mi_resp_hdr*>(msg.data())->status;
+}
+
+int NVMeMiNative::adminStatus(std::span<uint8_t> msg, std::span<uint8_t>& data)
+{
+    nvme_mi_admin_resp_hdr hdr;
+    if (msg.size() < sizeof(hdr))
+    {
+        return -1;
+    }
+    std::memcpy(&hdr, msg.data(), sizeof(hdr));
+    data = msg.subspan(sizeof(hdr));
+    return mi::adminStatus(hdr);
+}
+
+std::error_code NVMeMiNative::check(const std::error_code& ec, int status,
+                                    const char* what)
+{
+    if (ec)
+    {
+        // the commands dropped by the queue are not errors of the endpoint
+        if (ec != std::errc::operation_canceled &&
+            ec != std::errc::host_unreachable)
+        {
+            lg2::error("[addr:{ADDR}, eid:{EID}] {WHAT}: {ERR}", "ADDR", addr,
+                       "EID", static_cast<int>(eid), "WHAT", what, "ERR",
+                       ec.message());
+        }
+        return ec;
+    }
+    if (status < 0)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] {WHAT}: malformed response",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "WHAT", what);
+        return std::make_error_code(std::errc::protocol_error);
+    }
+    if (status > 0)
+    {
+        std::string_view errMsg =
+            statusToString(static_cast<nvme_mi_resp_status>(status));
+        lg2::error("[addr:{ADDR}, eid:{EID}] {WHAT}: {MSG} rc: {RC}", "ADDR",
+                   addr, "EID", static_cast<int>(eid), "WHAT", what, "MSG",
+                   errMsg, "RC", status);
+        return std::make_error_code(std::errc::bad_message);
+    }
+    return {};
+}
+
+void NVMeMiNative::miPCIePortInformation(
+    UniqueFunction<void(const std::error_code&, nvme_mi_read_port_info*)>&& cb,
+    const CommandOptions& opts)
+{
+    Request req = miRequest(nvme_mi_mi_opcode_mi_data_read,
+                            readDataCdw0(dtypSubsystem, 0, 0), 0);
+    req.handler = [self{shared_from_this()}, cb{std::move(cb)},
+                   opts](const std::error_code& ec,
+                         std::span<uint8_t> msg) mutable {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : miStatus(msg, data);
+        if (status == 0 && data.size() < sizeof(nvme_mi_read_nvm_ss_info))
+        {
+            status = -1;
+        }
+        if (auto err = self->check(ec, status, "mi_read_mi_data_subsys"))
+        {
+            cb(err, nullptr);
+            return;
+        }
+
+        nvme_mi_read_nvm_ss_info ss_info;
+        std::memcpy(&ss_info, data.data(), sizeof(ss_info));
+        self->readPort(0, ss_info.nump, std::move(cb), opts);
+    };
+    submit(Priority::Lifecycle, opts, std::move(req));
+}
+
+void NVMeMiNative::readPort(
+    uint8_t port, uint8_t nump,
+    UniqueFunction<void(const std::error_code&, nvme_mi_read_port_info*)>&& cb,
+    const CommandOptions& opts)
+{
+    Request req = miRequest(nvme_mi_mi_opcode_mi_data_read,
+                            readDataCdw0(dtypPort, port, 0), 0);
+    req.handler = [self{shared_from_this()}, port, nump, cb{std::move(cb)},
+                   opts](const std::error_code& ec,
+                         std::span<uint8_t> msg) mutable {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : miStatus(msg, data);
+        if (status == 0 && data.size() < sizeof(nvme_mi_read_port_info))
+        {
+            status = -1;
+        }
+        if (auto err = self->check(ec, status, "mi_read_mi_data_port"))
+        {
+            cb(err, nullptr);
+            return;
+        }
+
+        nvme_mi_read_port_info info;
+        std::memcpy(&info, data.data(), sizeof(info));
+        // only select PCIe port
+        if (info.portt == portTypePCIe || port >= nump)
+        {
+            cb({}, &info);
+            return;
+        }
+        self->readPort(port + 1, nump, std::move(cb), opts);
+    };
+    submit(Priority::Lifecycle, opts, std::move(req));
+}
+
+void NVMeMiNative::miSubsystemHealthStatusPoll(
+    UniqueFunction<void(const std::error_code&,
+                        nvme_mi_nvm_ss_health_status*)>&& cb,
+    const CommandOptions& opts)
+{
+    // clear the status change flags after reading them
+    Request req = miRequest(nvme_mi_mi_opcode_subsys_health_status_poll, 0,
+                            1u << 31);
+    req.handler = [self{shared_from_this()},
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : miStatus(msg, data);
+        if (status == 0 && data.size() < sizeof(nvme_mi_nvm_ss_health_status))
+        {
+            status = -1;
+        }
+        if (auto err = self->check(ec, status, "subsystem_health_status_poll"))
+        {
+            cb(err, nullptr);
+            return;
+        }
+
+        nvme_mi_nvm_ss_health_status ss_health;
+        std::memcpy(&ss_health, data.data(), sizeof(ss_health));
+        cb({}, &ss_health);
+    };
+    submit(Priority::Background, opts, std::move(req));
+}
+
+void NVMeMiNative::miScanCtrl(
+    UniqueFunction<void(const std::error_code&,
+                        const std::vector<nvme_mi_ctrl_t>&)>
+        cb,
+    const CommandOptions& opts)
+{
+    Request req = miRequest(nvme_mi_mi_opcode_mi_data_read,
+                            readDataCdw0(dtypCtrlList, 0, 0), 0);
+    req.handler = [self{shared_from_this()},
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : miStatus(msg, data);
+        // the number of identifiers, then the identifiers
+        size_t num = 0;
+        if (status == 0)
+        {
+            if (data.size() >= sizeof(uint16_t))
+            {
+                num = data[0] | data[1] << 8;
+            }
+            if (data.size() < sizeof(uint16_t) * (num + 1))
+            {
+                status = -1;
+            }
+        }
+        if (auto err = self->check(ec, status, "fail to scan controllers"))
+        {
+            cb(err, {});
+            return;
+        }
+
+        // The handles of an earlier scan stay valid
+        std::vector<nvme_mi_ctrl_t> list;
+        for (size_t i = 1; i <= num; i++)
+        {
+            uint16_t id = data[2 * i] | data[2 * i + 1] << 8;
+            auto it = std::find_if(self->ctrls.begin(), self->ctrls.end(),
+                                   [id](const Controller& c) {
+                return c.id == id;
+            });
+            if (it == self->ctrls.end())
+            {
+                it = self->ctrls.insert(self->ctrls.end(), Controller{id});
+            }
+            list.push_back(reinterpret_cast<nvme_mi_ctrl_t>(&*it));
+        }
+        cb({}, list);
+    };
+    submit(Priority::Lifecycle, opts, std::move(req));
+}
+
+void NVMeMiNative::adminIdentify(
+    nvme_mi_ctrl_t ctrl, nvme_identify_cns cns, uint32_t nsid, uint16_t cntid,
+    uint16_t read_length,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    uint32_t length = NVME_IDENTIFY_DATA_SIZE;
+    if (read_length > 0 && read_length < NVME_IDENTIFY_DATA_SIZE &&
+        cns != NVME_IDENTIFY_CNS_SECONDARY_CTRL_LIST)
+    {
+        length = read_length;
+    }
+
+    Request req = identifyRequest(ctrl, cns, nsid, cntid, length);
+    req.handler = [self{shared_from_this()}, length,
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : adminStatus(msg, data);
+        if (status == 0 && data.size() < length)
+        {
+            status = -1;
+        }
+        if (auto err = self->check(ec, status, "fail to do nvme identify"))
+        {
+            cb(err, {});
+            return;
+        }
+        cb({}, data.first(length));
+    };
+    submit(Priority::Lifecycle, opts, std::move(req));
+}
+
+void NVMeMiNative::adminGetLog(
+    nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint32_t nsid, uint8_t lsp,
+    uint16_t lsi, uint32_t offset, uint32_t length,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    auto read = takeLogRead();
+    read->ctrl = ctrl;
+    read->lid = lid;
+    read->nsid = nsid;
+    read->lsp = lsp;
+    read->lsi = lsi;
+    read->offset = offset;
+    read->length = length;
+    read->prio = Priority::Background;
+    read->opts = opts;
+    read->data.resize(length);
+    read->cb = std::move(cb);
+    readLog(std::move(read));
+}
+
+std::unique_ptr<NVMeMiNative::LogRead> NVMeMiNative::takeLogRead()
+{
+    std::unique_ptr<LogRead> read;
+    if (spareReads.empty())
+    {
+        read = std::make_unique<LogRead>();
+    }
+    else
+    {
+        read = std::move(spareReads.back());
+        spareReads.pop_back();
+    }
+    read->done = 0;
+    read->data = link->lease();
+    return read;
+}
+
+void NVMeMiNative::readLog(std::unique_ptr<LogRead> read)
+{
+    uint32_t chunk = std::min<uint32_t>(read->length - read->done,
+                                        mi::maxTransfer);
+    Request req = getLogRequest(read->ctrl, read->lid, read->nsid, read->lsp,
+                                read->lsi, read->offset + read->done, chunk);
+    Priority prio = read->prio;
+    CommandOptions opts = read->opts;
+    req.handler = [self{shared_from_this()}, chunk,
+                   read{std::move(read)}](const std::error_code& ec,
+                                          std::span<uint8_t> msg) mutable {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : adminStatus(msg, data);
+        if (status == 0 && data.size() != chunk)
+        {
+            status = -1;
+        }
+        if (auto err = self->check(ec, status, "fail to get log page"))
+        {
+            auto cb = std::move(read->cb);
+            self->recycle(std::move(read));
+            cb(err, {});
+            return;
+        }
+
+        std::memcpy(read->data.data() + read->done, data.data(), chunk);
+        read->done += chunk;
+        if (read->done < read->length)
+        {
+            self->readLog(std::move(read));
+            return;
+        }
+
+        auto cb = std::move(read->cb);
+        BufferPool::Lease result = std::move(read->data);
+        self->recycle(std::move(read));
+        cb({}, {result.data(), result.size()});
+    };
+    submit(prio, opts, std::move(req));
+}
+
+void NVMeMiNative::recycle(std::unique_ptr<LogRead> read)
+{
+    read->data = {};
+    read->opts = {};
+    read->cb = nullptr;
+    spareReads.push_back(std::move(read));
+}
+
+void NVMeMiNative::adminGetLogPage(
+    nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint32_t nsid, uint8_t lsp,
+    uint16_t lsi,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    if (lid == NVME_LOG_LID_TELEMETRY_HOST ||
+        lid == NVME_LOG_LID_TELEMETRY_CTRL)
+    {
+        readTelemetry(ctrl, lid, lsp, lsi, std::move(cb), opts);
+        return;
+    }
+
+    // the size of the log page, and the number of bytes to read of it
+    size_t size = 0;
+    uint32_t length = 0;
+    uint32_t logNsid = NVME_NSID_ALL;
+    switch (lid)
+    {
+        case NVME_LOG_LID_ERROR:
+            // only one transfer of the most recent entries
+            size = mi::maxTransfer;
+            break;
+        case NVME_LOG_LID_SMART:
+            size = sizeof(nvme_smart_log);
+            length = sizeof(nvme_smart_log) -
+                     sizeof(nvme_smart_log::rsvd232);
+            logNsid = nsid;
+            break;
+        case NVME_LOG_LID_FW_SLOT:
+            size = sizeof(nvme_firmware_slot);
+            break;
+        case NVME_LOG_LID_CMD_EFFECTS:
+            size = sizeof(nvme_cmd_effects_log);
+            break;
+        case NVME_LOG_LID_DEVICE_SELF_TEST:
+            size = sizeof(nvme_self_test_log);
+            break;
+        case NVME_LOG_LID_CHANGED_NS:
+            size = sizeof(nvme_ns_list);
+            break;
+        case NVME_LOG_LID_RESERVATION:
+            size = sizeof(nvme_resv_notification_log);
+            break;
+        case NVME_LOG_LID_SANITIZE:
+            size = sizeof(nvme_sanitize_log_page);
+            break;
+        default:
+            lg2::error("[addr:{ADDR}, eid:{EID}] unknown lid for GetLogPage",
+                       "ADDR", addr, "EID", static_cast<int>(eid));
+            boost::asio::post(io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::invalid_argument), {});
+            });
+            return;
+    }
+    if (length == 0)
+    {
+        length = static_cast<uint32_t>(size);
+    }
+
+    auto read = takeLogRead();
+    read->ctrl = ctrl;
+    read->lid = lid;
+    read->nsid = logNsid;
+    read->lsp = 0;
+    read->lsi = lsi;
+    read->offset = 0;
+    read->length = length;
+    read->prio = Priority::Background;
+    read->opts = opts;
+    // the bytes not read are zero
+    read->data.resize(size);
+    read->cb = std::move(cb);
+    readLog(std::move(read));
+}
+
+void NVMeMiNative::readTelemetry(
+    nvme_mi_ctrl_t ctrl, nvme_cmd_get_log_lid lid, uint8_t lsp, uint16_t lsi,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    bool create = false;
+    if (lid == NVME_LOG_LID_TELEMETRY_HOST)
+    {
+        if (lsp == NVME_LOG_TELEM_HOST_LSP_CREATE)
+        {
+            create = true;
+        }
+        else if (lsp != NVME_LOG_TELEM_HOST_LSP_RETAIN)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] invalid lsp for telemetry host log",
+                "ADDR", addr, "EID", static_cast<int>(eid));
+            boost::asio::post(io, [cb{std::move(cb)}]() {
+                cb(std::make_error_code(std::errc::invalid_argument), {});
+            });
+            return;
+        }
+    }
+
+    // Read the header, then the header with the data areas up to area 3.
+    // Creating the host log only returns its header.
+    auto read = takeLogRead();
+    read->ctrl = ctrl;
+    read->lid = lid;
+    read->nsid = NVME_NSID_ALL;
+    read->lsp = lsp;
+    read->lsi = lsi;
+    read->offset = 0;
+    read->length = sizeof(nvme_telemetry_log);
+    read->prio = Priority::Interactive;
+    read->opts = opts;
+    read->data.resize(sizeof(nvme_telemetry_log));
+    if (create)
+    {
+        read->cb = std::move(cb);
+        readLog(std::move(read));
+        return;
+    }
+    read->cb = [self{shared_from_this()}, ctrl, lid, lsi, opts,
+                cb{std::move(cb)}](const std::error_code& ec,
+                                   std::span<uint8_t> data) mutable {
+        if (ec)
+        {
+            cb(ec, {});
+            return;
+        }
+
+        nvme_telemetry_log log;
+        std::memcpy(&log, data.data(), sizeof(log));
+        uint32_t size = (little_to_native(log.dalb3) + 1) *
+                        NVME_LOG_TELEM_BLOCK_SIZE;
+
+        auto read = self->takeLogRead();
+        read->ctrl = ctrl;
+        read->lid = lid;
+        read->nsid = NVME_NSID_ALL;
+        read->lsp = NVME_LOG_TELEM_HOST_LSP_RETAIN;
+        read->lsi = lsi;
+        read->offset = 0;
+        read->length = size;
+        read->prio = Priority::Interactive;
+        read->opts = opts;
+        read->data.resize(size);
+        read->cb = std::move(cb);
+        self->readLog(std::move(read));
+    };
+    readLog(std::move(read));
+}
+
+void NVMeMiNative::adminSanitize(
+    nvme_mi_ctrl_t ctrl, nvme_sanitize_sanact sanact, uint8_t owpass,
+    uint32_t owpattern,
+    UniqueFunction<void(const std::error_code&, std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    // no deallocate after sanitize
+    constexpr uint32_t nodas = 1u << 9;
+
+    nvme_mi_admin_req_hdr hdr{};
+    hdr.opcode = nvme_admin_sanitize_nvm;
+    hdr.cdw10 = native_to_little(static_cast<uint32_t>(sanact & 0x7) |
+                                 static_cast<uint32_t>(owpass & 0xf) << 4 |
+                                 nodas);
+    hdr.cdw11 = native_to_little(owpattern);
+
+    Request req = adminRequest(ctrl, hdr);
+    req.handler = [self{shared_from_this()},
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : adminStatus(msg, data);
+        if (auto err = self->check(ec, status, "fail to do nvme sanitize"))
+        {
+            cb(err, {});
+            return;
+        }
+
+        // the command specific result, as libnvme-mi reports it
+        nvme_mi_admin_resp_hdr resp;
+        std::memcpy(&resp, msg.data(), sizeof(resp));
+        std::array<uint8_t, 8> result{};
+        uint32_t cdw0 = little_to_native(resp.cdw0);
+        std::memcpy(result.data(), &cdw0, sizeof(cdw0));
+        cb({}, result);
+    };
+    submit(Priority::Interactive, opts, std::move(req));
+}
+
+void NVMeMiNative::adminFwCommit(
+    nvme_mi_ctrl_t ctrl, nvme_fw_commit_ca action, uint8_t slot, bool bpid,
+    UniqueFunction<void(const std::error_code&, nvme_status_field)>&& cb,
+    const CommandOptions& opts)
+{
+    nvme_mi_admin_req_hdr hdr{};
+    hdr.opcode = nvme_admin_fw_commit;
+    hdr.cdw10 = native_to_little(static_cast<uint32_t>(slot & 0x7) |
+                                 static_cast<uint32_t>(action & 0x7) << 3 |
+                                 static_cast<uint32_t>(bpid) << 31);
+
+    Request req = adminRequest(ctrl, hdr);
+    req.handler = [self{shared_from_this()},
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : adminStatus(msg, data);
+        if (ec || status < 0)
+        {
+            cb(self->check(ec, status, "fail to nvme_mi_admin_fw_commit"),
+               nvme_status_field::NVME_SC_MASK);
+            return;
+        }
+
+        switch (status & 0x7ff)
+        {
+            case NVME_SC_SUCCESS:
+            case NVME_SC_FW_NEEDS_CONV_RESET:
+            case NVME_SC_FW_NEEDS_SUBSYS_RESET:
+            case NVME_SC_FW_NEEDS_RESET:
+                cb({}, static_cast<nvme_status_field>(status));
+                break;
+            default:
+                cb(self->check(ec, status, "fail to nvme_mi_admin_fw_commit"),
+                   static_cast<nvme_status_field>(status));
+        }
+    };
+    submit(Priority::Interactive, opts, std::move(req));
+}
+
+void NVMeMiNative::adminXfer(
+    nvme_mi_ctrl_t ctrl, const nvme_mi_admin_req_hdr& admin_req,
+    std::span<uint8_t> data, unsigned int timeout_ms,
+    UniqueFunction<void(const std::error_code&, const nvme_mi_admin_resp_hdr&,
+                        std::span<uint8_t>)>&& cb,
+    const CommandOptions& opts)
+{
+    if (data.size() > mi::maxTransfer ||
+        little_to_native(admin_req.dlen) > mi::maxTransfer)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] admin transfer exceeds {MAX} "
+                   "bytes of data, fragmentation is not supported",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "MAX",
+                   mi::maxTransfer);
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::message_size), {}, {});
+        });
+        return;
+    }
+
+    nvme_mi_admin_req_hdr hdr = admin_req;
+    hdr.flags = 0;
+    if (hdr.dlen != 0)
+    {
+        hdr.flags |= mi::adminLengthValid;
+    }
+    if (hdr.doff != 0)
+    {
+        hdr.flags |= mi::adminOffsetValid;
+    }
+
+    Request req = adminRequest(ctrl, hdr, data);
+    // the caller's timeout overrides the learned one
+    req.timeoutMs = timeout_ms;
+    req.handler = [self{shared_from_this()},
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : adminStatus(msg, data);
+        if (auto err = self->check(ec, std::min(status, 0),
+                                   "failed to nvme_mi_admin_xfer"))
+        {
+            cb(err, {}, {});
+            return;
+        }
+        // the MI interface will only consume protocol/io errors, the status
+        // is the client's job
+        nvme_mi_admin_resp_hdr resp;
+        std::memcpy(&resp, msg.data(), sizeof(resp));
+        cb({}, resp, data);
+    };
+    submit(Priority::Interactive, opts, std::move(req));
+}
+
+void NVMeMiNative::adminSecuritySend(
+    nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
+    std::span<uint8_t> data,
+    UniqueFunction<void(const std::error_code&, int nvme_status)>&& cb,
+    const CommandOptions& opts)
+{
+    if (data.size() > mi::maxTransfer)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] security send exceeds {MAX} "
+                   "bytes of data, fragmentation is not supported",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "MAX",
+                   mi::maxTransfer);
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::message_size), -1);
+        });
+        return;
+    }
+
+    nvme_mi_admin_req_hdr hdr{};
+    hdr.opcode = nvme_admin_security_send;
+    hdr.flags = mi::adminLengthValid;
+    hdr.dlen = native_to_little(static_cast<uint32_t>(data.size()));
+    hdr.cdw10 = native_to_little(static_cast<uint32_t>(proto) << 24 |
+                                 static_cast<uint32_t>(proto_specific) << 8);
+    hdr.cdw11 = native_to_little(static_cast<uint32_t>(data.size()));
+
+    Request req = adminRequest(ctrl, hdr, data);
+    req.handler = [self{shared_from_this()},
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> resp;
+        int status = ec ? 0 : adminStatus(msg, resp);
+        if (auto err = self->check(ec, std::min(status, 0),
+                                   "fail to nvme_mi_admin_security_send"))
+        {
+            cb(err, -1);
+            return;
+        }
+        cb({}, status);
+    };
+    submit(Priority::Interactive, opts, std::move(req));
+}
+
+void NVMeMiNative::adminSecurityReceive(
+    nvme_mi_ctrl_t ctrl, uint8_t proto, uint16_t proto_specific,
+    uint32_t transfer_length,
+    UniqueFunction<void(const std::error_code&, int nvme_status,
+                        std::span<uint8_t> data)>&& cb,
+    const CommandOptions& opts)
+{
+    if (transfer_length > mi::maxTransfer)
+    {
+        lg2::error("[addr:{ADDR}, eid:{EID}] security receive exceeds {MAX} "
+                   "bytes of data, fragmentation is not supported",
+                   "ADDR", addr, "EID", static_cast<int>(eid), "MAX",
+                   mi::maxTransfer);
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::message_size), -1, {});
+        });
+        return;
+    }
+
+    nvme_mi_admin_req_hdr hdr{};
+    hdr.opcode = nvme_admin_security_recv;
+    hdr.flags = mi::adminLengthValid;
+    hdr.dlen = native_to_little(transfer_length);
+    hdr.cdw10 = native_to_little(static_cast<uint32_t>(proto) << 24 |
+                                 static_cast<uint32_t>(proto_specific) << 8);
+    hdr.cdw11 = native_to_little(transfer_length);
+
+    Request req = adminRequest(ctrl, hdr);
+    req.handler = [self{shared_from_this()}, transfer_length,
+                   cb{std::move(cb)}](const std::error_code& ec,
+                                      std::span<uint8_t> msg) {
+        std::span<uint8_t> data;
+        int status = ec ? 0 : adminStatus(msg, data);
+        if (status >= 0 && data.size() > transfer_length)
+        {
+            lg2::error(
+                "[addr:{ADDR}, eid:{EID}] security receive returned excess data, {LEN}",
+                "ADDR", self->addr, "EID", static_cast<int>(self->eid), "LEN",
+                data.size());
+            status = -1;
+        }
+        if (auto err = self->check(ec, std::min(status, 0),
+                                   "fail to nvme_mi_admin_security_recv"))
+        {
+            cb(err, -1, {});
+            return;
+        }
+        cb({}, status, data);
+    };
+    submit(Priority::Interactive, opts, std::move(req));
+}
+
+void NVMeMiNative::submitBatch(
+    std::span<const BatchCommand> cmds,
+    UniqueFunction<void(const std::error_code&, std::span<const BatchResult>)>&&
+        cb,
+    const CommandOptions& opts)
+{
+    bool valid = !cmds.empty() && cmds.size() <= maxBatch;
+    for (const BatchCommand& cmd : cmds)
+    {
+        valid = valid && cmd.valid() && cmd.length <= mi::maxTransfer;
+    }
+    if (!valid)
+    {
+        boost::asio::post(io, [cb{std::move(cb)}]() {
+            cb(std::make_error_code(std::errc::invalid_argument), {});
+        });
+        return;
+    }
+
+    std::unique_ptr<Batch> batch;
+    if (spareBatches.empty())
+    {
+        batch = std::make_unique<Batch>();
+    }
+    else
+    {
+        batch = std::move(spareBatches.back());
+        spareBatches.pop_back();
+    }
+
+    // keep each response aligned for the typed views
+    constexpr size_t align = alignof(std::max_align_t);
+    size_t end = 0;
+    std::copy(cmds.begin(), cmds.end(), batch->cmds.begin());
+    batch->count = cmds.size();
+    batch->next = 0;
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        batch->results[i] = {};
+        batch->offsets[i] = (end + align - 1) / align * align;
+        end = batch->offsets[i] + cmds[i].length;
+    }
+    batch->data = link->lease();
+    batch->data.resize(end);
+    batch->opts = opts;
+    batch->cb = std::move(cb);
+    runBatch(std::move(batch));
+}
+
+void NVMeMiNative::runBatch(std::unique_ptr<Batch> batch)
+{
+    const BatchCommand& cmd = batch->cmds[batch->next];
+    Request req;
+    switch (cmd.kind)
+    {
+        case BatchCommand::Kind::SubsystemHealthStatusPoll:
+            req = miRequest(nvme_mi_mi_opcode_subsys_health_status_poll, 0,
+                            cmd.id != 0 ? 1u << 31 : 0);
+            break;
+        case BatchCommand::Kind::GetLog:
+            req = getLogRequest(cmd.ctrl,
+                                static_cast<nvme_cmd_get_log_lid>(cmd.id),
+                                cmd.nsid, cmd.lsp, cmd.specific, cmd.offset,
+                                cmd.length);
+            break;
+        case BatchCommand::Kind::Identify:
+            req = identifyRequest(cmd.ctrl, cmd.id, cmd.nsid, cmd.specific,
+                                  cmd.length);
+            break;
+    }
+
+    const CommandOptions& opts = batch->opts;
+    req.handler = [self{shared_from_this()},
+                   batch{std::move(batch)}](const std::error_code& ec,
+                                            std::span<uint8_t> msg) mutable {
+        size_t i = batch->next++;
+        const BatchCommand& cmd = batch->cmds[i];
+        std::span<uint8_t> data;
+        int status = 0;
+        if (!ec)
+        {
+            status = cmd.kind == BatchCommand::Kind::SubsystemHealthStatusPoll
+                         ? miStatus(msg, data)
+                         : adminStatus(msg, data);
+        }
+        if (status == 0 && data.size() < cmd.length)
+        {
+            status = -1;
+        }
+
+        BatchResult& result = batch->results[i];
+        result.ec = self->check(ec, status, "fail to run batch command");
+        if (!result.ec)
+        {
+            result.data = {batch->data.data() + batch->offsets[i], cmd.length};
+            std::memcpy(result.data.data(), data.data(), cmd.length);
+        }
+
+        // a cancelled or expired batch is dropped as a whole
+        if (result.ec == std::errc::operation_canceled ||
+            batch->next == batch->count)
+        {
+            auto cb = std::move(batch->cb);
+            if (result.ec == std::errc::operation_canceled)
+            {
+                cb(result.ec, {});
+            }
+            else
+            {
+                cb({}, std::span<const BatchResult>(batch->results.data(),
+                                                    batch->count));
+            }
+            batch->data = {};
+            batch->opts = {};
+            self->spareBatches.push_back(std::move(batch));
+            return;
+        }
+        self->runBatch(std::move(batch));
+    };
+    submit(Priority::Background, opts, std::move(req));
+}
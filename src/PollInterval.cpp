@@ -0,0 +1,20 @@
+#include "PollInterval.hpp"
+
+#include <algorithm>
+
+PollInterval::PollInterval(std::chrono::seconds min, std::chrono::seconds max) :
+    min(min), max(std::max(min, max)), interval(min)
+{}
+
+std::chrono::seconds PollInterval::next(bool urgent)
+{
+    if (urgent)
+    {
+        interval = min;
+    }
+    else
+    {
+        interval = std::min(interval * 2, max);
+    }
+    return interval;
+}
@@ -0,0 +1,136 @@
+#include "PollScheduler.hpp"
+
+#include <algorithm>
+
+PollScheduler::Slot::~Slot()
+{
+    scheduler.leave(this);
+}
+
+PollScheduler::Clock::time_point
+    PollScheduler::Slot::next(std::chrono::seconds interval,
+                              Clock::time_point now)
+{
+    return scheduler.schedule(*this, interval, now);
+}
+
+void PollScheduler::Slot::done(Clock::time_point now)
+{
+    scheduler.complete(*this, now);
+}
+
+PollScheduler::PollScheduler(sdbusplus::asio::object_server& objServer,
+                             const std::string& path,
+                             std::chrono::seconds period) :
+    objServer(objServer),
+    period(std::max<Clock::duration>(period, std::chrono::seconds(1))),
+    epoch(Clock::now()), rng(std::random_device{}())
+{
+    iface = objServer.add_interface(path, schedulerInterface);
+    iface->register_property(
+        "Period", static_cast<uint64_t>(
+                      std::chrono::duration_cast<std::chrono::milliseconds>(
+                          this->period)
+                          .count()));
+    iface->register_property("Drives", static_cast<uint32_t>(0));
+    iface->register_property("CycleCompletionTime", static_cast<uint64_t>(0));
+    iface->initialize();
+}
+
+PollScheduler::~PollScheduler()
+{
+    objServer.remove_interface(iface);
+}
+
+std::unique_ptr<PollScheduler::Slot> PollScheduler::join()
+{
+    std::unique_ptr<Slot> slot(new Slot(*this));
+    slots.push_back(slot.get());
+    rebalance();
+    return slot;
+}
+
+void PollScheduler::leave(Slot* slot)
+{
+    std::erase(slots, slot);
+    rebalance();
+}
+
+void PollScheduler::rebalance()
+{
+    for (size_t i = 0; i < slots.size(); i++)
+    {
+        slots[i]->phase = period * i / slots.size();
+    }
+    iface->set_property("Drives", static_cast<uint32_t>(slots.size()));
+}
+
+PollScheduler::Clock::time_point
+    PollScheduler::schedule(Slot& slot, std::chrono::seconds interval,
+                            Clock::time_point now)
+{
+    auto earliest = now;
+    if (slot.scheduled)
+    {
+        earliest = std::max(earliest, slot.due + interval);
+    }
+
+    // the first grid point of the slot not before earliest
+    auto base = epoch + slot.phase;
+    int64_t k = 0;
+    if (earliest > base)
+    {
+        k = (earliest - base + period - Clock::duration(1)) / period;
+    }
+    slot.due = base + k * period;
+    slot.scheduled = true;
+
+    auto spacing = period / std::max<size_t>(slots.size(), 1);
+    std::uniform_int_distribution<Clock::rep> dist(0, spacing.count() / 4);
+    return slot.due + Clock::duration(dist(rng));
+}
+
+void PollScheduler::complete(const Slot& slot, Clock::time_point now)
+{
+    int64_t c = (slot.due - epoch) / period;
+    auto elapsed = now - (epoch + c * period);
+    if (c == cycle)
+    {
+        cycleCompletion = std::max(cycleCompletion, elapsed);
+    }
+    else if (c == cycle - 1)
+    {
+        // a straggler of the previous period, not published yet
+        previousCompletion = std::max(previousCompletion, elapsed);
+    }
+    else if (c > cycle)
+    {
+        // a period is published once the next one got its completions, so
+        // its late polls are accounted as well
+        if (previousCompletion != Clock::duration::zero())
+        {
+            publish(previousCompletion);
+        }
+        previousCompletion = Clock::duration::zero();
+        if (c == cycle + 1)
+        {
+            previousCompletion = cycleCompletion;
+        }
+        else if (cycle >= 0)
+        {
+            publish(cycleCompletion);
+        }
+        cycle = c;
+        cycleCompletion = elapsed;
+    }
+}
+
+void PollScheduler::publish(Clock::duration completion)
+{
+    published = completion;
+    iface->set_property(
+        "CycleCompletionTime",
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(completion)
+                .count()));
+}
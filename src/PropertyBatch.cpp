@@ -0,0 +1,50 @@
+#include "PropertyBatch.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <systemd/sd-bus.h>
+
+#include <algorithm>
+#include <cstring>
+
+void PropertyBatch::changed(const char* interface, const char* property)
+{
+    auto it = std::find_if(pending.begin(), pending.end(),
+                           [interface](const auto& entry) {
+        return std::strcmp(entry.first, interface) == 0;
+    });
+    if (it == pending.end())
+    {
+        it = pending.emplace(pending.end(), interface,
+                             std::vector<const char*>{});
+    }
+    auto& names = it->second;
+    if (std::find_if(names.begin(), names.end(), [property](const char* n) {
+        return std::strcmp(n, property) == 0;
+    }) == names.end())
+    {
+        names.push_back(property);
+    }
+}
+
+void PropertyBatch::flush()
+{
+    for (auto& [interface, names] : pending)
+    {
+        if (names.empty())
+        {
+            continue;
+        }
+        // sd-bus takes a NULL terminated list
+        names.push_back(nullptr);
+        int rc = sd_bus_emit_properties_changed_strv(
+            bus.get(), path.c_str(), interface,
+            const_cast<char**>(names.data()));
+        if (rc < 0)
+        {
+            lg2::error("fail to emit PropertiesChanged of {IFACE} on {PATH}: "
+                       "{RC}",
+                       "IFACE", interface, "PATH", path, "RC", rc);
+        }
+        names.clear();
+    }
+}
@@ -0,0 +1,96 @@
+#include <TemperatureSensor.hpp>
+
+#include <limits>
+
+namespace
+{
+
+constexpr double noValue = std::numeric_limits<double>::quiet_NaN();
+
+double toValue(std::optional<int16_t> celsius)
+{
+    return celsius ? static_cast<double>(*celsius) : noValue;
+}
+
+std::string sensorPath(const std::string& name)
+{
+    return "/xyz/openbmc_project/sensors/temperature/" + name;
+}
+
+} // namespace
+
+TemperatureSensor::TemperatureSensor(sdbusplus::bus_t& bus,
+                                     const std::string& name,
+                                     const std::string& drivePath) :
+    iface(std::make_unique<SensorInterfaces>(
+        bus, sensorPath(name).c_str(), SensorInterfaces::action::defer_emit)),
+    changedProps(bus, sensorPath(name))
+{
+    // the range of the composite temperature of the health status poll
+    iface->SensorValue::unit(SensorValue::Unit::DegreesC, true);
+    iface->SensorValue::maxValue(127, true);
+    iface->SensorValue::minValue(-127, true);
+    iface->SensorValue::value(noValue, true);
+    iface->WarningThreshold::warningHigh(noValue, true);
+    iface->WarningThreshold::warningLow(noValue, true);
+    iface->CriticalThreshold::criticalHigh(noValue, true);
+    iface->CriticalThreshold::criticalLow(noValue, true);
+    iface->Associations::associations({{"inventory", "sensors", drivePath}});
+    iface->emit_object_added();
+    publishedValue.update(std::nullopt);
+}
+
+void TemperatureSensor::setThresholds(std::optional<int16_t> warning,
+                                      std::optional<int16_t> critical)
+{
+    if (warning != warningHigh)
+    {
+        warningHigh = warning;
+        iface->WarningThreshold::warningHigh(toValue(warning), true);
+        changedProps.changed(WarningThreshold::interface, "WarningHigh");
+    }
+    if (critical != criticalHigh)
+    {
+        criticalHigh = critical;
+        iface->CriticalThreshold::criticalHigh(toValue(critical), true);
+        changedProps.changed(CriticalThreshold::interface, "CriticalHigh");
+    }
+    updateAlarms();
+    changedProps.flush();
+}
+
+void TemperatureSensor::update(std::optional<int16_t> celsius)
+{
+    reading = celsius;
+    if (!publishedValue.update(celsius))
+    {
+        // the common case of a 1 Hz sampler, nothing is signalled
+        return;
+    }
+    iface->SensorValue::value(toValue(celsius), true);
+    changedProps.changed(SensorValue::interface, "Value");
+    updateAlarms();
+    changedProps.flush();
+}
+
+void TemperatureSensor::updateAlarms()
+{
+    // the alarms hold their state while there is no reading
+    if (!reading)
+    {
+        return;
+    }
+    bool warning = warningHigh && *reading >= *warningHigh;
+    if (warning != iface->WarningThreshold::warningAlarmHigh())
+    {
+        iface->WarningThreshold::warningAlarmHigh(warning, true);
+        changedProps.changed(WarningThreshold::interface, "WarningAlarmHigh");
+    }
+    bool critical = criticalHigh && *reading >= *criticalHigh;
+    if (critical != iface->CriticalThreshold::criticalAlarmHigh())
+    {
+        iface->CriticalThreshold::criticalAlarmHigh(critical, true);
+        changedProps.changed(CriticalThreshold::interface,
+                             "CriticalAlarmHigh");
+    }
+}
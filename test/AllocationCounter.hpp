@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * The number of calls to the global operator new so far, by any thread.
+ *
+ * Linking AllocationCounter.cpp replaces the global operator new and
+ * delete of the program with counting ones.
+ */
+size_t allocationCount();
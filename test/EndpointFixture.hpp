@@ -0,0 +1,65 @@
+#pragma once
+
+#include "FakeMctpDemux.hpp"
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+/**
+ * @brief The io_context, the D-Bus connection and the fake MCTP demux daemon
+ * an NVMe-MI endpoint is created with.
+ *
+ * The endpoints publish their statistics on D-Bus, so the tests are skipped
+ * where no bus can be connected to.
+ */
+class EndpointFixture : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        try
+        {
+            conn = std::make_shared<sdbusplus::asio::connection>(io);
+        }
+        catch (const std::exception& e)
+        {
+            GTEST_SKIP() << "no D-Bus connection: " << e.what();
+        }
+        objServer =
+            std::make_unique<sdbusplus::asio::object_server>(conn, true);
+    }
+
+    // Run the io_context until done() holds, and return false if it still
+    // doesn't after the timeout.
+    template <class Pred>
+    bool runUntil(Pred done, std::chrono::milliseconds timeout =
+                                 std::chrono::seconds(5))
+    {
+        // wait for the handlers posted by other threads
+        auto work = boost::asio::make_work_guard(io);
+        auto end = std::chrono::steady_clock::now() + timeout;
+        while (!done())
+        {
+            if (std::chrono::steady_clock::now() >= end)
+            {
+                return false;
+            }
+            io.run_for(std::chrono::milliseconds(1));
+            io.restart();
+        }
+        return true;
+    }
+
+    boost::asio::io_context io;
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    std::unique_ptr<sdbusplus::asio::object_server> objServer;
+    FakeMctpDemux demux;
+};
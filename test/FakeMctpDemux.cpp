@@ -0,0 +1,289 @@
+#include "FakeMctpDemux.hpp"
+
+#include "NVMeMiMessage.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/endian.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <system_error>
+
+using boost::endian::little_to_native;
+
+namespace
+{
+
+constexpr uint8_t rorResponse = 1 << 7;
+constexpr uint8_t adminOpcodeGetLogPage = 0x02;
+constexpr uint8_t dtypSubsystem = 0x00;
+constexpr uint8_t dtypPort = 0x01;
+constexpr uint8_t dtypCtrlList = 0x02;
+constexpr uint8_t portTypePCIe = 0x01;
+
+// the eid, then the largest response with its MIC
+constexpr size_t maxResponse =
+    1 + sizeof(nvme_mi_admin_resp_hdr) + mi::maxTransfer + mi::micSize;
+
+std::system_error lastError(const char* what)
+{
+    return {errno, std::generic_category(), what};
+}
+
+template <class T>
+void append(std::vector<uint8_t>& out, const T& value)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+struct Pending
+{
+    std::chrono::steady_clock::time_point due;
+    int fd;
+    std::vector<uint8_t> msg;
+
+    bool operator>(const Pending& other) const
+    {
+        return due > other.due;
+    }
+};
+
+} // namespace
+
+FakeMctpDemux::FakeMctpDemux()
+{
+    static std::atomic<unsigned> instances{0};
+    std::string id = "nvme-test-mux-" + std::to_string(getpid()) + "-" +
+                     std::to_string(instances++);
+    name.push_back(0);
+    name.insert(name.end(), id.begin(), id.end());
+    name.push_back(0);
+
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        throw lastError("socket");
+    }
+    sockaddr_un sa{};
+    sa.sun_family = AF_UNIX;
+    std::memcpy(sa.sun_path, name.data(), name.size() - 1);
+    auto len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) +
+                                      name.size() - 1);
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&sa), len) != 0 ||
+        listen(listenFd, 8) != 0)
+    {
+        auto err = lastError("bind");
+        close(listenFd);
+        throw err;
+    }
+    stopFd = eventfd(0, EFD_CLOEXEC);
+    if (stopFd < 0)
+    {
+        auto err = lastError("eventfd");
+        close(listenFd);
+        throw err;
+    }
+    thread = std::thread([this] { run(); });
+}
+
+FakeMctpDemux::~FakeMctpDemux()
+{
+    eventfd_write(stopFd, 1);
+    thread.join();
+    close(stopFd);
+    close(listenFd);
+}
+
+void FakeMctpDemux::run()
+{
+    std::vector<pollfd> fds{{stopFd, POLLIN, 0}, {listenFd, POLLIN, 0}};
+    // a heap of the responses by due time, and the buffers of the responses
+    // sent, for reuse
+    std::vector<Pending> queue;
+    std::vector<std::vector<uint8_t>> spare;
+    std::array<uint8_t, 8192> buf{};
+
+    while (true)
+    {
+        int timeout = -1;
+        if (!queue.empty())
+        {
+            auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+                queue.front().due - std::chrono::steady_clock::now());
+            timeout = static_cast<int>(std::max<int64_t>(wait.count(), 0));
+        }
+        if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if ((fds[0].revents & POLLIN) != 0)
+        {
+            break;
+        }
+        if ((fds[1].revents & POLLIN) != 0)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            uint8_t type = 0;
+            // the client subscribes with the message type first
+            if (fd >= 0 && recv(fd, &type, sizeof(type), 0) == sizeof(type))
+            {
+                fds.push_back({fd, POLLIN, 0});
+            }
+            else if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+        for (size_t i = 2; i < fds.size(); i++)
+        {
+            if ((fds[i].revents & (POLLIN | POLLHUP)) == 0)
+            {
+                continue;
+            }
+            ssize_t n = recv(fds[i].fd, buf.data(), buf.size(), 0);
+            if (n <= 0)
+            {
+                close(fds[i].fd);
+                fds[i].fd = -1;
+                continue;
+            }
+            std::vector<uint8_t> rsp;
+            if (spare.empty())
+            {
+                rsp.reserve(maxResponse);
+            }
+            else
+            {
+                rsp = std::move(spare.back());
+                spare.pop_back();
+            }
+            if (!respond(buf.data(), static_cast<size_t>(n), rsp))
+            {
+                spare.push_back(std::move(rsp));
+                continue;
+            }
+            auto latency = std::chrono::milliseconds(latencyMs[buf[0]]);
+            queue.push_back({std::chrono::steady_clock::now() + latency,
+                             fds[i].fd, std::move(rsp)});
+            std::push_heap(queue.begin(), queue.end(), std::greater<>());
+        }
+        std::erase_if(fds, [](const pollfd& p) { return p.fd < 0; });
+
+        auto now = std::chrono::steady_clock::now();
+        while (!queue.empty() && queue.front().due <= now)
+        {
+            std::pop_heap(queue.begin(), queue.end(), std::greater<>());
+            Pending& next = queue.back();
+            // a client which went away is not an error
+            send(next.fd, next.msg.data(), next.msg.size(), MSG_NOSIGNAL);
+            spare.push_back(std::move(next.msg));
+            queue.pop_back();
+        }
+    }
+
+    for (size_t i = 2; i < fds.size(); i++)
+    {
+        close(fds[i].fd);
+    }
+}
+
+bool FakeMctpDemux::respond(const uint8_t* req, size_t len,
+                            std::vector<uint8_t>& rsp)
+{
+    if (len < 1 + sizeof(nvme_mi_msg_hdr) + mi::micSize)
+    {
+        return false;
+    }
+    uint8_t eid = req[0];
+    std::span<const uint8_t> msg(req + 1, len - 1);
+    uint32_t mic = 0;
+    std::memcpy(&mic, msg.data() + msg.size() - mi::micSize, mi::micSize);
+    if (little_to_native(mic) !=
+        mi::crc32c(msg.first(msg.size() - mi::micSize)))
+    {
+        return false;
+    }
+    received[eid]++;
+
+    nvme_mi_msg_hdr hdr{};
+    std::memcpy(&hdr, msg.data(), sizeof(hdr));
+    hdr.nmp |= rorResponse;
+    auto nmimt = (msg[1] >> 3) & 0xf;
+
+    rsp.assign(1, eid);
+    if (nmimt == NVME_MI_MT_MI && msg.size() >= sizeof(nvme_mi_mi_req_hdr))
+    {
+        nvme_mi_mi_req_hdr mreq{};
+        std::memcpy(&mreq, msg.data(), sizeof(mreq));
+        nvme_mi_mi_resp_hdr mrsp{};
+        mrsp.hdr = hdr;
+        append(rsp, mrsp);
+
+        uint32_t cdw0 = little_to_native(mreq.cdw0);
+        uint8_t dtyp = cdw0 >> 24;
+        if (mreq.opcode == nvme_mi_mi_opcode_subsys_health_status_poll)
+        {
+            nvme_mi_nvm_ss_health_status health{};
+            health.nss = 0x20;
+            health.ctemp = temperature;
+            health.pdlu = 3;
+            append(rsp, health);
+        }
+        else if (dtyp == dtypSubsystem)
+        {
+            nvme_mi_read_nvm_ss_info info{};
+            info.nump = 1;
+            append(rsp, info);
+        }
+        else if (dtyp == dtypPort)
+        {
+            nvme_mi_read_port_info info{};
+            info.portt = portTypePCIe;
+            append(rsp, info);
+        }
+        else if (dtyp == dtypCtrlList)
+        {
+            // two identifiers, 0 and 1
+            const std::array<uint8_t, 6> list{2, 0, 0, 0, 1, 0};
+            rsp.insert(rsp.end(), list.begin(), list.end());
+        }
+    }
+    else if (nmimt == NVME_MI_MT_ADMIN &&
+             msg.size() >= sizeof(nvme_mi_admin_req_hdr))
+    {
+        nvme_mi_admin_req_hdr areq{};
+        std::memcpy(&areq, msg.data(), sizeof(areq));
+        nvme_mi_admin_resp_hdr arsp{};
+        arsp.hdr = hdr;
+        append(rsp, arsp);
+
+        uint32_t offset = 0;
+        if (areq.opcode == adminOpcodeGetLogPage)
+        {
+            offset = little_to_native(areq.cdw12);
+        }
+        uint32_t dlen = std::min<uint32_t>(little_to_native(areq.dlen),
+                                           mi::maxTransfer);
+        for (uint32_t i = 0; i < dlen; i++)
+        {
+            rsp.push_back(pattern(offset + i));
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    rsp.resize(rsp.size() + mi::micSize);
+    mi::seal({rsp.data() + 1, rsp.size() - 1});
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A stand-in for the MCTP demux daemon and the drives behind it.
+ *
+ * It listens on an abstract SOCK_SEQPACKET socket and speaks the protocol of
+ * the demux daemon: a client subscribes with the message type, then every
+ * message is prefixed with the eid of the endpoint. The NVMe-MI requests are
+ * answered from a thread of its own, each after the latency configured for
+ * its eid, so the requests to different endpoints overlap like on a real
+ * bus.
+ *
+ * Once warmed up, it doesn't allocate, so that it doesn't add to the
+ * allocations counted in the process.
+ *
+ * Every eid is a drive with a healthy subsystem at 40 Celsius and two
+ * controllers, 0 and 1. The data of an admin command is a pattern of the
+ * byte offset, the get log page offset included, so that a chunked read can
+ * be checked.
+ */
+class FakeMctpDemux
+{
+  public:
+    // the composite temperature of the health status poll, in Celsius
+    static constexpr uint8_t temperature = 40;
+
+    FakeMctpDemux();
+    ~FakeMctpDemux();
+
+    FakeMctpDemux(const FakeMctpDemux&) = delete;
+    FakeMctpDemux& operator=(const FakeMctpDemux&) = delete;
+
+    // The socket name the way NVMeMi and NVMeMiNative take it: abstract,
+    // with a terminating NUL.
+    const std::vector<uint8_t>& sockName() const
+    {
+        return name;
+    }
+
+    // The time the drive takes to respond, applied to the requests received
+    // from now on.
+    void setLatency(uint8_t eid, std::chrono::milliseconds latency)
+    {
+        latencyMs[eid] = static_cast<uint32_t>(latency.count());
+    }
+
+    // the requests of the eid with a valid MIC received so far
+    unsigned requests(uint8_t eid) const
+    {
+        return received[eid];
+    }
+
+    // the byte at offset of the data of an admin command
+    static uint8_t pattern(uint32_t offset)
+    {
+        return static_cast<uint8_t>(offset * 7 + 3);
+    }
+
+  private:
+    void run();
+
+    // Build the response to the request, the eid included, into rsp.
+    // Return false to drop the request.
+    bool respond(const uint8_t* req, size_t len, std::vector<uint8_t>& rsp);
+
+    std::vector<uint8_t> name;
+    int listenFd = -1;
+    int stopFd = -1;
+    std::array<std::atomic<uint32_t>, 256> latencyMs{};
+    std::array<std::atomic<unsigned>, 256> received{};
+    std::thread thread;
+};
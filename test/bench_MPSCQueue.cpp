@@ -0,0 +1,193 @@
+#include "MPSCQueue.hpp"
+#include "UniqueFunction.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+/*
+ * The time from posting a command to a worker thread until the worker runs
+ * it, for a burst of commands whose size is the argument. The doorbell
+ * worker hands the commands over like NVMeMi::Worker. The condvar worker is
+ * the way commands were handed over before, through a queue guarded by a
+ * mutex and a condition variable signalled on every post.
+ */
+
+namespace
+{
+
+using Job = UniqueFunction<void()>;
+
+class DoorbellWorker
+{
+  public:
+    DoorbellWorker() : doorbell(eventfd(0, EFD_CLOEXEC)), thread([this] {
+        run();
+    })
+    {}
+
+    ~DoorbellWorker()
+    {
+        stop.store(true);
+        ring();
+        thread.join();
+        close(doorbell);
+    }
+
+    DoorbellWorker(const DoorbellWorker&) = delete;
+    DoorbellWorker& operator=(const DoorbellWorker&) = delete;
+
+    void post(Job&& job)
+    {
+        while (!queue.push(std::move(job)))
+        {
+            std::this_thread::yield();
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle.exchange(false))
+        {
+            ring();
+        }
+    }
+
+  private:
+    void ring()
+    {
+        uint64_t one = 1;
+        while (write(doorbell, &one, sizeof(one)) < 0 && errno == EINTR)
+        {}
+    }
+
+    void run()
+    {
+        while (true)
+        {
+            while (auto job = queue.pop())
+            {
+                (*job)();
+            }
+            if (stop.load())
+            {
+                break;
+            }
+            idle.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!queue.empty() || stop.load())
+            {
+                idle.store(false);
+                continue;
+            }
+            uint64_t count = 0;
+            while (read(doorbell, &count, sizeof(count)) < 0 && errno == EINTR)
+            {}
+            idle.store(false);
+        }
+    }
+
+    MPSCQueue<Job, 64> queue;
+    std::atomic<bool> idle{false};
+    std::atomic<bool> stop{false};
+    int doorbell;
+    std::thread thread;
+};
+
+class CondvarWorker
+{
+  public:
+    CondvarWorker() : thread([this] { run(); }) {}
+
+    ~CondvarWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_one();
+        thread.join();
+    }
+
+    CondvarWorker(const CondvarWorker&) = delete;
+    CondvarWorker& operator=(const CondvarWorker&) = delete;
+
+    void post(Job&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            queue.push_back(std::move(job));
+        }
+        cv.notify_one();
+    }
+
+  private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true)
+        {
+            cv.wait(lock, [this] { return stop || !queue.empty(); });
+            if (queue.empty())
+            {
+                break;
+            }
+            Job job = std::move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Job> queue;
+    bool stop = false;
+    std::thread thread;
+};
+
+template <class Worker>
+void postToRun(benchmark::State& state)
+{
+    Worker worker;
+    auto burst = state.range(0);
+    std::atomic<int64_t> left{0};
+    // written by the worker, and read once it ran the last job
+    int64_t totalNs = 0;
+
+    for (auto _ : state)
+    {
+        left.store(burst);
+        for (int64_t i = 0; i < burst; i++)
+        {
+            worker.post(
+                [&left, &totalNs, posted{std::chrono::steady_clock::now()}] {
+                totalNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::steady_clock::now() - posted)
+                               .count();
+                left.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        while (left.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    state.counters["post_to_run_ns"] =
+        benchmark::Counter(static_cast<double>(totalNs) /
+                           static_cast<double>(burst),
+                           benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(postToRun, DoorbellWorker)->Arg(1)->Arg(16)->UseRealTime();
+BENCHMARK_TEMPLATE(postToRun, CondvarWorker)->Arg(1)->Arg(16)->UseRealTime();
@@ -0,0 +1,189 @@
+#include "AllocationCounter.hpp"
+#include "FakeMctpDemux.hpp"
+#include "NVMeMi.hpp"
+#include "NVMeMiNative.hpp"
+
+#include <sys/resource.h>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+/*
+ * A round of health status polls on every drive of a chassis, through the
+ * fake MCTP demux daemon with a fixed drive latency. The drive count is the
+ * argument. The process CPU time includes the worker threads, and ctxsw
+ * counts the context switches of the process per round. allocs counts the
+ * heap allocations per poll.
+ */
+
+namespace
+{
+
+constexpr auto driveLatency = std::chrono::milliseconds(5);
+constexpr uint8_t firstEid = 20;
+constexpr int firstBus = 1100;
+
+struct Rig
+{
+    Rig()
+    {
+        try
+        {
+            conn = std::make_shared<sdbusplus::asio::connection>(io);
+            objServer =
+                std::make_unique<sdbusplus::asio::object_server>(conn, true);
+        }
+        catch (const std::exception&)
+        {
+            conn.reset();
+        }
+    }
+
+    template <class Ep>
+    void pollRound(std::vector<std::shared_ptr<Ep>>& eps)
+    {
+        size_t done = 0;
+        for (auto& ep : eps)
+        {
+            ep->miSubsystemHealthStatusPoll(
+                [&done](const std::error_code& ec,
+                        nvme_mi_nvm_ss_health_status*) {
+                if (ec)
+                {
+                    throw std::system_error(ec);
+                }
+                done++;
+            });
+        }
+        // A handler posted by a worker thread is picked up once the
+        // io_context wakes up, so it runs in slices, which are the
+        // resolution of the measured time.
+        auto work = boost::asio::make_work_guard(io);
+        while (done < eps.size())
+        {
+            io.run_for(std::chrono::milliseconds(1));
+            io.restart();
+        }
+    }
+
+    template <class Ep>
+    void run(benchmark::State& state, std::vector<std::shared_ptr<Ep>>& eps)
+    {
+        pollRound(eps);
+        rusage before{};
+        getrusage(RUSAGE_SELF, &before);
+        size_t allocs = allocationCount();
+        for (auto _ : state)
+        {
+            pollRound(eps);
+        }
+        allocs = allocationCount() - allocs;
+        rusage after{};
+        getrusage(RUSAGE_SELF, &after);
+        state.counters["allocs"] = benchmark::Counter(
+            static_cast<double>(allocs) / static_cast<double>(eps.size()),
+            benchmark::Counter::kAvgIterations);
+        state.counters["ctxsw"] = benchmark::Counter(
+            static_cast<double>(after.ru_nvcsw + after.ru_nivcsw -
+                                before.ru_nvcsw - before.ru_nivcsw),
+            benchmark::Counter::kAvgIterations);
+    }
+
+    boost::asio::io_context io;
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    std::unique_ptr<sdbusplus::asio::object_server> objServer;
+    FakeMctpDemux demux;
+};
+
+// the drives on buses of their own, each polled by its own worker
+void healthPollWorkerPerBus(benchmark::State& state)
+{
+    Rig rig;
+    if (!rig.conn)
+    {
+        state.SkipWithError("no D-Bus connection");
+        return;
+    }
+    std::vector<std::shared_ptr<NVMeMi>> eps;
+    for (int i = 0; i < state.range(0); i++)
+    {
+        auto eid = static_cast<uint8_t>(firstEid + i);
+        rig.demux.setLatency(eid, driveLatency);
+        eps.push_back(std::make_shared<NVMeMi>(rig.io, rig.conn,
+                                               *rig.objServer, firstBus + i,
+                                               rig.demux.sockName(), eid));
+    }
+    rig.run(state, eps);
+}
+
+// the drives on one bus, the way every drive was polled before the workers
+// were keyed by bus
+void healthPollSharedWorker(benchmark::State& state)
+{
+    Rig rig;
+    if (!rig.conn)
+    {
+        state.SkipWithError("no D-Bus connection");
+        return;
+    }
+    std::vector<std::shared_ptr<NVMeMi>> eps;
+    for (int i = 0; i < state.range(0); i++)
+    {
+        auto eid = static_cast<uint8_t>(firstEid + i);
+        rig.demux.setLatency(eid, driveLatency);
+        eps.push_back(std::make_shared<NVMeMi>(rig.io, rig.conn,
+                                               *rig.objServer, firstBus,
+                                               rig.demux.sockName(), eid));
+    }
+    rig.run(state, eps);
+}
+
+// the drives behind one socket to the demux daemon, without libnvme-mi and
+// without worker threads
+void healthPollNative(benchmark::State& state)
+{
+    Rig rig;
+    if (!rig.conn)
+    {
+        state.SkipWithError("no D-Bus connection");
+        return;
+    }
+    std::vector<std::shared_ptr<NVMeMiNative>> eps;
+    for (int i = 0; i < state.range(0); i++)
+    {
+        auto eid = static_cast<uint8_t>(firstEid + i);
+        rig.demux.setLatency(eid, driveLatency);
+        eps.push_back(std::make_shared<NVMeMiNative>(
+            rig.io, rig.conn, *rig.objServer, firstBus, rig.demux.sockName(),
+            eid));
+    }
+    rig.run(state, eps);
+}
+
+} // namespace
+
+BENCHMARK(healthPollWorkerPerBus)
+    ->Arg(16)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(healthPollSharedWorker)
+    ->Arg(16)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime()
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(healthPollNative)
+    ->Arg(16)
+    ->UseRealTime()
+    ->MeasureProcessCPUTime()
+    ->Unit(benchmark::kMillisecond);
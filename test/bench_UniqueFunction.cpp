@@ -0,0 +1,121 @@
+#include "AllocationCounter.hpp"
+#include "UniqueFunction.hpp"
+
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+/*
+ * The heap allocations of a command on its way through the layers of
+ * NVMeMi: the caller's callback, the task the method queues to the worker,
+ * and the completion the worker posts back with the result. The layers are
+ * modelled once with std::function and once with UniqueFunction, with the
+ * capture sizes of a health status poll.
+ */
+
+namespace
+{
+
+struct Device
+{
+    int polls = 0;
+};
+
+struct HealthStatus
+{
+    uint8_t nss;
+    uint8_t sw;
+    uint8_t ctemp;
+    uint8_t pdlu;
+    uint16_t ccs;
+};
+
+template <bool Small, class Signature, size_t BufSize = 64>
+using Function = std::conditional_t<Small, UniqueFunction<Signature, BufSize>,
+                                    std::function<Signature>>;
+
+// the buffer sizes of UniqueFunction are the ones of NVMeMi
+template <bool Small>
+struct Layers
+{
+    using Callback =
+        Function<Small, void(const std::error_code&, const HealthStatus&)>;
+    using Task = Function<Small, void(const std::error_code&), 192>;
+    using Completion = Function<Small, void(), 128>;
+
+    // the worker queue and the io_context queue, with preallocated storage
+    Layers()
+    {
+        tasks.reserve(1);
+        completions.reserve(1);
+    }
+
+    void poll(Callback&& cb)
+    {
+        tasks.emplace_back([self{self}, this, cb{std::move(cb)}](
+                               const std::error_code& ec) mutable {
+            HealthStatus status{0x20, 0, 40, 3, 0};
+            completions.emplace_back(
+                [cb{std::move(cb)}, ec, status]() { cb(ec, status); });
+        });
+    }
+
+    void runWorker()
+    {
+        for (auto& task : tasks)
+        {
+            task({});
+        }
+        tasks.clear();
+    }
+
+    void runIo()
+    {
+        for (auto& completion : completions)
+        {
+            completion();
+        }
+        completions.clear();
+    }
+
+    // the endpoint, which a task keeps alive
+    std::shared_ptr<int> self = std::make_shared<int>(0);
+    std::vector<Task> tasks;
+    std::vector<Completion> completions;
+};
+
+template <bool Small>
+void commandAllocations(benchmark::State& state)
+{
+    Layers<Small> layers;
+    auto dev = std::make_shared<Device>();
+    size_t before = allocationCount();
+
+    for (auto _ : state)
+    {
+        layers.poll([dev, tag{0}](const std::error_code& ec,
+                                  const HealthStatus& status) {
+            if (!ec && status.ctemp != 0)
+            {
+                dev->polls += 1 + tag;
+            }
+        });
+        layers.runWorker();
+        layers.runIo();
+    }
+
+    state.counters["allocs"] =
+        benchmark::Counter(static_cast<double>(allocationCount() - before),
+                           benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+// std::function
+BENCHMARK_TEMPLATE(commandAllocations, false);
+// UniqueFunction
+BENCHMARK_TEMPLATE(commandAllocations, true);
@@ -0,0 +1,151 @@
+#include "AllocationCounter.hpp"
+#include "BufferPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+TEST(BufferPool, ReusesReleasedSlab)
+{
+    auto pool = std::make_shared<BufferPool>(2);
+    const uint8_t* first = nullptr;
+    {
+        auto lease = pool->lease();
+        lease.resize(16);
+        first = lease.data();
+    }
+
+    size_t before = allocationCount();
+    auto lease = pool->lease();
+    lease.resize(BufferPool::slabSize);
+    EXPECT_EQ(allocationCount(), before);
+    EXPECT_EQ(lease.data(), first);
+}
+
+TEST(BufferPool, KeepsAtMostMaxIdleSlabs)
+{
+    auto pool = std::make_shared<BufferPool>(2);
+    {
+        std::vector<BufferPool::Lease> leases;
+        for (int i = 0; i < 3; i++)
+        {
+            leases.push_back(pool->lease());
+            leases.back().resize(1);
+        }
+    }
+
+    std::vector<BufferPool::Lease> leases;
+    leases.reserve(3);
+    size_t before = allocationCount();
+    for (int i = 0; i < 2; i++)
+    {
+        leases.push_back(pool->lease());
+        leases.back().resize(1);
+    }
+    EXPECT_EQ(allocationCount(), before);
+
+    // the third slab was freed when it was given back
+    leases.push_back(pool->lease());
+    leases.back().resize(1);
+    EXPECT_EQ(allocationCount(), before + 1);
+}
+
+TEST(BufferPool, GrowingZeroFills)
+{
+    auto pool = std::make_shared<BufferPool>(1);
+    {
+        // leave a dirty slab in the pool
+        auto lease = pool->lease();
+        lease.resize(64);
+        std::fill_n(lease.data(), 64, 0xff);
+    }
+
+    auto lease = pool->lease();
+    lease.resize(4);
+    lease.data()[0] = 0xaa;
+    lease.resize(2);
+    lease.resize(64);
+    EXPECT_EQ(lease.data()[0], 0xaa);
+    for (size_t i = 1; i < 64; i++)
+    {
+        EXPECT_EQ(lease.data()[i], 0) << "at " << i;
+    }
+}
+
+TEST(BufferPool, LargerThanSlabComesFromHeap)
+{
+    auto pool = std::make_shared<BufferPool>(1);
+    auto lease = pool->lease();
+    lease.resize(3);
+    lease.data()[0] = 1;
+    lease.data()[1] = 2;
+    lease.data()[2] = 3;
+    const uint8_t* slab = lease.data();
+
+    lease.resize(BufferPool::slabSize + 1);
+    ASSERT_EQ(lease.size(), BufferPool::slabSize + 1);
+    EXPECT_NE(lease.data(), slab);
+    EXPECT_EQ(lease.data()[0], 1);
+    EXPECT_EQ(lease.data()[1], 2);
+    EXPECT_EQ(lease.data()[2], 3);
+    EXPECT_EQ(lease.data()[BufferPool::slabSize], 0);
+
+    // the slab went back to the pool when the lease grew out of it
+    auto other = pool->lease();
+    other.resize(1);
+    EXPECT_EQ(other.data(), slab);
+}
+
+TEST(BufferPool, LeaseWithoutPoolUsesHeap)
+{
+    BufferPool::Lease lease;
+    lease.resize(8);
+    ASSERT_NE(lease.data(), nullptr);
+    EXPECT_EQ(lease.size(), 8);
+    EXPECT_EQ(lease.data()[7], 0);
+}
+
+TEST(BufferPool, MoveTransfersBuffer)
+{
+    auto pool = std::make_shared<BufferPool>(1);
+    auto a = pool->lease();
+    a.resize(5);
+    a.data()[4] = 9;
+    const uint8_t* slab = a.data();
+
+    BufferPool::Lease b(std::move(a));
+    EXPECT_EQ(a.size(), 0);
+    EXPECT_EQ(a.data(), nullptr);
+    EXPECT_EQ(b.size(), 5);
+    EXPECT_EQ(b.data(), slab);
+    EXPECT_EQ(b.data()[4], 9);
+
+    // the slab of the assigned-to lease goes back to the pool
+    auto c = pool->lease();
+    c.resize(1);
+    const uint8_t* other = c.data();
+    c = std::move(b);
+    EXPECT_EQ(c.data(), slab);
+    auto d = pool->lease();
+    d.resize(1);
+    EXPECT_EQ(d.data(), other);
+}
+
+TEST(BufferPool, LeaseOutlivesPoolHandle)
+{
+    auto pool = std::make_shared<BufferPool>(1);
+    auto lease = pool->lease();
+    lease.resize(1);
+    pool.reset();
+    lease.data()[0] = 1;
+    EXPECT_EQ(lease.data()[0], 1);
+}
+
+} // namespace
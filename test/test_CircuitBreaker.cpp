@@ -0,0 +1,115 @@
+#include "CircuitBreaker.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Admission = CircuitBreaker::Admission;
+using State = CircuitBreaker::State;
+
+const auto start = CircuitBreaker::Clock::time_point() + 1h;
+
+void failTimes(CircuitBreaker& cb, unsigned times)
+{
+    for (unsigned i = 0; i < times; i++)
+    {
+        cb.failure(start);
+    }
+}
+
+// Check that the breaker opened at start waits between half and the whole
+// backoff, then let the probe through.
+void expectProbeAfter(CircuitBreaker& cb, std::chrono::milliseconds backoff)
+{
+    ASSERT_EQ(cb.state(), State::Open);
+    EXPECT_EQ(cb.admit(start + backoff / 2 - 1ms), Admission::Reject);
+    EXPECT_EQ(cb.state(), State::Open);
+    EXPECT_EQ(cb.admit(start + backoff), Admission::Probe);
+    EXPECT_EQ(cb.state(), State::HalfOpen);
+}
+
+TEST(CircuitBreaker, OpensAfterThreshold)
+{
+    CircuitBreaker cb;
+    failTimes(cb, CircuitBreaker::failureThreshold - 1);
+    EXPECT_EQ(cb.state(), State::Closed);
+    EXPECT_EQ(cb.admit(start), Admission::Pass);
+
+    cb.failure(start);
+    EXPECT_EQ(cb.state(), State::Open);
+    EXPECT_EQ(cb.admit(start), Admission::Reject);
+}
+
+TEST(CircuitBreaker, SuccessResetsFailureCount)
+{
+    CircuitBreaker cb;
+    failTimes(cb, CircuitBreaker::failureThreshold - 1);
+    cb.success();
+    failTimes(cb, CircuitBreaker::failureThreshold - 1);
+    EXPECT_EQ(cb.state(), State::Closed);
+}
+
+TEST(CircuitBreaker, RejectsWhileProbeInFlight)
+{
+    CircuitBreaker cb;
+    failTimes(cb, CircuitBreaker::failureThreshold);
+    expectProbeAfter(cb, CircuitBreaker::initialBackoff);
+    EXPECT_EQ(cb.admit(start + 1h), Admission::Reject);
+}
+
+TEST(CircuitBreaker, SuccessfulProbeCloses)
+{
+    CircuitBreaker cb;
+    failTimes(cb, CircuitBreaker::failureThreshold);
+    expectProbeAfter(cb, CircuitBreaker::initialBackoff);
+    cb.success();
+    EXPECT_EQ(cb.state(), State::Closed);
+    EXPECT_EQ(cb.admit(start), Admission::Pass);
+
+    // the backoff starts over
+    failTimes(cb, CircuitBreaker::failureThreshold);
+    expectProbeAfter(cb, CircuitBreaker::initialBackoff);
+}
+
+TEST(CircuitBreaker, FailedProbeDoublesBackoff)
+{
+    CircuitBreaker cb;
+    failTimes(cb, CircuitBreaker::failureThreshold);
+    auto backoff = CircuitBreaker::initialBackoff;
+    while (backoff < CircuitBreaker::maxBackoff)
+    {
+        expectProbeAfter(cb, backoff);
+        cb.failure(start);
+        backoff = std::min(backoff * 2, CircuitBreaker::maxBackoff);
+    }
+    expectProbeAfter(cb, CircuitBreaker::maxBackoff);
+    cb.failure(start);
+    expectProbeAfter(cb, CircuitBreaker::maxBackoff);
+}
+
+TEST(CircuitBreaker, FailureWhileOpenIsIgnored)
+{
+    CircuitBreaker cb;
+    failTimes(cb, CircuitBreaker::failureThreshold);
+    failTimes(cb, 10);
+    expectProbeAfter(cb, CircuitBreaker::initialBackoff);
+}
+
+TEST(CircuitBreaker, TripOpensClosedBreaker)
+{
+    CircuitBreaker cb;
+    cb.trip(start);
+    expectProbeAfter(cb, CircuitBreaker::initialBackoff);
+
+    // a half-open breaker waits for its probe
+    cb.trip(start);
+    EXPECT_EQ(cb.state(), State::HalfOpen);
+}
+
+} // namespace
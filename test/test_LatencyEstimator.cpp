@@ -0,0 +1,101 @@
+#include "LatencyEstimator.hpp"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+constexpr auto minTimeout = 100ms;
+constexpr auto maxTimeout = 10s;
+
+void recordTimes(LatencyEstimator& est, std::chrono::microseconds sample,
+                 size_t times)
+{
+    for (size_t i = 0; i < times; i++)
+    {
+        est.record(sample);
+    }
+}
+
+TEST(LatencyEstimator, FallbackUntilMinSamples)
+{
+    LatencyEstimator est;
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), 5s);
+    EXPECT_EQ(est.timeout(50ms, minTimeout, maxTimeout), minTimeout);
+    EXPECT_EQ(est.timeout(1min, minTimeout, maxTimeout), maxTimeout);
+
+    recordTimes(est, 1s, LatencyEstimator::minSamples - 1);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), 5s);
+
+    est.record(1s);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), 4s);
+}
+
+TEST(LatencyEstimator, ScalesSteadyLatency)
+{
+    LatencyEstimator est;
+    recordTimes(est, 30ms, LatencyEstimator::minSamples);
+    EXPECT_EQ(est.mean(), 30ms);
+    EXPECT_EQ(est.percentile(), 30ms);
+    // four times the mean beats twice the tail
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), 120ms);
+}
+
+TEST(LatencyEstimator, RoundsUpToMilliseconds)
+{
+    LatencyEstimator est;
+    recordTimes(est, 30100us, LatencyEstimator::minSamples);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), 121ms);
+}
+
+TEST(LatencyEstimator, FollowsTail)
+{
+    LatencyEstimator est;
+    est.record(200ms);
+    recordTimes(est, 1ms, 63);
+    EXPECT_LT(est.mean(), 2ms);
+    EXPECT_EQ(est.percentile(), 200ms);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), 400ms);
+
+    // the outlier leaves the window
+    est.record(1ms);
+    EXPECT_EQ(est.percentile(), 1ms);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), minTimeout);
+}
+
+TEST(LatencyEstimator, TimeoutGrowsAfterTimeout)
+{
+    LatencyEstimator est;
+    recordTimes(est, 50ms, LatencyEstimator::minSamples);
+    auto first = est.timeout(5s, minTimeout, maxTimeout);
+    EXPECT_EQ(first, 200ms);
+
+    // a command timed out, its timeout is the lower bound of its latency
+    est.record(first);
+    auto second = est.timeout(5s, minTimeout, maxTimeout);
+    EXPECT_EQ(second, 400ms);
+
+    est.record(second);
+    EXPECT_GT(est.timeout(5s, minTimeout, maxTimeout), second);
+}
+
+TEST(LatencyEstimator, CappedByCeiling)
+{
+    LatencyEstimator est;
+    recordTimes(est, 1h, LatencyEstimator::minSamples);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), maxTimeout);
+}
+
+TEST(LatencyEstimator, NegativeSampleCountsAsZero)
+{
+    LatencyEstimator est;
+    recordTimes(est, -5ms, LatencyEstimator::minSamples);
+    EXPECT_EQ(est.mean(), 0us);
+    EXPECT_EQ(est.timeout(5s, minTimeout, maxTimeout), minTimeout);
+}
+
+} // namespace
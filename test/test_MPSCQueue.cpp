@@ -0,0 +1,131 @@
+#include "MPSCQueue.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+TEST(MPSCQueue, PopsInPushOrder)
+{
+    MPSCQueue<int, 8> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop());
+
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_TRUE(queue.push(int(i)));
+    }
+    EXPECT_FALSE(queue.empty());
+    for (int i = 0; i < 5; i++)
+    {
+        auto value = queue.pop();
+        ASSERT_TRUE(value);
+        EXPECT_EQ(*value, i);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPSCQueue, RejectsPushWhenFull)
+{
+    MPSCQueue<int, 4> queue;
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(queue.push(int(i)));
+    }
+    EXPECT_FALSE(queue.push(4));
+
+    EXPECT_EQ(queue.pop(), 0);
+    EXPECT_TRUE(queue.push(4));
+    for (int i = 1; i <= 4; i++)
+    {
+        EXPECT_EQ(queue.pop(), i);
+    }
+}
+
+TEST(MPSCQueue, KeepsRejectedValue)
+{
+    MPSCQueue<std::unique_ptr<int>, 2> queue;
+    EXPECT_TRUE(queue.push(std::make_unique<int>(0)));
+    EXPECT_TRUE(queue.push(std::make_unique<int>(1)));
+
+    auto value = std::make_unique<int>(2);
+    EXPECT_FALSE(queue.push(std::move(value)));
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, 2);
+}
+
+TEST(MPSCQueue, WrapsAround)
+{
+    MPSCQueue<int, 4> queue;
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_TRUE(queue.push(int(i)));
+        EXPECT_TRUE(queue.push(i + 1000));
+        EXPECT_EQ(queue.pop(), i);
+        EXPECT_EQ(queue.pop(), i + 1000);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPSCQueue, DestroysQueuedValues)
+{
+    auto value = std::make_shared<int>(0);
+    {
+        MPSCQueue<std::shared_ptr<int>, 4> queue;
+        EXPECT_TRUE(queue.push(std::shared_ptr<int>(value)));
+        EXPECT_TRUE(queue.push(std::shared_ptr<int>(value)));
+        EXPECT_EQ(value.use_count(), 3);
+
+        queue.pop();
+        EXPECT_EQ(value.use_count(), 2);
+    }
+    EXPECT_EQ(value.use_count(), 1);
+}
+
+TEST(MPSCQueue, ConcurrentProducers)
+{
+    constexpr int producers = 4;
+    constexpr int perProducer = 20000;
+    MPSCQueue<std::pair<int, int>, 64> queue;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&queue, p] {
+            for (int i = 0; i < perProducer; i++)
+            {
+                while (!queue.push({p, i}))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // every value arrives once, and in order per producer
+    std::vector<int> next(producers, 0);
+    for (int received = 0; received < producers * perProducer;)
+    {
+        auto value = queue.pop();
+        if (!value)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        auto [p, i] = *value;
+        EXPECT_EQ(i, next[p]);
+        next[p] = i + 1;
+        received++;
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+} // namespace
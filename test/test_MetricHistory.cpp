@@ -0,0 +1,248 @@
+#include "MetricHistory.hpp"
+
+#include <unistd.h>
+
+#include <boost/endian/conversion.hpp>
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using Sample = MetricHistory::Sample;
+using Tier = MetricHistory::Tier;
+using Metric = DriveHistory::Metric;
+
+std::vector<Sample> unpack(const std::vector<uint8_t>& packed)
+{
+    EXPECT_EQ(packed.size() % MetricHistory::packedSize, 0U);
+    std::vector<Sample> samples;
+    for (size_t i = 0; i + MetricHistory::packedSize <= packed.size();
+         i += MetricHistory::packedSize)
+    {
+        uint32_t fields[4];
+        std::memcpy(fields, packed.data() + i, sizeof(fields));
+        for (auto& field : fields)
+        {
+            field = boost::endian::little_to_native(field);
+        }
+        samples.push_back({fields[0], std::bit_cast<float>(fields[1]),
+                           std::bit_cast<float>(fields[2]),
+                           std::bit_cast<float>(fields[3])});
+    }
+    return samples;
+}
+
+void expectSample(const Sample& sample, uint32_t time, float min, float max,
+                  float mean)
+{
+    EXPECT_EQ(sample.time, time);
+    EXPECT_FLOAT_EQ(sample.min, min);
+    EXPECT_FLOAT_EQ(sample.max, max);
+    EXPECT_FLOAT_EQ(sample.mean, mean);
+}
+
+TEST(MetricHistory, PacksLittleEndian)
+{
+    MetricHistory history;
+    history.add(0x01020304, 1.5F);
+    // 1.5 is 0x3fc00000
+    const std::vector<uint8_t> expected{0x04, 0x03, 0x02, 0x01, 0x00, 0x00,
+                                        0xc0, 0x3f, 0x00, 0x00, 0xc0, 0x3f,
+                                        0x00, 0x00, 0xc0, 0x3f};
+    EXPECT_EQ(history.query(Tier::Raw), expected);
+}
+
+TEST(MetricHistory, RawKeepsLatestSamples)
+{
+    MetricHistory history;
+    constexpr uint32_t total = MetricHistory::rawCapacity + 72;
+    for (uint32_t t = 0; t < total; t++)
+    {
+        history.add(t, static_cast<float>(t));
+    }
+    auto raw = unpack(history.query(Tier::Raw));
+    ASSERT_EQ(raw.size(), MetricHistory::rawCapacity);
+    expectSample(raw.front(), 72, 72, 72, 72);
+    expectSample(raw.back(), total - 1, total - 1, total - 1, total - 1);
+}
+
+TEST(MetricHistory, DownsamplesByMinute)
+{
+    MetricHistory history;
+    EXPECT_TRUE(history.query(Tier::Minute).empty());
+
+    // a sample a second from 1:00 to 1:59, then one at 2:00
+    for (uint32_t t = 60; t < 120; t++)
+    {
+        history.add(t, static_cast<float>(t - 60));
+    }
+    history.add(120, 100);
+
+    auto minute = unpack(history.query(Tier::Minute));
+    ASSERT_EQ(minute.size(), 2U);
+    expectSample(minute[0], 60, 0, 59, 29.5F);
+    // the minute being aggregated
+    expectSample(minute[1], 120, 100, 100, 100);
+}
+
+TEST(MetricHistory, DownsamplesByHour)
+{
+    MetricHistory history;
+    // a sample a minute for two hours and two minutes
+    for (uint32_t m = 0; m < 122; m++)
+    {
+        history.add(m * 60, static_cast<float>(m));
+    }
+
+    auto hour = unpack(history.query(Tier::Hour));
+    ASSERT_EQ(hour.size(), 3U);
+    expectSample(hour[0], 0, 0, 59, 29.5F);
+    expectSample(hour[1], 3600, 60, 119, 89.5F);
+    // the hour being aggregated holds the completed minutes only
+    expectSample(hour[2], 7200, 120, 120, 120);
+
+    EXPECT_EQ(unpack(history.query(Tier::Minute)).size(), 122U);
+}
+
+TEST(MetricHistory, MinuteTierWraps)
+{
+    auto history = std::make_unique<MetricHistory>();
+    constexpr uint32_t minutes = MetricHistory::minuteCapacity + 10;
+    for (uint32_t m = 0; m <= minutes; m++)
+    {
+        history->add(m * 60, static_cast<float>(m));
+    }
+    auto minute = unpack(history->query(Tier::Minute));
+    // the ring and the minute being aggregated
+    ASSERT_EQ(minute.size(), MetricHistory::minuteCapacity + 1);
+    EXPECT_EQ(minute.front().time, 10 * 60);
+    EXPECT_EQ(minute.back().time, minutes * 60);
+}
+
+TEST(MetricHistory, SaveLoadRoundTrip)
+{
+    auto history = std::make_unique<MetricHistory>();
+    for (uint32_t t = 0; t < 5000; t += 7)
+    {
+        history->add(t, static_cast<float>(t % 50));
+    }
+    std::stringstream ss;
+    history->save(ss);
+
+    auto loaded = std::make_unique<MetricHistory>();
+    ASSERT_TRUE(loaded->load(ss));
+    for (auto tier : {Tier::Raw, Tier::Minute, Tier::Hour})
+    {
+        EXPECT_EQ(loaded->query(tier), history->query(tier));
+    }
+}
+
+TEST(MetricHistory, LoadRejectsCorruptSnapshot)
+{
+    auto history = std::make_unique<MetricHistory>();
+    history->add(1, 1);
+    std::stringstream ss;
+    history->save(ss);
+    std::string snapshot = ss.str();
+
+    std::istringstream truncated(snapshot.substr(0, snapshot.size() - 1));
+    EXPECT_FALSE(MetricHistory().load(truncated));
+
+    // the head of the raw ring follows its samples
+    std::string badHead = snapshot;
+    size_t head = MetricHistory::rawCapacity + 1;
+    std::memcpy(badHead.data() + MetricHistory::rawCapacity * sizeof(Sample),
+                &head, sizeof(head));
+    std::istringstream is(badHead);
+    EXPECT_FALSE(MetricHistory().load(is));
+}
+
+TEST(DriveHistory, ParsesNames)
+{
+    EXPECT_EQ(DriveHistory::metricFromString("Temperature"),
+              Metric::Temperature);
+    EXPECT_EQ(DriveHistory::metricFromString("LifeUsed"), Metric::LifeUsed);
+    EXPECT_EQ(DriveHistory::metricFromString("AvailableSpare"),
+              Metric::AvailableSpare);
+    EXPECT_EQ(DriveHistory::metricFromString("MediaErrors"),
+              Metric::MediaErrors);
+    EXPECT_EQ(DriveHistory::metricFromString("ErrorLogEntries"),
+              Metric::ErrorLogEntries);
+    EXPECT_FALSE(DriveHistory::metricFromString("temperature"));
+
+    EXPECT_EQ(DriveHistory::tierFromString("Raw"), Tier::Raw);
+    EXPECT_EQ(DriveHistory::tierFromString("Minute"), Tier::Minute);
+    EXPECT_EQ(DriveHistory::tierFromString("Hour"), Tier::Hour);
+    EXPECT_FALSE(DriveHistory::tierFromString("Day"));
+}
+
+class DriveHistoryTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        dir = std::filesystem::temp_directory_path() /
+              ("drive-history-" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir);
+        file = (dir / "nvme0").string();
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(dir);
+    }
+
+    std::filesystem::path dir;
+    std::string file;
+};
+
+TEST_F(DriveHistoryTest, RestoresSameDrive)
+{
+    auto saved = std::make_unique<DriveHistory>(file);
+    saved->load("SN1");
+    saved->add(Metric::Temperature, 40);
+    saved->save();
+    ASSERT_TRUE(std::filesystem::exists(file));
+
+    auto restored = std::make_unique<DriveHistory>(file);
+    restored->load("SN1");
+    auto raw = unpack(restored->query(Metric::Temperature, Tier::Raw));
+    ASSERT_EQ(raw.size(), 1U);
+    EXPECT_FLOAT_EQ(raw[0].mean, 40);
+    EXPECT_TRUE(restored->query(Metric::LifeUsed, Tier::Raw).empty());
+}
+
+TEST_F(DriveHistoryTest, IgnoresOtherDrive)
+{
+    auto saved = std::make_unique<DriveHistory>(file);
+    saved->load("SN1");
+    saved->add(Metric::Temperature, 40);
+    saved->save();
+
+    auto other = std::make_unique<DriveHistory>(file);
+    other->load("SN2");
+    EXPECT_TRUE(other->query(Metric::Temperature, Tier::Raw).empty());
+
+    // another drive in the slot starts over
+    saved->load("SN2");
+    EXPECT_TRUE(saved->query(Metric::Temperature, Tier::Raw).empty());
+}
+
+TEST_F(DriveHistoryTest, SavesOnlyIdentifiedDrive)
+{
+    auto history = std::make_unique<DriveHistory>(file);
+    history->add(Metric::Temperature, 40);
+    history->save();
+    EXPECT_FALSE(std::filesystem::exists(file));
+}
+
+} // namespace
@@ -0,0 +1,195 @@
+#include "EndpointFixture.hpp"
+#include "NVMeMi.hpp"
+
+#include <chrono>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// the endpoints on an i2c bus unknown to sysfs get a worker per bus number
+constexpr int slowBus = 1001;
+constexpr int fastBus = 1002;
+
+constexpr uint8_t slowEid = 10;
+constexpr uint8_t fastEid = 11;
+
+constexpr int fastPolls = 20;
+constexpr int slowPolls = 4;
+
+class NVMeMiTest : public EndpointFixture
+{
+  protected:
+    // Poll fast fastPolls times in a row while slow has a single poll
+    // outstanding, and return how many of the fast polls completed before
+    // the slow one.
+    int pollBoth(NVMeMi& slow, NVMeMi& fast)
+    {
+        bool slowDone = false;
+        int fastDone = 0;
+        int fastBeforeSlow = -1;
+
+        slow.miSubsystemHealthStatusPoll(
+            [&](const std::error_code& ec, nvme_mi_nvm_ss_health_status* ss) {
+            EXPECT_FALSE(ec) << ec.message();
+            ASSERT_NE(ss, nullptr);
+            EXPECT_EQ(ss->ctemp, FakeMctpDemux::temperature);
+            slowDone = true;
+            fastBeforeSlow = fastDone;
+        });
+        pollFast(fast, fastDone);
+
+        EXPECT_TRUE(runUntil([&] {
+            return slowDone && fastDone == fastPolls;
+        }));
+        return fastBeforeSlow;
+    }
+
+    void pollFast(NVMeMi& fast, int& done)
+    {
+        fast.miSubsystemHealthStatusPoll(
+            [this, &fast, &done](const std::error_code& ec,
+                                 nvme_mi_nvm_ss_health_status*) {
+            EXPECT_FALSE(ec) << ec.message();
+            if (++done < fastPolls)
+            {
+                pollFast(fast, done);
+            }
+        });
+    }
+};
+
+TEST_F(NVMeMiTest, SlowDriveDoesNotStallAnotherBus)
+{
+    demux.setLatency(slowEid, 300ms);
+    demux.setLatency(fastEid, 1ms);
+    auto slow = std::make_shared<NVMeMi>(io, conn, *objServer, slowBus,
+                                         demux.sockName(), slowEid);
+    auto fast = std::make_shared<NVMeMi>(io, conn, *objServer, fastBus,
+                                         demux.sockName(), fastEid);
+
+    EXPECT_EQ(pollBoth(*slow, *fast), fastPolls);
+}
+
+TEST_F(NVMeMiTest, DrivesOnOneBusShareItsWorker)
+{
+    // the slow command holds the bus, the fast drive waits for it
+    demux.setLatency(slowEid, 300ms);
+    demux.setLatency(fastEid, 1ms);
+    auto slow = std::make_shared<NVMeMi>(io, conn, *objServer, slowBus,
+                                         demux.sockName(), slowEid);
+    auto fast = std::make_shared<NVMeMi>(io, conn, *objServer, slowBus,
+                                         demux.sockName(), fastEid);
+
+    EXPECT_EQ(pollBoth(*slow, *fast), 0);
+}
+
+TEST_F(NVMeMiTest, FastDriveGetsItsShareOfBusyBus)
+{
+    // every slow command costs the slow drive the credit of several rounds,
+    // in which the fast drive runs its commands
+    demux.setLatency(slowEid, 300ms);
+    demux.setLatency(fastEid, 1ms);
+    auto slow = std::make_shared<NVMeMi>(io, conn, *objServer, slowBus,
+                                         demux.sockName(), slowEid);
+    auto fast = std::make_shared<NVMeMi>(io, conn, *objServer, slowBus,
+                                         demux.sockName(), fastEid);
+
+    int slowDone = 0;
+    int fastDone = 0;
+    int slowBeforeFast = -1;
+    for (int i = 0; i < slowPolls; i++)
+    {
+        slow->miSubsystemHealthStatusPoll(
+            [&](const std::error_code& ec, nvme_mi_nvm_ss_health_status*) {
+            EXPECT_FALSE(ec) << ec.message();
+            slowDone++;
+        });
+    }
+    for (int i = 0; i < fastPolls; i++)
+    {
+        fast->miSubsystemHealthStatusPoll(
+            [&](const std::error_code& ec, nvme_mi_nvm_ss_health_status*) {
+            EXPECT_FALSE(ec) << ec.message();
+            if (++fastDone == fastPolls)
+            {
+                slowBeforeFast = slowDone;
+            }
+        });
+    }
+
+    ASSERT_TRUE(runUntil([&] {
+        return slowDone == slowPolls && fastDone == fastPolls;
+    }));
+    // the fast drive waits for the slow command on the bus at most
+    EXPECT_LE(slowBeforeFast, 1);
+}
+
+TEST_F(NVMeMiTest, CoalescesIdenticalReads)
+{
+    demux.setLatency(fastEid, 100ms);
+    auto ep = std::make_shared<NVMeMi>(io, conn, *objServer, fastBus,
+                                       demux.sockName(), fastEid);
+    std::vector<nvme_mi_ctrl_t> ctrls;
+    bool scanned = false;
+    ep->miScanCtrl([&](const std::error_code& ec,
+                       const std::vector<nvme_mi_ctrl_t>& list) {
+        EXPECT_FALSE(ec) << ec.message();
+        ctrls = list;
+        scanned = true;
+    });
+    ASSERT_TRUE(runUntil([&] { return scanned; }));
+    ASSERT_FALSE(ctrls.empty());
+    unsigned before = demux.requests(fastEid);
+
+    // the second read is issued while the first one is in flight
+    int done = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        ep->adminIdentify(ctrls.front(), NVME_IDENTIFY_CNS_CTRL, 0, 0, 16,
+                          [&](const std::error_code& ec,
+                              std::span<uint8_t> data) {
+            EXPECT_FALSE(ec) << ec.message();
+            EXPECT_EQ(data.size(), 16U);
+            done++;
+        });
+    }
+    ASSERT_TRUE(runUntil([&] { return done == 2; }));
+    EXPECT_EQ(demux.requests(fastEid) - before, 1U);
+
+    // a read issued after the completion goes to the drive again
+    done = 0;
+    ep->adminIdentify(ctrls.front(), NVME_IDENTIFY_CNS_CTRL, 0, 0, 16,
+                      [&](const std::error_code& ec, std::span<uint8_t>) {
+        EXPECT_FALSE(ec) << ec.message();
+        done++;
+    });
+    ASSERT_TRUE(runUntil([&] { return done == 1; }));
+    EXPECT_EQ(demux.requests(fastEid) - before, 2U);
+}
+
+TEST_F(NVMeMiTest, EndpointDroppedWithCommandInFlight)
+{
+    // the command in flight holds the last reference to the endpoint, which
+    // takes its worker with it
+    demux.setLatency(slowEid, 100ms);
+    auto ep = std::make_shared<NVMeMi>(io, conn, *objServer, slowBus,
+                                       demux.sockName(), slowEid);
+    bool done = false;
+    ep->miSubsystemHealthStatusPoll(
+        [&done](const std::error_code&, nvme_mi_nvm_ss_health_status*) {
+        done = true;
+    });
+    ep.reset();
+
+    EXPECT_TRUE(runUntil([&] { return done; }));
+    EXPECT_TRUE(runUntil([] { return !NVMeMi::hasWorkers(); }));
+}
+
+} // namespace
@@ -0,0 +1,99 @@
+#include "NVMeMiMessage.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+constexpr uint8_t rorResponse = 1 << 7;
+
+// a health status poll response in a command slot, MIC included
+std::array<uint8_t, sizeof(nvme_mi_mi_resp_hdr) + mi::micSize>
+    response(nvme_mi_message_type nmimt, uint8_t slot)
+{
+    nvme_mi_msg_hdr hdr{};
+    mi::setRequestHeader(hdr, nmimt, slot);
+    hdr.nmp |= rorResponse;
+    std::array<uint8_t, sizeof(nvme_mi_mi_resp_hdr) + mi::micSize> msg{};
+    std::memcpy(msg.data(), &hdr, sizeof(hdr));
+    mi::seal(msg);
+    return msg;
+}
+
+TEST(NVMeMiMessage, Crc32cCheckValue)
+{
+    constexpr std::string_view check = "123456789";
+    EXPECT_EQ(mi::crc32c({reinterpret_cast<const uint8_t*>(check.data()),
+                          check.size()}),
+              0xe3069283U);
+    EXPECT_EQ(mi::crc32c({}), 0U);
+}
+
+TEST(NVMeMiMessage, SealStoresLittleEndianMic)
+{
+    std::array<uint8_t, 13> msg{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    mi::seal(msg);
+    EXPECT_EQ(msg[9], 0x83);
+    EXPECT_EQ(msg[10], 0x92);
+    EXPECT_EQ(msg[11], 0x06);
+    EXPECT_EQ(msg[12], 0xe3);
+}
+
+TEST(NVMeMiMessage, RequestHeader)
+{
+    nvme_mi_msg_hdr hdr{};
+    mi::setRequestHeader(hdr, NVME_MI_MT_ADMIN, 1);
+    EXPECT_EQ(hdr.type, mi::messageType);
+    EXPECT_EQ(hdr.nmp, NVME_MI_MT_ADMIN << 3 | 1);
+    EXPECT_EQ(hdr.meb, 0);
+}
+
+TEST(NVMeMiMessage, MatchesResponse)
+{
+    auto msg = response(NVME_MI_MT_MI, 1);
+    EXPECT_TRUE(mi::isResponse(msg, NVME_MI_MT_MI, 1));
+    // another command slot or message type
+    EXPECT_FALSE(mi::isResponse(msg, NVME_MI_MT_MI, 0));
+    EXPECT_FALSE(mi::isResponse(msg, NVME_MI_MT_ADMIN, 1));
+}
+
+TEST(NVMeMiMessage, RejectsRequest)
+{
+    auto msg = response(NVME_MI_MT_MI, 0);
+    msg[1] &= ~rorResponse;
+    mi::seal(msg);
+    EXPECT_FALSE(mi::isResponse(msg, NVME_MI_MT_MI, 0));
+}
+
+TEST(NVMeMiMessage, RejectsCorruptMessage)
+{
+    auto msg = response(NVME_MI_MT_MI, 0);
+    msg[4] ^= 1;
+    EXPECT_FALSE(mi::isResponse(msg, NVME_MI_MT_MI, 0));
+
+    std::array<uint8_t, mi::micSize> tooShort{};
+    EXPECT_FALSE(mi::isResponse(tooShort, NVME_MI_MT_MI, 0));
+}
+
+TEST(NVMeMiMessage, AdminStatus)
+{
+    nvme_mi_admin_resp_hdr resp{};
+    EXPECT_EQ(mi::adminStatus(resp), 0);
+
+    // invalid field in command, in bits 31:17 of dword 3
+    resp.cdw3 = 0x0002U << 17;
+    EXPECT_EQ(mi::adminStatus(resp), 0x0002);
+
+    // the MI status takes precedence
+    resp.status = NVME_MI_RESP_INVALID_PARAM;
+    EXPECT_EQ(mi::adminStatus(resp),
+              NVME_MI_RESP_INVALID_PARAM |
+                  NVME_STATUS_TYPE_MI << NVME_STATUS_TYPE_SHIFT);
+}
+
+} // namespace
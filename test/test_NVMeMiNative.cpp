@@ -0,0 +1,216 @@
+#include "EndpointFixture.hpp"
+#include "NVMeMiNative.hpp"
+
+#include <boost/endian.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+constexpr int bus = 1003;
+constexpr uint8_t eid = 12;
+
+class NVMeMiNativeTest : public EndpointFixture
+{
+  protected:
+    void SetUp() override
+    {
+        EndpointFixture::SetUp();
+        if (IsSkipped())
+        {
+            return;
+        }
+        demux.setLatency(eid, 1ms);
+        ep = std::make_shared<NVMeMiNative>(io, conn, *objServer, bus,
+                                            demux.sockName(), eid);
+    }
+
+    nvme_mi_ctrl_t scan()
+    {
+        std::vector<nvme_mi_ctrl_t> ctrls;
+        bool done = false;
+        ep->miScanCtrl([&](const std::error_code& ec,
+                           const std::vector<nvme_mi_ctrl_t>& list) {
+            EXPECT_FALSE(ec) << ec.message();
+            ctrls = list;
+            done = true;
+        });
+        EXPECT_TRUE(runUntil([&] { return done; }));
+        return ctrls.empty() ? nullptr : ctrls.front();
+    }
+
+    // an identify admin command of length bytes
+    static nvme_mi_admin_req_hdr identifyHeader(uint32_t length)
+    {
+        nvme_mi_admin_req_hdr hdr{};
+        hdr.opcode = nvme_admin_identify;
+        hdr.dlen = boost::endian::native_to_little(length);
+        hdr.cdw10 = boost::endian::native_to_little(
+            static_cast<uint32_t>(NVME_IDENTIFY_CNS_CTRL));
+        return hdr;
+    }
+
+    std::shared_ptr<NVMeMiNative> ep;
+};
+
+TEST_F(NVMeMiNativeTest, HealthStatusPoll)
+{
+    std::optional<uint8_t> ctemp;
+    ep->miSubsystemHealthStatusPoll(
+        [&](const std::error_code& ec, nvme_mi_nvm_ss_health_status* ss) {
+        ASSERT_FALSE(ec) << ec.message();
+        ASSERT_NE(ss, nullptr);
+        ctemp = ss->ctemp;
+    });
+    ASSERT_TRUE(runUntil([&] { return ctemp.has_value(); }));
+    EXPECT_EQ(*ctemp, FakeMctpDemux::temperature);
+    EXPECT_EQ(demux.requests(eid), 1U);
+}
+
+TEST_F(NVMeMiNativeTest, ScansControllers)
+{
+    std::vector<nvme_mi_ctrl_t> first;
+    std::vector<nvme_mi_ctrl_t> second;
+    ep->miScanCtrl([&](const std::error_code& ec,
+                       const std::vector<nvme_mi_ctrl_t>& list) {
+        EXPECT_FALSE(ec) << ec.message();
+        first = list;
+    });
+    ep->miScanCtrl([&](const std::error_code& ec,
+                       const std::vector<nvme_mi_ctrl_t>& list) {
+        EXPECT_FALSE(ec) << ec.message();
+        second = list;
+    });
+    ASSERT_TRUE(runUntil([&] { return !second.empty(); }));
+    ASSERT_EQ(first.size(), 2U);
+    // the handles of an earlier scan stay valid
+    EXPECT_EQ(second, first);
+}
+
+TEST_F(NVMeMiNativeTest, SplitsLongGetLog)
+{
+    nvme_mi_ctrl_t ctrl = scan();
+    ASSERT_NE(ctrl, nullptr);
+    unsigned before = demux.requests(eid);
+
+    constexpr uint32_t offset = 8;
+    constexpr uint32_t length = 10000;
+    std::vector<uint8_t> log;
+    bool done = false;
+    ep->adminGetLog(ctrl, NVME_LOG_LID_TELEMETRY_CTRL, NVME_NSID_ALL, 0, 0,
+                    offset, length,
+                    [&](const std::error_code& ec, std::span<uint8_t> data) {
+        EXPECT_FALSE(ec) << ec.message();
+        log.assign(data.begin(), data.end());
+        done = true;
+    });
+    ASSERT_TRUE(runUntil([&] { return done; }));
+
+    // three transfers of up to mi::maxTransfer bytes
+    EXPECT_EQ(demux.requests(eid) - before, 3U);
+    ASSERT_EQ(log.size(), length);
+    for (uint32_t i = 0; i < length; i++)
+    {
+        ASSERT_EQ(log[i], FakeMctpDemux::pattern(offset + i)) << "at " << i;
+    }
+}
+
+TEST_F(NVMeMiNativeTest, RejectsOversizeTransfer)
+{
+    nvme_mi_ctrl_t ctrl = scan();
+    ASSERT_NE(ctrl, nullptr);
+    unsigned before = demux.requests(eid);
+
+    std::optional<std::error_code> result;
+    ep->adminXfer(ctrl, identifyHeader(mi::maxTransfer + 1), {}, 0,
+                  [&](const std::error_code& ec,
+                      const nvme_mi_admin_resp_hdr&,
+                      std::span<uint8_t>) { result = ec; });
+    ASSERT_TRUE(runUntil([&] { return result.has_value(); }));
+    EXPECT_EQ(*result, std::errc::message_size);
+    EXPECT_EQ(demux.requests(eid), before);
+}
+
+TEST_F(NVMeMiNativeTest, RejectsBatchCommandTooShort)
+{
+    // no room for the health status
+    auto poll = NVMeMiIntf::BatchCommand::healthStatusPoll();
+    poll.length = 4;
+    const std::array cmds{NVMeMiIntf::BatchCommand::healthStatusPoll(), poll};
+
+    std::optional<std::error_code> result;
+    ep->submitBatch(cmds, [&](const std::error_code& ec,
+                              std::span<const NVMeMiIntf::BatchResult>) {
+        result = ec;
+    });
+    ASSERT_TRUE(runUntil([&] { return result.has_value(); }));
+    EXPECT_EQ(*result, std::errc::invalid_argument);
+    EXPECT_EQ(demux.requests(eid), 0U);
+}
+
+TEST_F(NVMeMiNativeTest, DropsCancelledCommand)
+{
+    auto token = std::make_shared<NVMeMiIntf::CancelToken>();
+    token->cancel();
+    NVMeMiIntf::CommandOptions opts;
+    opts.cancel = token;
+
+    std::optional<std::error_code> result;
+    ep->miSubsystemHealthStatusPoll(
+        [&](const std::error_code& ec, nvme_mi_nvm_ss_health_status*) {
+        result = ec;
+    }, opts);
+    ASSERT_TRUE(runUntil([&] { return result.has_value(); }));
+    EXPECT_EQ(*result, std::errc::operation_canceled);
+    EXPECT_EQ(demux.requests(eid), 0U);
+}
+
+TEST_F(NVMeMiNativeTest, IgnoresLateResponse)
+{
+    nvme_mi_ctrl_t ctrl = scan();
+    ASSERT_NE(ctrl, nullptr);
+
+    // the response arrives after the timeout, with other data than the
+    // response to the next command
+    demux.setLatency(eid, 150ms);
+    nvme_mi_admin_req_hdr getLog{};
+    getLog.opcode = nvme_admin_get_log_page;
+    getLog.dlen = boost::endian::native_to_little(16U);
+    getLog.cdw12 = boost::endian::native_to_little(100U);
+    std::optional<std::error_code> timedOut;
+    ep->adminXfer(ctrl, getLog, {}, 50,
+                  [&](const std::error_code& ec,
+                      const nvme_mi_admin_resp_hdr&,
+                      std::span<uint8_t>) { timedOut = ec; });
+    ASSERT_TRUE(runUntil([&] { return timedOut.has_value(); }));
+    EXPECT_EQ(*timedOut, std::errc::timed_out);
+
+    // the late response comes in while the next command is in flight, in
+    // the other command slot
+    demux.setLatency(eid, 300ms);
+    std::vector<uint8_t> data;
+    bool done = false;
+    ep->adminIdentify(ctrl, NVME_IDENTIFY_CNS_CTRL, 0, 0, 16,
+                      [&](const std::error_code& ec, std::span<uint8_t> id) {
+        EXPECT_FALSE(ec) << ec.message();
+        data.assign(id.begin(), id.end());
+        done = true;
+    });
+    ASSERT_TRUE(runUntil([&] { return done; }));
+    ASSERT_EQ(data.size(), 16U);
+    for (uint32_t i = 0; i < data.size(); i++)
+    {
+        EXPECT_EQ(data[i], FakeMctpDemux::pattern(i)) << "at " << i;
+    }
+}
+
+} // namespace
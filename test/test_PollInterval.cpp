@@ -0,0 +1,61 @@
+#include "PollInterval.hpp"
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+TEST(PollInterval, StartsAtMin)
+{
+    PollInterval poll(1s, 60s);
+    EXPECT_EQ(poll.current(), 1s);
+}
+
+TEST(PollInterval, DoublesUpToMax)
+{
+    PollInterval poll(1s, 60s);
+    EXPECT_EQ(poll.next(false), 2s);
+    EXPECT_EQ(poll.next(false), 4s);
+    EXPECT_EQ(poll.next(false), 8s);
+    EXPECT_EQ(poll.next(false), 16s);
+    EXPECT_EQ(poll.next(false), 32s);
+    EXPECT_EQ(poll.next(false), 60s);
+    EXPECT_EQ(poll.next(false), 60s);
+    EXPECT_EQ(poll.current(), 60s);
+}
+
+TEST(PollInterval, UrgentFallsBackToMin)
+{
+    PollInterval poll(1s, 60s);
+    for (int i = 0; i < 10; i++)
+    {
+        poll.next(false);
+    }
+    EXPECT_EQ(poll.next(true), 1s);
+    EXPECT_EQ(poll.next(true), 1s);
+    EXPECT_EQ(poll.next(false), 2s);
+}
+
+TEST(PollInterval, Reset)
+{
+    PollInterval poll(5s, 60s);
+    poll.next(false);
+    poll.next(false);
+    poll.reset();
+    EXPECT_EQ(poll.current(), 5s);
+    EXPECT_EQ(poll.next(false), 10s);
+}
+
+TEST(PollInterval, MaxBelowMinIsMin)
+{
+    PollInterval poll(10s, 5s);
+    EXPECT_EQ(poll.current(), 10s);
+    EXPECT_EQ(poll.next(false), 10s);
+    EXPECT_EQ(poll.next(true), 10s);
+}
+
+} // namespace
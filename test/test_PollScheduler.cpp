@@ -0,0 +1,136 @@
+#include "PollScheduler.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+using Clock = PollScheduler::Clock;
+using Slot = PollScheduler::Slot;
+
+// The scheduler publishes on D-Bus, so the tests are skipped where no bus can
+// be connected to.
+class PollSchedulerTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        try
+        {
+            conn = std::make_shared<sdbusplus::asio::connection>(io);
+        }
+        catch (const std::exception& e)
+        {
+            GTEST_SKIP() << "no D-Bus connection: " << e.what();
+        }
+        objServer =
+            std::make_unique<sdbusplus::asio::object_server>(conn, true);
+    }
+
+    std::unique_ptr<PollScheduler> make(std::chrono::seconds period)
+    {
+        return std::make_unique<PollScheduler>(
+            *objServer, "/xyz/openbmc_project/test/poll_scheduler", period);
+    }
+
+    boost::asio::io_context io;
+    std::shared_ptr<sdbusplus::asio::connection> conn;
+    std::unique_ptr<sdbusplus::asio::object_server> objServer;
+};
+
+// Check that the poll is at the grid point, up to a quarter of the spacing
+// of n slots across the period later.
+void expectAt(Clock::time_point poll, Clock::time_point grid,
+              Clock::duration period, unsigned n)
+{
+    EXPECT_GE(poll, grid);
+    EXPECT_LE(poll, grid + period / n / 4);
+}
+
+TEST_F(PollSchedulerTest, SpacesPhasesEvenly)
+{
+    auto scheduler = make(4s);
+    auto start = scheduler->start();
+    std::vector<std::unique_ptr<Slot>> slots;
+    for (int i = 0; i < 4; i++)
+    {
+        slots.push_back(scheduler->join());
+    }
+    for (unsigned i = 0; i < slots.size(); i++)
+    {
+        expectAt(slots[i]->next(1s, start), start + i * 1s, 4s, 4);
+    }
+
+    // the remaining slots spread over the period again
+    slots.pop_back();
+    for (unsigned i = 0; i < slots.size(); i++)
+    {
+        expectAt(slots[i]->next(1s, start + 4s),
+                 start + 4s + Clock::duration(4s) * i / 3, 4s, 3);
+    }
+}
+
+TEST_F(PollSchedulerTest, WaitsAtLeastInterval)
+{
+    auto scheduler = make(4s);
+    auto start = scheduler->start();
+    auto slot = scheduler->join();
+    expectAt(slot->next(10s, start), start, 4s, 1);
+
+    // the first grid point at least the interval after the previous poll
+    expectAt(slot->next(10s, start + 1s), start + 12s, 4s, 1);
+    // the next grid point for an interval shorter than the period
+    expectAt(slot->next(1s, start + 12s), start + 16s, 4s, 1);
+    // no earlier than now after an overrun
+    expectAt(slot->next(1s, start + 21s), start + 24s, 4s, 1);
+}
+
+TEST_F(PollSchedulerTest, PeriodAtLeastOneSecond)
+{
+    auto scheduler = make(0s);
+    auto start = scheduler->start();
+    auto slot = scheduler->join();
+    expectAt(slot->next(0s, start), start, 1s, 1);
+    expectAt(slot->next(0s, start + 500ms), start + 1s, 1s, 1);
+}
+
+TEST_F(PollSchedulerTest, PublishesCompletionOfPreviousPeriod)
+{
+    auto scheduler = make(4s);
+    auto start = scheduler->start();
+    auto a = scheduler->join();
+    auto b = scheduler->join();
+
+    // period 0, with b straggling into period 1
+    a->next(1s, start);
+    a->done(start + 1s);
+    b->next(1s, start);
+    a->next(1s, start + 1s);
+    a->done(start + 4500ms);
+    b->done(start + 4800ms);
+    EXPECT_EQ(scheduler->cycleCompletionTime(), 0s);
+
+    // period 2 under way, so period 0 is complete, straggler included
+    a->next(1s, start + 4500ms);
+    a->done(start + 8200ms);
+    EXPECT_EQ(scheduler->cycleCompletionTime(), 4800ms);
+
+    // periods 3 and 4 skipped, so period 1 is published late and then
+    // period 2 at once
+    a->next(10s, start + 8200ms);
+    a->done(start + 20100ms);
+    EXPECT_EQ(scheduler->cycleCompletionTime(), 200ms);
+}
+
+} // namespace
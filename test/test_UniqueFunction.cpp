@@ -0,0 +1,138 @@
+#include "AllocationCounter.hpp"
+#include "UniqueFunction.hpp"
+
+#include <array>
+#include <functional>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+using Callback = UniqueFunction<int(int), 32>;
+
+// a callable too large for the small buffer
+struct Large
+{
+    std::array<char, 64> pad{};
+    int operator()(int v) const
+    {
+        return v + 1;
+    }
+};
+
+// a callable which isn't nothrow movable is kept on the heap
+struct ThrowingMove
+{
+    ThrowingMove() = default;
+    ThrowingMove(const ThrowingMove&) = default;
+    ThrowingMove(ThrowingMove&&) noexcept(false) {}
+    int operator()(int v) const
+    {
+        return v + 2;
+    }
+};
+
+TEST(UniqueFunction, EmptyThrows)
+{
+    Callback f;
+    EXPECT_FALSE(f);
+    EXPECT_THROW(f(0), std::bad_function_call);
+
+    Callback g(nullptr);
+    EXPECT_FALSE(g);
+}
+
+TEST(UniqueFunction, SmallCallableDoesNotAllocate)
+{
+    size_t before = allocationCount();
+    int base = 10;
+    Callback f([base](int v) { return base + v; });
+    Callback g(std::move(f));
+    Callback h;
+    h = std::move(g);
+    EXPECT_EQ(allocationCount(), before);
+
+    EXPECT_FALSE(f);
+    EXPECT_FALSE(g);
+    ASSERT_TRUE(h);
+    EXPECT_EQ(h(5), 15);
+}
+
+TEST(UniqueFunction, LargeCallableAllocatesOnce)
+{
+    size_t before = allocationCount();
+    Callback f(Large{});
+    EXPECT_EQ(allocationCount(), before + 1);
+
+    Callback g(std::move(f));
+    Callback h;
+    h = std::move(g);
+    EXPECT_EQ(allocationCount(), before + 1);
+    EXPECT_EQ(h(1), 2);
+}
+
+TEST(UniqueFunction, ThrowingMoveGoesToHeap)
+{
+    size_t before = allocationCount();
+    Callback f(ThrowingMove{});
+    EXPECT_EQ(allocationCount(), before + 1);
+    EXPECT_EQ(f(1), 3);
+}
+
+TEST(UniqueFunction, HoldsMoveOnlyCapture)
+{
+    auto value = std::make_unique<int>(7);
+    Callback f([value{std::move(value)}](int v) { return *value * v; });
+    Callback g(std::move(f));
+    EXPECT_EQ(g(3), 21);
+}
+
+TEST(UniqueFunction, DestroysCallable)
+{
+    auto token = std::make_shared<int>(0);
+    {
+        Callback f([token](int v) { return v; });
+        EXPECT_EQ(token.use_count(), 2);
+        Callback g(std::move(f));
+        EXPECT_EQ(token.use_count(), 2);
+    }
+    EXPECT_EQ(token.use_count(), 1);
+
+    Callback f([token](int v) { return v; });
+    f = nullptr;
+    EXPECT_EQ(token.use_count(), 1);
+
+    Callback g([token](int v) { return v; });
+    g = Callback([](int v) { return v; });
+    EXPECT_EQ(token.use_count(), 1);
+
+    Callback h([token, pad{Large{}}](int v) { return v; });
+    EXPECT_EQ(token.use_count(), 2);
+    h = nullptr;
+    EXPECT_EQ(token.use_count(), 1);
+}
+
+TEST(UniqueFunction, ForwardsArguments)
+{
+    UniqueFunction<void(int&, std::unique_ptr<int>)> f(
+        [](int& out, std::unique_ptr<int> in) { out = *in; });
+    int out = 0;
+    f(out, std::make_unique<int>(4));
+    EXPECT_EQ(out, 4);
+}
+
+TEST(UniqueFunction, CallableThroughConstReference)
+{
+    int calls = 0;
+    const Callback f([&calls](int v) {
+        calls++;
+        return v;
+    });
+    f(0);
+    f(0);
+    EXPECT_EQ(calls, 2);
+}
+
+} // namespace